@@ -16,49 +16,54 @@ void positPool2d_8_1(__global FloatType* restrict input,
                      int inputW,
                      int outputH,
                      int outputW,
-                     int kernelHW,
-                     int strideHW,
+                     int kernelH,
+                     int kernelW,
+                     int strideH,
+                     int strideW,
                      int padT,
                      int padL,
+                     int dilationH,
+                     int dilationW,
                      char inputScale,
                      char outputScale,
                      DeviceBool useAvg,
                      DeviceBool roundStochastic,
                      __global FloatType* restrict output) {
-  unsigned char kerSize = (unsigned char) (kernelHW * kernelHW);
+  // Average pooling counts the padding, as the divisor is the window size
+  unsigned char kerSize = (unsigned char) (kernelH * kernelW);
 
   for (int b = 0; b < batchSize; ++b) {
     for (int c = 0; c < channels; ++c) {
       for (int oh = 0; oh < outputH; ++oh) {
         for (int ow = 0; ow < outputW; ++ow) {
 
-          int inputStartH = oh * strideHW - padT;
-          int inputEndH = inputStartH + kernelHW;
-          int inputStartW = ow * strideHW - padL;
-          int inputEndW = inputStartW + kernelHW;
-
-          inputStartH = min(max(inputStartH, 0), inputH);
-          inputEndH = min(max(inputEndH, 0), inputH);
-
-          inputStartW = min(max(inputStartW, 0), inputW);
-          inputEndW = min(max(inputEndW, 0), inputW);
+          int inputStartH = oh * strideH - padT;
+          int inputStartW = ow * strideW - padL;
 
           FloatType max = kLowestValue;
+          bool anyInBounds = false;
 
           Accumulator acc;
           ACC_ZERO(acc);
 
-          // FIXME: this will be completely serial!!! We need known bounds
-          for (int ih = inputStartH; ih < inputEndH; ++ih) {
-            for (int iw = inputStartW; iw < inputEndW; ++iw) {
-              FloatType v = input[((c * inputH) + ih) * inputW + iw];
+          // Bounds are only known at runtime, so this is serial; the common
+          // windows use the specialized kernels below
+          for (int kh = 0; kh < kernelH; ++kh) {
+            for (int kw = 0; kw < kernelW; ++kw) {
+              int ih = inputStartH + kh * dilationH;
+              int iw = inputStartW + kw * dilationW;
 
-              Accumulator accV = logToLinear_RTL(v);
-              acc = linearAdd_RTL(accV, acc);
+              if (ih >= 0 && ih < inputH && iw >= 0 && iw < inputW) {
+                FloatType v = input[((c * inputH) + ih) * inputW + iw];
 
-              max = logComp_RTL(v, max, kComp_GT) ? v : max;
-            } // iw
-          } // ih
+                Accumulator accV = logToLinear_RTL(v);
+                acc = linearAdd_RTL(accV, acc);
+
+                max = logComp_RTL(v, max, kComp_GT) ? v : max;
+                anyInBounds = true;
+              }
+            } // kw
+          } // kh
 
           acc = linearDivide_RTL(acc, kerSize);
           FloatType avg = linearToLog_RTL(acc, outputScale);
@@ -66,8 +71,7 @@ void positPool2d_8_1(__global FloatType* restrict input,
           // If we are entirely within the padding region, the output must be
           // zero. The lowest posit is used as a sentinel value, but we don't
           // want to write this out.
-          max = (inputStartH == inputEndH || inputStartW == inputEndW) ?
-            kZeroValue : max;
+          max = anyInBounds ? max : kZeroValue;
 
           output[((c * outputH) + oh) * outputW + ow] = useAvg ? avg : max;
         } // ow
@@ -80,6 +84,110 @@ void positPool2d_8_1(__global FloatType* restrict input,
   } // batch
 }
 
+// Pooling specialized to a fixed window, used in place of positPool2d_8_1 for
+// the common cases. These are NDRange kernels: the global size is
+// (outputW, outputH, batch * channels), with each work item producing one
+// output point, so all channel planes proceed in parallel.
+
+// Max over the kernelHW x kernelHW window at (startH, startW) of `plane`,
+// skipping points in the padding region. kernelHW is a literal at each call,
+// so the window is fully unrolled.
+inline FloatType
+maxPoolWindow(__global FloatType* restrict plane,
+              int inputH,
+              int inputW,
+              int startH,
+              int startW,
+              const int kernelHW) {
+  FloatType max = kLowestValue;
+  bool any = false;
+
+#pragma unroll
+  for (int kh = 0; kh < kernelHW; ++kh) {
+#pragma unroll
+    for (int kw = 0; kw < kernelHW; ++kw) {
+      int ih = startH + kh;
+      int iw = startW + kw;
+
+      bool inBounds = (ih >= 0) && (ih < inputH) &&
+        (iw >= 0) && (iw < inputW);
+
+      FloatType v = inBounds ? plane[ih * inputW + iw] : kLowestValue;
+      max = logComp_RTL(v, max, kComp_GT) ? v : max;
+      any = any || inBounds;
+    }
+  }
+
+  // As positPool2d_8_1, a window entirely within the padding is zero
+  return any ? max : kZeroValue;
+}
+
+// 2x2 window, stride 2
+__kernel
+void positMaxPool2d_k2s2_8_1(__global FloatType* restrict input,
+                             int inputH,
+                             int inputW,
+                             int outputH,
+                             int outputW,
+                             int padT,
+                             int padL,
+                             __global FloatType* restrict output) {
+  int ow = get_global_id(0);
+  int oh = get_global_id(1);
+  int plane = get_global_id(2);
+
+  input += plane * inputH * inputW;
+  output += plane * outputH * outputW;
+
+  output[oh * outputW + ow] =
+    maxPoolWindow(input, inputH, inputW, oh * 2 - padT, ow * 2 - padL, 2);
+}
+
+// 3x3 window, stride 2
+__kernel
+void positMaxPool2d_k3s2_8_1(__global FloatType* restrict input,
+                             int inputH,
+                             int inputW,
+                             int outputH,
+                             int outputW,
+                             int padT,
+                             int padL,
+                             __global FloatType* restrict output) {
+  int ow = get_global_id(0);
+  int oh = get_global_id(1);
+  int plane = get_global_id(2);
+
+  input += plane * inputH * inputW;
+  output += plane * outputH * outputW;
+
+  output[oh * outputW + ow] =
+    maxPoolWindow(input, inputH, inputW, oh * 2 - padT, ow * 2 - padL, 3);
+}
+
+// Average over an entire 7x7 plane to 1x1. The global size is
+// (batch * channels); the plane is summed in linear space and rounded once.
+__kernel
+void positGlobalAvgPool7x7_8_1(__global FloatType* restrict input,
+                               char inputScale,
+                               char outputScale,
+                               DeviceBool roundStochastic,
+                               __global FloatType* restrict output) {
+  int plane = get_global_id(0);
+  input += plane * 7 * 7;
+
+  Accumulator acc;
+  ACC_ZERO(acc);
+
+#pragma unroll
+  for (int i = 0; i < 7 * 7; ++i) {
+    Accumulator accV = logToLinear_RTL(input[i]);
+    acc = linearAdd_RTL(accV, acc);
+  }
+
+  acc = linearDivide_RTL(acc, (unsigned char) (7 * 7));
+  output[plane] = linearToLog_RTL(acc, outputScale);
+}
+
 __kernel
 __attribute((max_global_work_dim(0)))
 void im2col_8(__global unsigned char* restrict input,
@@ -89,30 +197,34 @@ void im2col_8(__global unsigned char* restrict input,
               int inputW,
               int outputH,
               int outputW,
-              int kernelHW,
-              int strideHW,
+              int kernelH,
+              int kernelW,
+              int strideH,
+              int strideW,
               int padT,
               int padL,
+              int dilationH,
+              int dilationW,
               __global unsigned char* restrict output) {
   // input is (batch, inputChannels, inputH, inputW)
   // output is (batch) x ((inputChannels x kH x kW) x (outputH x outputW))
   for (int b = 0; b < batchSize; ++b) {
 #pragma loop_coalesce 4
     for (int c = 0; c < channels; ++c) {
-      for (int kHOffset = 0; kHOffset < kernelHW; ++kHOffset) {
-        for (int kWOffset = 0; kWOffset < kernelHW; ++kWOffset) {
+      for (int kHOffset = 0; kHOffset < kernelH; ++kHOffset) {
+        for (int kWOffset = 0; kWOffset < kernelW; ++kWOffset) {
           for (int oh = 0; oh < outputH; ++oh) {
 #pragma unroll 4
             for (int ow = 0; ow < outputW; ++ow) {
               // Translate to input point
-              int ih = oh * strideHW + kHOffset - padT;
-              int iw = ow * strideHW + kWOffset - padL;
+              int ih = oh * strideH + kHOffset * dilationH - padT;
+              int iw = ow * strideW + kWOffset * dilationW - padL;
 
               bool inBounds = (ih >= 0) && (ih < inputH) &&
                 (iw >= 0) && (iw < inputW);
 
-              output[(((c * kernelHW + kHOffset) *
-                       kernelHW + kWOffset) * outputH + oh) * outputW + ow] =
+              output[(((c * kernelH + kHOffset) *
+                       kernelW + kWOffset) * outputH + oh) * outputW + ow] =
                 inBounds ?
                 input[(c * inputH + ih) * inputW + iw] : 0;
             } // ow
@@ -123,6 +235,479 @@ void im2col_8(__global unsigned char* restrict input,
 
     // Increment for next batch
     input += channels * inputH * inputW;
-    output += channels * kernelHW * kernelHW * outputH * outputW;
+    output += channels * kernelH * kernelW * outputH * outputW;
+  } // b
+}
+
+// Inverse of im2col_8: every input point receives the sum of the column
+// entries that were gathered from it. Overlapping windows are summed in the
+// linear accumulator, so each output is rounded only once.
+__kernel
+__attribute((max_global_work_dim(0)))
+void col2im_8_1(__global FloatType* restrict input,
+                int batchSize,
+                int channels,
+                int inputH,
+                int inputW,
+                int outputH,
+                int outputW,
+                int kernelH,
+                int kernelW,
+                int strideH,
+                int strideW,
+                int padT,
+                int padL,
+                int dilationH,
+                int dilationW,
+                char outputScale,
+                DeviceBool roundStochastic,
+                __global FloatType* restrict output) {
+  // input is (batch) x ((inputChannels x kH x kW) x (outputH x outputW))
+  // output is (batch, inputChannels, inputH, inputW)
+  for (int b = 0; b < batchSize; ++b) {
+    for (int c = 0; c < channels; ++c) {
+      for (int ih = 0; ih < inputH; ++ih) {
+        for (int iw = 0; iw < inputW; ++iw) {
+          Accumulator acc;
+          ACC_ZERO(acc);
+
+          for (int kHOffset = 0; kHOffset < kernelH; ++kHOffset) {
+            for (int kWOffset = 0; kWOffset < kernelW; ++kWOffset) {
+              // Translate to the output point whose window covers us here
+              int ohStride = ih + padT - kHOffset * dilationH;
+              int owStride = iw + padL - kWOffset * dilationW;
+              int oh = ohStride / strideH;
+              int ow = owStride / strideW;
+
+              bool valid = (ohStride >= 0) && (owStride >= 0) &&
+                (ohStride % strideH == 0) && (owStride % strideW == 0) &&
+                (oh < outputH) && (ow < outputW);
+
+              if (valid) {
+                FloatType v =
+                  input[(((c * kernelH + kHOffset) *
+                          kernelW + kWOffset) * outputH + oh) * outputW + ow];
+
+                Accumulator accV = logToLinear_RTL(v);
+                acc = linearAdd_RTL(accV, acc);
+              }
+            } // kWOffset
+          } // kHOffset
+
+          output[(c * inputH + ih) * inputW + iw] =
+            linearToLog_RTL(acc, outputScale);
+        } // iw
+      } // ih
+    } // c
+
+    // Increment for next batch
+    input += channels * kernelH * kernelW * outputH * outputW;
+    output += channels * inputH * inputW;
   } // b
 }
+
+// Channels-last ([batch][height][width][channel]) counterparts of the above.
+// All channels of a point are contiguous, so these are NDRange kernels whose
+// adjacent work items touch adjacent channels.
+
+// im2col for channels-last input. Output is
+// (batch x outputH x outputW) x (kH x kW x inputChannels): each row is the
+// window of one output point, and each tap of the window is a contiguous run
+// of channels. The global size is (outputW, outputH, batch).
+__kernel
+void im2col_nhwc_8(__global FloatType* restrict input,
+                   int channels,
+                   int inputH,
+                   int inputW,
+                   int outputH,
+                   int outputW,
+                   int kernelH,
+                   int kernelW,
+                   int strideH,
+                   int strideW,
+                   int padT,
+                   int padL,
+                   int dilationH,
+                   int dilationW,
+                   __global FloatType* restrict output) {
+  int ow = get_global_id(0);
+  int oh = get_global_id(1);
+  int b = get_global_id(2);
+
+  input += b * inputH * inputW * channels;
+  output += ((b * outputH + oh) * outputW + ow) *
+    kernelH * kernelW * channels;
+
+  for (int kHOffset = 0; kHOffset < kernelH; ++kHOffset) {
+    for (int kWOffset = 0; kWOffset < kernelW; ++kWOffset) {
+      // Translate to input point
+      int ih = oh * strideH + kHOffset * dilationH - padT;
+      int iw = ow * strideW + kWOffset * dilationW - padL;
+
+      bool inBounds = (ih >= 0) && (ih < inputH) &&
+        (iw >= 0) && (iw < inputW);
+
+      int inOffset = inBounds ? (ih * inputW + iw) * channels : 0;
+
+#pragma unroll 4
+      for (int c = 0; c < channels; ++c) {
+        output[c] = inBounds ? input[inOffset + c] : 0;
+      }
+
+      output += channels;
+    } // kWOffset
+  } // kHOffset
+}
+
+// positPool2d_8_1 for channels-last input and output. The global size is
+// (channels, outputH x outputW, batch).
+__kernel
+void positPool2d_nhwc_8_1(__global FloatType* restrict input,
+                          int channels,
+                          int inputH,
+                          int inputW,
+                          int outputH,
+                          int outputW,
+                          int kernelH,
+                          int kernelW,
+                          int strideH,
+                          int strideW,
+                          int padT,
+                          int padL,
+                          int dilationH,
+                          int dilationW,
+                          char inputScale,
+                          char outputScale,
+                          DeviceBool useAvg,
+                          DeviceBool roundStochastic,
+                          __global FloatType* restrict output) {
+  int c = get_global_id(0);
+  int oh = get_global_id(1) / outputW;
+  int ow = get_global_id(1) % outputW;
+  int b = get_global_id(2);
+
+  unsigned char kerSize = (unsigned char) (kernelH * kernelW);
+
+  input += b * inputH * inputW * channels + c;
+
+  int inputStartH = oh * strideH - padT;
+  int inputStartW = ow * strideW - padL;
+
+  FloatType max = kLowestValue;
+  bool anyInBounds = false;
+
+  Accumulator acc;
+  ACC_ZERO(acc);
+
+  for (int kh = 0; kh < kernelH; ++kh) {
+    for (int kw = 0; kw < kernelW; ++kw) {
+      int ih = inputStartH + kh * dilationH;
+      int iw = inputStartW + kw * dilationW;
+
+      if (ih >= 0 && ih < inputH && iw >= 0 && iw < inputW) {
+        FloatType v = input[(ih * inputW + iw) * channels];
+
+        Accumulator accV = logToLinear_RTL(v);
+        acc = linearAdd_RTL(accV, acc);
+
+        max = logComp_RTL(v, max, kComp_GT) ? v : max;
+        anyInBounds = true;
+      }
+    } // kw
+  } // kh
+
+  acc = linearDivide_RTL(acc, kerSize);
+  FloatType avg = linearToLog_RTL(acc, outputScale);
+
+  // As positPool2d_8_1, a window entirely within the padding is zero
+  max = anyInBounds ? max : kZeroValue;
+
+  output[((b * outputH + oh) * outputW + ow) * channels + c] =
+    useAvg ? avg : max;
+}
+
+//
+// Winograd F(2x2, 3x3) convolution, for 3x3 stride 1 kernels:
+// Y = A^t [(G g G^t) . (B^t d B)] A
+// Each transform is an exact sum in linear space, rounded once per value. The
+// products, and their sum over input channels, are a batched matrix multiply
+// over the 16 transformed points (see runForwardConv2dWinogradNCHW).
+// Transformed tensors are [16][channel][tile], with the tiles of all images
+// together.
+//
+
+// acc + c * v, for a small integer c
+inline Accumulator
+winogradAccumulate(Accumulator acc, FloatType v, int c) {
+  FloatType sv =
+    (c > 0 || v == kZeroValue || v == kInfValue) ? v : NEG_FLOAT(v);
+  Accumulator accV = logToLinear_RTL(sv);
+
+  int n = c < 0 ? -c : c;
+  for (int i = 0; i < n; ++i) {
+    acc = linearAdd_RTL(accV, acc);
+  }
+
+  return acc;
+}
+
+// U = G g G^t for each 3x3 filter g of a [outPlane][inPlane][3][3] weight.
+// The global size is (inPlane, outPlane).
+__kernel
+void positWinogradFilter8_1(__global FloatType* restrict weight,
+                            int inPlane,
+                            int outPlane,
+                            __global FloatType* restrict output) {
+  // 2G, so that all coefficients are integers: U = (2G) g (2G)^t / 4
+  const int g2[4][3] = {{2, 0, 0}, {1, 1, 1}, {1, -1, 1}, {0, 0, 2}};
+
+  int ci = get_global_id(0);
+  int co = get_global_id(1);
+
+  weight += (co * inPlane + ci) * 9;
+
+  FloatType g[3][3];
+#pragma unroll
+  for (int k = 0; k < 3; ++k) {
+#pragma unroll
+    for (int l = 0; l < 3; ++l) {
+      g[k][l] = weight[k * 3 + l];
+    }
+  }
+
+#pragma unroll
+  for (int i = 0; i < 4; ++i) {
+#pragma unroll
+    for (int j = 0; j < 4; ++j) {
+      Accumulator acc;
+      ACC_ZERO(acc);
+
+      for (int k = 0; k < 3; ++k) {
+        for (int l = 0; l < 3; ++l) {
+          acc = winogradAccumulate(acc, g[k][l], g2[i][k] * g2[j][l]);
+        }
+      }
+
+      output[((i * 4 + j) * outPlane + co) * inPlane + ci] =
+        linearToLog_RTL(acc, (char) -2);
+    }
+  }
+}
+
+// V = B^t d B for each 4x4 input tile d (overlapping by 2), which is zero
+// outside of the image. The global size is (tilesW, tilesH, batch x
+// channels).
+__kernel
+void positWinogradInput8_1(__global FloatType* restrict input,
+                           int channels,
+                           int inputH,
+                           int inputW,
+                           int tilesH,
+                           int tilesW,
+                           int numTiles,
+                           int padT,
+                           int padL,
+                           DeviceBool roundStochastic,
+                           __global FloatType* restrict output) {
+  const int bt[4][4] =
+    {{1, 0, -1, 0}, {0, 1, 1, 0}, {0, -1, 1, 0}, {0, 1, 0, -1}};
+
+  int tw = get_global_id(0);
+  int th = get_global_id(1);
+  int plane = get_global_id(2);
+  int b = plane / channels;
+  int c = plane % channels;
+
+  input += plane * inputH * inputW;
+
+  FloatType d[4][4];
+#pragma unroll
+  for (int r = 0; r < 4; ++r) {
+#pragma unroll
+    for (int s = 0; s < 4; ++s) {
+      int ih = th * 2 - padT + r;
+      int iw = tw * 2 - padL + s;
+
+      bool inBounds = (ih >= 0) && (ih < inputH) &&
+        (iw >= 0) && (iw < inputW);
+
+      d[r][s] = inBounds ? input[ih * inputW + iw] : kZeroValue;
+    }
+  }
+
+  int tile = (b * tilesH + th) * tilesW + tw;
+
+#pragma unroll
+  for (int i = 0; i < 4; ++i) {
+#pragma unroll
+    for (int j = 0; j < 4; ++j) {
+      Accumulator acc;
+      ACC_ZERO(acc);
+
+      for (int r = 0; r < 4; ++r) {
+        for (int s = 0; s < 4; ++s) {
+          acc = winogradAccumulate(acc, d[r][s], bt[i][r] * bt[j][s]);
+        }
+      }
+
+      output[((i * 4 + j) * channels + c) * numTiles + tile] =
+        linearToLog_RTL(acc, (char) 0);
+    }
+  }
+}
+
+// Y = A^t M A (+ bias) for each tile of the products M, giving a 2x2 block of
+// a [batch][outPlane][outputH][outputW] output. The global size is (tilesW,
+// tilesH, batch x outPlane).
+__kernel
+void positWinogradOutput8_1(__global FloatType* restrict m,
+                            __global FloatType* restrict bias,
+                            DeviceBool useBias,
+                            DeviceBool relu,
+                            int outPlane,
+                            int outputH,
+                            int outputW,
+                            int tilesH,
+                            int tilesW,
+                            int numTiles,
+                            char outputScale,
+                            DeviceBool roundStochastic,
+                            __global FloatType* restrict output) {
+  const int at[2][4] = {{1, 1, 1, 0}, {0, 1, -1, -1}};
+
+  int tw = get_global_id(0);
+  int th = get_global_id(1);
+  int plane = get_global_id(2);
+  int b = plane / outPlane;
+  int co = plane % outPlane;
+
+  int tile = (b * tilesH + th) * tilesW + tw;
+
+  FloatType mv[4][4];
+#pragma unroll
+  for (int i = 0; i < 4; ++i) {
+#pragma unroll
+    for (int j = 0; j < 4; ++j) {
+      mv[i][j] = m[((i * 4 + j) * outPlane + co) * numTiles + tile];
+    }
+  }
+
+  output += plane * outputH * outputW;
+
+#pragma unroll
+  for (int y = 0; y < 2; ++y) {
+#pragma unroll
+    for (int x = 0; x < 2; ++x) {
+      Accumulator acc;
+      ACC_ZERO(acc);
+
+      if (useBias) {
+        acc = logToLinear_RTL(bias[co]);
+      }
+
+      for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+          acc = winogradAccumulate(acc, mv[i][j], at[y][i] * at[x][j]);
+        }
+      }
+
+      FloatType out = linearToLog_RTL(acc, outputScale);
+
+      if (relu) {
+        out = logComp_RTL(out, kZeroValue, kComp_GE) ? out : kZeroValue;
+      }
+
+      int oh = th * 2 + y;
+      int ow = tw * 2 + x;
+
+      if (oh < outputH && ow < outputW) {
+        output[oh * outputW + ow] = out;
+      }
+    }
+  }
+}
+
+// Direct grouped 2-d convolution, with one work item (and one accumulator)
+// per output point. The input channels are split into `groups` groups, each
+// seen by outPlane / groups output channels, so the weight is
+// [outPlane][inPlane / groups][kernelH][kernelW]. For depthwise convolution
+// (groups == inPlane) each output is a kernelH x kernelW dot product, which
+// im2col + matrix multiply would have to pad out to all input channels.
+// The global size is (outputW, outputH, batch * outPlane).
+__kernel
+void positGroupConv2d_8_1(__global FloatType* restrict input,
+                          __global FloatType* restrict weight,
+                          __global FloatType* restrict bias,
+                          DeviceBool useBias,
+                          DeviceBool relu,
+                          int inPlane,
+                          int outPlane,
+                          int groups,
+                          int inputH,
+                          int inputW,
+                          int outputH,
+                          int outputW,
+                          int kernelH,
+                          int kernelW,
+                          int strideH,
+                          int strideW,
+                          int padT,
+                          int padL,
+                          int dilationH,
+                          int dilationW,
+                          char inputScale,
+                          char outputScale,
+                          DeviceBool roundStochastic,
+                          __global FloatType* restrict output) {
+  int ow = get_global_id(0);
+  int oh = get_global_id(1);
+  int plane = get_global_id(2);
+  int b = plane / outPlane;
+  int co = plane % outPlane;
+
+  int groupIn = inPlane / groups;
+  int groupOut = outPlane / groups;
+  int ciStart = (co / groupOut) * groupIn;
+
+  int startH = oh * strideH - padT;
+  int startW = ow * strideW - padL;
+
+  Accumulator acc;
+  ACC_ZERO(acc);
+
+  if (useBias) {
+    acc = logToLinear_RTL(bias[co]);
+  }
+
+  weight += co * groupIn * kernelH * kernelW;
+
+  for (int ci = 0; ci < groupIn; ++ci) {
+    __global FloatType* restrict in =
+      input + (b * inPlane + ciStart + ci) * inputH * inputW;
+
+    for (int kh = 0; kh < kernelH; ++kh) {
+      int h = startH + kh * dilationH;
+
+      for (int kw = 0; kw < kernelW; ++kw) {
+        int w = startW + kw * dilationW;
+
+        // Padding contributes zero
+        if (h >= 0 && h < inputH && w >= 0 && w < inputW) {
+          Accumulator prod =
+            logMultiplyToLinear_RTL(in[h * inputW + w],
+                                    weight[(ci * kernelH + kh) *
+                                           kernelW + kw]);
+          acc = linearAdd_RTL(prod, acc);
+        }
+      }
+    }
+  }
+
+  FloatType out = linearToLog_RTL(acc, outputScale);
+
+  if (relu) {
+    out = logComp_RTL(out, kZeroValue, kComp_GE) ? out : kZeroValue;
+  }
+
+  output[(plane * outputH + oh) * outputW + ow] = out;
+}
@@ -27,3 +27,67 @@ void floatToPosit8_1(global unsigned int* restrict floatIn,
     positOut[i] = floatToLog_RTL(floatIn[i]);
   }
 }
+
+// Philox4x32-10, as philox4x32 in HostRound.cpp: the 4 random words for the
+// counter `ctr` under the key (keyLo, keyHi)
+inline uint4
+philox4x32(uint4 ctr, unsigned int keyLo, unsigned int keyHi) {
+  for (int round = 0; round < 10; ++round) {
+    unsigned int hi0 = mul_hi(0xD2511F53u, ctr.x);
+    unsigned int lo0 = 0xD2511F53u * ctr.x;
+    unsigned int hi1 = mul_hi(0xCD9E8D57u, ctr.z);
+    unsigned int lo1 = 0xCD9E8D57u * ctr.z;
+
+    ctr = (uint4) (hi1 ^ ctr.y ^ keyLo, lo1, hi0 ^ ctr.w ^ keyHi, lo0);
+
+    keyLo += 0x9E3779B9u;
+    keyHi += 0xBB67AE85u;
+  }
+
+  return ctr;
+}
+
+// Fills out with n random values, uniform in [a, b) if !gaussian, otherwise
+// normal with mean a and standard deviation b, each rounded to nearest.
+// Values 4i to 4i + 3 are drawn from the Philox counter i under the key
+// (seedLo, seedHi), so the result only depends on the seed.
+__kernel
+__attribute((max_global_work_dim(0)))
+void random8_1(unsigned int n,
+               unsigned int seedLo,
+               unsigned int seedHi,
+               DeviceBool gaussian,
+               float a,
+               float b,
+               global FloatType* restrict out) {
+  for (unsigned int i = 0; i < n; i += 4) {
+    uint4 r = philox4x32((uint4) (i / 4, 0, 0, 0), seedLo, seedHi);
+
+    // 24 bit uniforms in [0, 1)
+    float4 u = convert_float4(r >> (uint4) 8) * (1.0f / 16777216.0f);
+    float v[4];
+
+    if (gaussian) {
+      // Box-Muller on (u.x, u.y) and (u.z, u.w); 1 - u is in (0, 1]
+      float2 radius = sqrt(-2.0f * log(1.0f - u.xz));
+      float2 theta = (2.0f * M_PI_F) * u.yw;
+
+      v[0] = a + b * radius.x * cos(theta.x);
+      v[1] = a + b * radius.x * sin(theta.x);
+      v[2] = a + b * radius.y * cos(theta.y);
+      v[3] = a + b * radius.y * sin(theta.y);
+    } else {
+      v[0] = a + (b - a) * u.x;
+      v[1] = a + (b - a) * u.y;
+      v[2] = a + (b - a) * u.z;
+      v[3] = a + (b - a) * u.w;
+    }
+
+#pragma unroll
+    for (unsigned int j = 0; j < 4; ++j) {
+      if (i + j < n) {
+        out[i + j] = floatToLog_RTL(as_uint(v[j]));
+      }
+    }
+  }
+}
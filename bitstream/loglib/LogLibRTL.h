@@ -28,6 +28,21 @@ typedef unsigned char DeviceBool;
 #define kDeviceScalarOp 1
 #define kHostScalarOp 2
 
+#define kBiasNone 0
+#define kBiasRow 1
+#define kBiasCol 2
+
+#define kMomentumNone 0
+#define kMomentumNarrow 1
+#define kMomentumWide 2
+
+#define kReduceSum 0
+#define kReduceMin 1
+#define kReduceMax 2
+#define kReduceArgMin 3
+#define kReduceArgMax 4
+#define kReduceSumSquares 5
+
 #define kAdd 0
 #define kSub 1
 #define kMul 2
@@ -7,6 +7,7 @@
 #include "LogMathRTL.h"
 #include "LogMathCompareRTL.h"
 #include "LogLinearMathRTL.h"
+#include "LogConvertRTL.h"
 
 #define kTileSize 4
 
@@ -121,8 +122,127 @@ void positReduce8_1(global FloatType* restrict positA,
   *positOut = (mathOp == kAdd) ? linearToLog_RTL(sumReduce, 0) : minMaxReduce;
 }
 
+// Offset of element i of the row-major index space `size` (w innermost)
+// laid out with `stride`
+inline unsigned int
+stridedOffset(unsigned int i, uint4 size, uint4 stride) {
+  unsigned int off = (i % size.w) * stride.w;
+  i /= size.w;
+  off += (i % size.z) * stride.z;
+  i /= size.z;
+  off += (i % size.y) * stride.y;
+  i /= size.y;
+
+  return off + i * stride.x;
+}
+
+#define kReduceLanes 4
+
+// Reduces a strided tensor over a set of its dimensions. Output o reduces the
+// numReduce elements at
+// stridedOffset(o, outSize, outStride) + stridedOffset(r, reduceSize,
+//                                                      reduceStride)
+// (unused dimensions have size 1). Sums are exact in the linear domain and
+// rounded once; argmax / argmin also write the index r of the first extremum.
+// kReduceLanes partial reductions are carried independently and combined at
+// the end.
+__kernel
+__attribute((max_global_work_dim(0)))
+void positReduceDim8_1(global FloatType* restrict positA,
+                       uint4 outSize,
+                       uint4 outStride,
+                       uint4 reduceSize,
+                       uint4 reduceStride,
+                       unsigned int numOut,
+                       unsigned int numReduce,
+                       OpType reduceOp,
+                       DeviceBool roundStochastic,
+                       global FloatType* restrict positOut,
+                       global unsigned int* restrict indexOut) {
+  bool isSum = (reduceOp == kReduceSum) || (reduceOp == kReduceSumSquares);
+  bool isMin = (reduceOp == kReduceMin) || (reduceOp == kReduceArgMin);
+
+  unsigned int tiles = (numReduce + kReduceLanes - 1) / kReduceLanes;
+
+  for (unsigned int o = 0; o < numOut; ++o) {
+    unsigned int base = stridedOffset(o, outSize, outStride);
+
+    Accumulator sum[kReduceLanes];
+    FloatType best[kReduceLanes];
+    unsigned int bestIndex[kReduceLanes];
+
+#pragma unroll
+    for (unsigned int j = 0; j < kReduceLanes; ++j) {
+      ACC_ZERO(sum[j]);
+      best[j] = kZeroValue;
+      bestIndex[j] = j;
+    }
+
+    for (unsigned int t = 0; t < tiles; ++t) {
+#pragma unroll
+      for (unsigned int j = 0; j < kReduceLanes; ++j) {
+        unsigned int r = t * kReduceLanes + j;
+
+        if (r < numReduce) {
+          FloatType v =
+            positA[base + stridedOffset(r, reduceSize, reduceStride)];
+
+          Accumulator lv = logToLinear_RTL(v);
+          Accumulator lv2 = logMultiplyToLinear_RTL(v, v);
+          sum[j] = linearAdd_RTL(
+            (reduceOp == kReduceSumSquares) ? lv2 : lv, sum[j]);
+
+          // A lane sees increasing r, so it keeps its first extremum
+          DeviceBool better = isMin ?
+            logComp_RTL(v, best[j], kComp_LT) :
+            logComp_RTL(v, best[j], kComp_GT);
+
+          if (t == 0 || better) {
+            best[j] = v;
+            bestIndex[j] = r;
+          }
+        }
+      }
+    }
+
+    Accumulator total;
+    ACC_ZERO(total);
+
+    FloatType extremum = best[0];
+    unsigned int extremumIndex = bestIndex[0];
+
+#pragma unroll
+    for (unsigned int j = 0; j < kReduceLanes; ++j) {
+      total = linearAdd_RTL(sum[j], total);
+
+      if (j > 0 && j < numReduce) {
+        DeviceBool better = isMin ?
+          logComp_RTL(best[j], extremum, kComp_LT) :
+          logComp_RTL(best[j], extremum, kComp_GT);
+        DeviceBool earlier =
+          logComp_RTL(best[j], extremum, kComp_EQ) &&
+          (bestIndex[j] < extremumIndex);
+
+        if (better || earlier) {
+          extremum = best[j];
+          extremumIndex = bestIndex[j];
+        }
+      }
+    }
+
+    positOut[o] = isSum ? linearToLog_RTL(total, (char) 0) : extremum;
+
+    if ((reduceOp == kReduceArgMax) || (reduceOp == kReduceArgMin)) {
+      indexOut[o] = extremumIndex;
+    }
+  }
+}
+
+#undef kReduceLanes
+
 // Exact multiply-add:
 // out_i = c(_i) (+|-) a(_i) * b_i
+// or max(out_i, 0) if relu is set
 // Some of A, B, C and out may in fact be the same, but there are no write
 // dependencies between them, so we mark them all as __restrict
 #define kTileSize 4
@@ -144,6 +264,7 @@ void positMulAdd8_1(global FloatType* restrict positC,
                     DeviceBool subtract,
                     DeviceBool roundStochastic,
                     char scaleOut,
+                    DeviceBool relu,
 
                     unsigned int n,
                     global FloatType* restrict positOut) {
@@ -179,9 +300,207 @@ void positMulAdd8_1(global FloatType* restrict positC,
       Accumulator mul = logMultiplyToLinear_RTL(pa, positB[i]);
       acc = linearAdd_RTL(mul, acc);
 
-      positOut[i] = linearToLog_RTL(acc, scaleOut);
+      FloatType pout = linearToLog_RTL(acc, scaleOut);
+      if (relu) {
+        pout = logComp_RTL(pout, kZeroValue, kComp_GE) ? pout : kZeroValue;
+      }
+
+      positOut[i] = pout;
     }
   }
 }
 
+// One step of SGD with momentum:
+// v = momentum * v + grad
+// param = param - lr * v
+// The momentum buffer is either of FloatType (kMomentumNarrow) or float
+// (kMomentumWide). A float v enters the linear accumulator as the sum of its two
+// nearest FloatType terms, so the parameter sees it at about twice our
+// precision. Each stored result is rounded once.
+__kernel
+__attribute((max_global_work_dim(0)))
+void positSGD8_1(global FloatType* restrict param,
+                 global FloatType* restrict grad,
+                 global FloatType* restrict momentumBuf,
+                 global unsigned int* restrict wideMomentumBuf,
+                 OpType momentumMode,
+                 float lr,
+                 float momentum,
+                 DeviceBool roundStochastic,
+                 unsigned int n) {
+  FloatType negLr = floatToLog_RTL(as_uint(-lr));
+  FloatType momentumP = floatToLog_RTL(as_uint(momentum));
+
+  unsigned int tiles = ((n + kTileSize - 1) / kTileSize);
+
+  for (unsigned int t = 0; t < tiles; ++t) {
+#pragma unroll
+    for (unsigned int j = 0; j < kTileSize; ++j) {
+      unsigned int i = t * kTileSize + j;
+
+      if (i < n) {
+        FloatType g = grad[i];
+
+        // The step taken is -lr * (vHi + vLo)
+        FloatType vHi = g;
+        FloatType vLo = kZeroValue;
+
+        if (momentumMode == kMomentumNarrow) {
+          // v = momentum * v + g
+          Accumulator accV = logToLinear_RTL(g);
+          Accumulator mulV = logMultiplyToLinear_RTL(momentumP, momentumBuf[i]);
+          accV = linearAdd_RTL(mulV, accV);
+
+          vHi = linearToLog_RTL(accV, (char) 0);
+
+          momentumBuf[i] = vHi;
+        } else if (momentumMode == kMomentumWide) {
+          float v = momentum * as_float(wideMomentumBuf[i]) +
+            as_float(logToFloat_RTL(g));
+          wideMomentumBuf[i] = as_uint(v);
+
+          vHi = floatToLog_RTL(as_uint(v));
+          vLo = floatToLog_RTL(
+            as_uint(v - as_float(logToFloat_RTL(vHi))));
+        }
+
+        // param = param - lr * v
+        Accumulator acc = logToLinear_RTL(param[i]);
+
+        Accumulator mulHi = logMultiplyToLinear_RTL(negLr, vHi);
+        acc = linearAdd_RTL(mulHi, acc);
+
+        Accumulator mulLo = logMultiplyToLinear_RTL(negLr, vLo);
+        acc = linearAdd_RTL(mulLo, acc);
+
+        param[i] = linearToLog_RTL(acc, (char) 0);
+      }
+    }
+  }
+}
+
+#define kFuncTableSize (1 << TYPE_WIDTH)
+
+// Row-wise log-softmax over input [rows][cols], and optionally the NLL loss
+// and its gradient for the class target[r] of each row r.
+// funcTable holds exp, ln and 1/x of every encoding in turn, as computed by
+// positSpecialFunc8_1; they are looked up on chip.
+// The max and the sum of exp(x - max) are found in one pass: the sum is
+// exact in the linear domain between updates of the max, each of which
+// rounds it once to rescale by exp(oldMax - newMax). A second pass writes
+// round(x - (max + ln(sum))), with max + ln(sum) held in the linear domain.
+// With a target, loss[r] = -scale * out[r][target[r]] and
+// gradInput[r][j] = scale * (exp(out[r][j]) - (j == target[r])), where scale
+// is weight[target[r]] (1 without weights), divided by the sum of it over the
+// rows if sizeAverage.
+__kernel
+__attribute((max_global_work_dim(0)))
+void positLogSoftmax8_1(global FloatType* restrict input,
+                        global FloatType* restrict funcTable,
+                        global unsigned int* restrict target,
+                        global FloatType* restrict weight,
+                        DeviceBool useTarget,
+                        DeviceBool useWeight,
+                        DeviceBool sizeAverage,
+                        DeviceBool useGrad,
+                        DeviceBool roundStochastic,
+                        unsigned int rows,
+                        unsigned int cols,
+                        global FloatType* restrict output,
+                        global FloatType* restrict loss,
+                        global FloatType* restrict gradInput) {
+  FloatType expTable[kFuncTableSize];
+  FloatType lnTable[kFuncTableSize];
+  FloatType invTable[kFuncTableSize];
+
+  for (unsigned int i = 0; i < kFuncTableSize; ++i) {
+    expTable[i] = funcTable[i];
+    lnTable[i] = funcTable[kFuncTableSize + i];
+    invTable[i] = funcTable[2 * kFuncTableSize + i];
+  }
+
+  FloatType one = floatToLog_RTL(as_uint(1.0f));
+
+  FloatType invTotalWeight = one;
+
+  if (useTarget && sizeAverage) {
+    Accumulator accW;
+    ACC_ZERO(accW);
+
+    for (unsigned int r = 0; r < rows; ++r) {
+      FloatType w = useWeight ? weight[target[r]] : one;
+      accW = linearAdd_RTL(logToLinear_RTL(w), accW);
+    }
+
+    invTotalWeight = invTable[linearToLog_RTL(accW, (char) 0)];
+  }
+
+  for (unsigned int r = 0; r < rows; ++r) {
+    global FloatType* inRow = input + r * cols;
+    global FloatType* outRow = output + r * cols;
+    global FloatType* gradRow = gradInput + r * cols;
+
+    // exp(x_0 - x_0) = 1
+    FloatType maxV = inRow[0];
+    Accumulator accSum = logToLinear_RTL(one);
+
+    for (unsigned int c = 1; c < cols; ++c) {
+      FloatType v = inRow[c];
+
+      if (logComp_RTL(v, maxV, kComp_GT)) {
+        // sum = sum * exp(maxV - v) + exp(v - v)
+        FloatType sum = linearToLog_RTL(accSum, (char) 0);
+        FloatType rescale = expTable[logAdd_RTL(maxV, v, kDeviceTrue)];
+
+        accSum = linearAdd_RTL(logMultiplyToLinear_RTL(sum, rescale),
+                               logToLinear_RTL(one));
+
+        maxV = v;
+      } else {
+        FloatType e = expTable[logAdd_RTL(v, maxV, kDeviceTrue)];
+        accSum = linearAdd_RTL(logToLinear_RTL(e), accSum);
+      }
+    }
+
+    // -(max + ln(sum))
+    FloatType lnSum = lnTable[linearToLog_RTL(accSum, (char) 0)];
+
+    Accumulator negLse = linearAdd_RTL(logToLinear_RTL(NEG_FLOAT(maxV)),
+                                       logToLinear_RTL(NEG_FLOAT(lnSum)));
+
+    unsigned int t = useTarget ? target[r] : 0;
+
+    FloatType scale = one;
+    if (useTarget) {
+      FloatType w = useWeight ? weight[t] : one;
+      scale = linearToLog_RTL(logMultiplyToLinear_RTL(w, invTotalWeight),
+                              (char) 0);
+    }
+
+    for (unsigned int c = 0; c < cols; ++c) {
+      Accumulator acc = linearAdd_RTL(logToLinear_RTL(inRow[c]), negLse);
+
+      FloatType out = linearToLog_RTL(acc, (char) 0);
+      outRow[c] = out;
+
+      if (useTarget && c == t) {
+        loss[r] = linearToLog_RTL(
+          logMultiplyToLinear_RTL(NEG_FLOAT(scale), out), (char) 0);
+      }
+
+      if (useGrad) {
+        Accumulator accGrad = logMultiplyToLinear_RTL(scale, expTable[out]);
+
+        if (c == t) {
+          accGrad = linearAdd_RTL(logToLinear_RTL(NEG_FLOAT(scale)), accGrad);
+        }
+
+        gradRow[c] = linearToLog_RTL(accGrad, (char) 0);
+      }
+    }
+  }
+}
+
+#undef kFuncTableSize
+
 #undef kTileSize
@@ -35,3 +35,70 @@ void positThreshold8_1(global FloatType* restrict positA,
     positOut[i] = logComp_RTL(pa, pb, compType) ? positSel[i] : kZeroValue;
   }
 }
+
+// Largest k of positTopK8_1; matches kMaxTopK in ops/TensorMath.h
+#define kMaxTopK 16
+
+#define COMP_GT(A, B) logComp_RTL(A, B, kComp_GT)
+
+// For each of the rows of input [rows][cols], writes its k largest values in
+// decreasing order and their column indices to values / indices [rows][k],
+// with ties keeping the lower index. Only comparisons are used; values are
+// never decoded.
+// The top-k list is held on chip, and each value is inserted in it in
+// parallel: every entry compares against the value, and those below it
+// shift down by one.
+__kernel
+__attribute((max_global_work_dim(0)))
+void positTopK8_1(global FloatType* restrict input,
+                  unsigned int rows,
+                  unsigned int cols,
+                  unsigned int k,
+                  global FloatType* restrict values,
+                  global unsigned int* restrict indices) {
+  for (unsigned int r = 0; r < rows; ++r) {
+    global FloatType* inRow = input + r * cols;
+
+    FloatType topV[kMaxTopK];
+    unsigned int topI[kMaxTopK];
+    unsigned int filled = 0;
+
+    for (unsigned int c = 0; c < cols; ++c) {
+      FloatType v = inRow[c];
+
+      // The list is sorted, so v goes before the first entry it exceeds, or
+      // at the end
+      unsigned int pos = filled;
+
+#pragma unroll
+      for (int j = kMaxTopK - 1; j >= 0; --j) {
+        if ((unsigned int) j < filled && COMP_GT(v, topV[j])) {
+          pos = j;
+        }
+      }
+
+      if (pos < k) {
+#pragma unroll
+        for (int j = kMaxTopK - 1; j > 0; --j) {
+          if ((unsigned int) j > pos) {
+            topV[j] = topV[j - 1];
+            topI[j] = topI[j - 1];
+          }
+        }
+
+        topV[pos] = v;
+        topI[pos] = c;
+
+        filled = min(filled + 1, k);
+      }
+    }
+
+    for (unsigned int j = 0; j < k; ++j) {
+      values[r * k + j] = topV[j];
+      indices[r * k + j] = topI[j];
+    }
+  }
+}
+
+#undef COMP_GT
+#undef kMaxTopK
@@ -98,7 +98,8 @@ void scatter_8(__global FloatType* restrict src,
 // Slice along rows to start at col nOffset (m x (n - nOffset))
 // Transpose to ((n - nOffset) x m)
 //
-// The global size is (n - nOffset, m, 1)
+// The global size is (n - nOffset, m, batch), where the batch of matrices
+// is contiguous in memory
 // The local size is (kTileSize, kTileSize, 1)
 //
 // 8 bit data types
@@ -120,6 +121,10 @@ void transpose2d_8(__global FloatType* restrict inMatrix,
   unsigned int tx = get_local_id(0);
   unsigned int ty = get_local_id(1);
 
+  unsigned int batch = get_global_id(2);
+  inMatrix += batch * m * n;
+  outMatrix += batch * m * (n - nOffset);
+
   unsigned int readRow = gy;
   unsigned int readCol = gx + nOffset;
 
@@ -139,4 +144,84 @@ void transpose2d_8(__global FloatType* restrict inMatrix,
   }
 }
 
+// Copies between two strided layouts of the same size `size`, 4 dimensions
+// in row-major order (unused dimensions have size 1):
+// out[stridedOffset(i, size, outStride)] = in[stridedOffset(i, size, inStride)]
+// Dimensions are ordered by the host so that adjacent work items write
+// adjacent outputs. `in` and `out` begin inOffset and outOffset elements into
+// their buffers, which need not be aligned.
+//
+// The global size is n rounded up to the work group size
+__kernel
+void copyStrided_8(__global FloatType* restrict in,
+                   unsigned int inOffset,
+                   __global FloatType* restrict out,
+                   unsigned int outOffset,
+                   uint4 size,
+                   uint4 inStride,
+                   uint4 outStride,
+                   unsigned int n) {
+  unsigned int i = get_global_id(0);
+
+  in += inOffset;
+  out += outOffset;
+
+  if (i < n) {
+    out[stridedOffset(i, size, outStride)] =
+      in[stridedOffset(i, size, inStride)];
+  }
+}
+
+// As copyStrided_8, where dimension z is the innermost dimension of `in` and
+// w the innermost dimension of `out` (a transpose, batched over x and y).
+// Each work group stages a tile through local memory, so that both the reads
+// and the writes run along an innermost dimension.
+//
+// The global size is (size.z, size.w, size.x * size.y), the first two rounded
+// up to kTileSize
+// The local size is (kTileSize, kTileSize, 1)
+__kernel
+__attribute((reqd_work_group_size(kTileSize, kTileSize, 1)))
+void copyStridedTiled_8(__global FloatType* restrict in,
+                        unsigned int inOffset,
+                        __global FloatType* restrict out,
+                        unsigned int outOffset,
+                        uint4 size,
+                        uint4 inStride,
+                        uint4 outStride) {
+  // Padded by a column so that the transposed accesses don't conflict
+  __local FloatType tile[kTileSize][kTileSize + 1];
+
+  unsigned int tx = get_local_id(0);
+  unsigned int ty = get_local_id(1);
+
+  unsigned int zBase = get_group_id(0) * kTileSize;
+  unsigned int wBase = get_group_id(1) * kTileSize;
+
+  unsigned int batch = get_global_id(2);
+  unsigned int bx = batch / size.y;
+  unsigned int by = batch % size.y;
+
+  in += inOffset + bx * inStride.x + by * inStride.y;
+  out += outOffset + bx * outStride.x + by * outStride.y;
+
+  // Read along z
+  unsigned int z = zBase + tx;
+  unsigned int w = wBase + ty;
+
+  if (z < size.z && w < size.w) {
+    tile[ty][tx] = in[z * inStride.z + w * inStride.w];
+  }
+
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  // Write along w
+  z = zBase + ty;
+  w = wBase + tx;
+
+  if (z < size.z && w < size.w) {
+    out[z * outStride.z + w * outStride.w] = tile[tx][ty];
+  }
+}
+
 #undef kTileSize
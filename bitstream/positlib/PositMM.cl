@@ -7,6 +7,7 @@
 
 #include "PositConvertRTL.h"
 #include "PositMathRTL.h"
+#include "PositMathCompareRTL.h"
 #include "PositQuireMathRTL.h"
 
 #define kTileSize 32
@@ -14,6 +15,11 @@
 // Performs a batched matrix multiplication:
 // c[i] := a[i] b[i] + beta * c[i]
 // (m x k) x (k x n) = (m x n), row major
+//
+// If beta is not set, c[i] can instead be initialized from a bias vector
+// broadcast along the rows (bias[m], biasMode == kBiasRow) or the columns
+// (bias[n], biasMode == kBiasCol) of c[i]. If relu is set, max(x, 0) is
+// applied to the rounded result before it is written.
 __kernel
 __attribute((max_global_work_dim(0)))
 void positBatchMM8_1(__global FloatType* restrict c,
@@ -33,7 +39,10 @@ void positBatchMM8_1(__global FloatType* restrict c,
                      // typically k * n
                      unsigned int bBatchStride,
                      // typically m * n
-                     unsigned int cBatchStride) {
+                     unsigned int cBatchStride,
+                     __global FloatType* restrict bias,
+                     OpType biasMode,
+                     DeviceBool relu) {
 
   // Round the matrix size up to handle full tiles
   unsigned int mTiles = ((m + kTileSize - 1) / kTileSize);
@@ -57,10 +66,16 @@ void positBatchMM8_1(__global FloatType* restrict c,
             unsigned int nIndex = (blockN * kTileSize) + tileN;
             unsigned int cIndex = mIndex * n + nIndex;
 
-            FloatType oldC = ((mIndex < m) &&
-                           (nIndex < n) &&
-                           (beta != kZeroValue)) ?
-              c[cIndex] : kZeroValue;
+            bool inBounds = (mIndex < m) && (nIndex < n);
+
+            FloatType oldC = kZeroValue;
+            if (inBounds && (beta != kZeroValue)) {
+              oldC = c[cIndex];
+            } else if (inBounds && biasMode == kBiasRow) {
+              oldC = bias[mIndex];
+            } else if (inBounds && biasMode == kBiasCol) {
+              oldC = bias[nIndex];
+            }
 
             acc[tileM][tileN] = positToQuire8_1RTL(oldC, betaScale);
           } // tileN
@@ -189,6 +204,10 @@ void positBatchMM8_1(__global FloatType* restrict c,
                                                outScale,
                                                roundStochastic);
 
+            if (relu) {
+              out = positMax8_1RTL(out, kZeroValue);
+            }
+
             if (mIndex < m && nIndex < n) {
               c[cIndex] = out;
             }
@@ -205,3 +224,108 @@ void positBatchMM8_1(__global FloatType* restrict c,
 }
 
 #undef kTileSize
+
+#define kMVVecs 4
+#define kMVWidth 16
+
+// Performs a batched matrix-vector multiplication with a shared matrix:
+// c[i] := a x[i] + beta * c[i]
+// (m x k) x (k) = (m), row major
+//
+// As with positBatchMM8_1, c[i] can instead be initialized from a bias
+// vector (bias[m]) if beta is not set, and relu applies max(x, 0) to the
+// rounded result. Rather than padding each vector to a full tile, a is
+// streamed once per kMVVecs vectors, kMVWidth elements of a row at a time;
+// the vectors are re-read per row, but are small.
+__kernel
+__attribute((max_global_work_dim(0)))
+void positBatchMV8_1(__global FloatType* restrict c,
+                     __global FloatType* restrict a,
+                     __global FloatType* restrict x,
+                     DeviceBool beta,
+                     char betaScale,
+                     char prodScale,
+                     char outScale,
+                     DeviceBool roundStochastic,
+                     unsigned int numVecs,
+                     unsigned int m,
+                     unsigned int k,
+                     // typically k
+                     unsigned int xBatchStride,
+                     // typically m
+                     unsigned int cBatchStride,
+                     __global FloatType* restrict bias,
+                     DeviceBool useBias,
+                     DeviceBool relu) {
+  unsigned int vecTiles = ((numVecs + kMVVecs - 1) / kMVVecs);
+  unsigned int kTiles = ((k + kMVWidth - 1) / kMVWidth);
+
+  for (unsigned int vt = 0; vt < vecTiles; ++vt) {
+    for (unsigned int row = 0; row < m; ++row) {
+      Accumulator acc[kMVVecs];
+
+#pragma unroll
+      for (unsigned int v = 0; v < kMVVecs; ++v) {
+        unsigned int vec = vt * kMVVecs + v;
+
+        FloatType oldC = kZeroValue;
+        if (vec < numVecs && beta) {
+          oldC = c[vec * cBatchStride + row];
+        } else if (vec < numVecs && useBias) {
+          oldC = bias[row];
+        }
+
+        acc[v] = positToQuire8_1RTL(oldC, betaScale);
+      }
+
+      for (unsigned int kt = 0; kt < kTiles; ++kt) {
+        FloatType av[kMVWidth];
+
+#pragma unroll
+        for (unsigned int w = 0; w < kMVWidth; ++w) {
+          unsigned int kIndex = kt * kMVWidth + w;
+          av[w] = kIndex < k ? a[row * k + kIndex] : kZeroValue;
+        }
+
+#pragma unroll
+        for (unsigned int v = 0; v < kMVVecs; ++v) {
+          unsigned int vec = vt * kMVVecs + v;
+
+          Accumulator part;
+          ACC_ZERO(part);
+
+#pragma unroll
+          for (unsigned int w = 0; w < kMVWidth; ++w) {
+            unsigned int kIndex = kt * kMVWidth + w;
+
+            FloatType xv = (vec < numVecs && kIndex < k) ?
+              x[vec * xBatchStride + kIndex] : kZeroValue;
+
+            Product prod = positQuireMultiply8_1RTL(av[w], xv, prodScale);
+            part = quirePositAdd8_1RTL(prod, part);
+          }
+
+          acc[v] = quireAdd8_1RTL(acc[v], part);
+        }
+      }
+
+#pragma unroll
+      for (unsigned int v = 0; v < kMVVecs; ++v) {
+        unsigned int vec = vt * kMVVecs + v;
+
+        FloatType out = quireToPosit8_1RTL(acc[v], outScale, roundStochastic);
+
+        if (relu) {
+          out = positMax8_1RTL(out, kZeroValue);
+        }
+
+        if (vec < numVecs) {
+          c[vec * cBatchStride + row] = out;
+        }
+      }
+    } // row
+  } // vt
+}
+
+#undef kMVWidth
+#undef kMVVecs
@@ -7,6 +7,7 @@
 #include "PositMathRTL.h"
 #include "PositMathCompareRTL.h"
 #include "PositQuireMathRTL.h"
+#include "PositConvertRTL.h"
 
 #define kTileSize 4
 
@@ -125,8 +126,130 @@ void positReduce8_1(global FloatType* restrict positA,
     minMaxReduce;
 }
 
+// Offset of element i of the row-major index space `size` (w innermost)
+// laid out with `stride`
+inline unsigned int
+stridedOffset(unsigned int i, uint4 size, uint4 stride) {
+  unsigned int off = (i % size.w) * stride.w;
+  i /= size.w;
+  off += (i % size.z) * stride.z;
+  i /= size.z;
+  off += (i % size.y) * stride.y;
+  i /= size.y;
+
+  return off + i * stride.x;
+}
+
+#define kReduceLanes 4
+
+// Reduces a strided tensor over a set of its dimensions. Output o reduces the
+// numReduce elements at
+// stridedOffset(o, outSize, outStride) + stridedOffset(r, reduceSize,
+//                                                      reduceStride)
+// (unused dimensions have size 1). Sums are exact in the quire and rounded
+// once; argmax / argmin also write the index r of the first extremum.
+// kReduceLanes partial reductions are carried independently and combined at
+// the end.
+__kernel
+__attribute((max_global_work_dim(0)))
+void positReduceDim8_1(global FloatType* restrict positA,
+                       uint4 outSize,
+                       uint4 outStride,
+                       uint4 reduceSize,
+                       uint4 reduceStride,
+                       unsigned int numOut,
+                       unsigned int numReduce,
+                       OpType reduceOp,
+                       DeviceBool roundStochastic,
+                       global FloatType* restrict positOut,
+                       global unsigned int* restrict indexOut) {
+  bool isSum = (reduceOp == kReduceSum) || (reduceOp == kReduceSumSquares);
+  bool isMin = (reduceOp == kReduceMin) || (reduceOp == kReduceArgMin);
+
+  unsigned int tiles = (numReduce + kReduceLanes - 1) / kReduceLanes;
+
+  for (unsigned int o = 0; o < numOut; ++o) {
+    unsigned int base = stridedOffset(o, outSize, outStride);
+
+    Accumulator sum[kReduceLanes];
+    FloatType best[kReduceLanes];
+    unsigned int bestIndex[kReduceLanes];
+
+#pragma unroll
+    for (unsigned int j = 0; j < kReduceLanes; ++j) {
+      ACC_ZERO(sum[j]);
+      best[j] = kZeroValue;
+      bestIndex[j] = j;
+    }
+
+    for (unsigned int t = 0; t < tiles; ++t) {
+#pragma unroll
+      for (unsigned int j = 0; j < kReduceLanes; ++j) {
+        unsigned int r = t * kReduceLanes + j;
+
+        if (r < numReduce) {
+          FloatType v =
+            positA[base + stridedOffset(r, reduceSize, reduceStride)];
+
+          // Both are formed outside of a branch; see positReduce8_1
+          Product pv = positQuireConvert8_1RTL(v, (char) 0);
+          Product pv2 = positQuireMultiply8_1RTL(v, v, (char) 0);
+          sum[j] = quirePositAdd8_1RTL(
+            (reduceOp == kReduceSumSquares) ? pv2 : pv, sum[j]);
+
+          // A lane sees increasing r, so it keeps its first extremum
+          DeviceBool better = isMin ?
+            positComp8_1RTL(v, best[j], kComp_LT) :
+            positComp8_1RTL(v, best[j], kComp_GT);
+
+          if (t == 0 || better) {
+            best[j] = v;
+            bestIndex[j] = r;
+          }
+        }
+      }
+    }
+
+    Accumulator total;
+    ACC_ZERO(total);
+
+    FloatType extremum = best[0];
+    unsigned int extremumIndex = bestIndex[0];
+
+#pragma unroll
+    for (unsigned int j = 0; j < kReduceLanes; ++j) {
+      total = quireAdd8_1RTL(sum[j], total);
+
+      if (j > 0 && j < numReduce) {
+        DeviceBool better = isMin ?
+          positComp8_1RTL(best[j], extremum, kComp_LT) :
+          positComp8_1RTL(best[j], extremum, kComp_GT);
+        DeviceBool earlier =
+          positComp8_1RTL(best[j], extremum, kComp_EQ) &&
+          (bestIndex[j] < extremumIndex);
+
+        if (better || earlier) {
+          extremum = best[j];
+          extremumIndex = bestIndex[j];
+        }
+      }
+    }
+
+    positOut[o] = isSum ?
+      quireToPosit8_1RTL(total, (char) 0, roundStochastic) :
+      extremum;
+
+    if ((reduceOp == kReduceArgMax) || (reduceOp == kReduceArgMin)) {
+      indexOut[o] = extremumIndex;
+    }
+  }
+}
+
+#undef kReduceLanes
+
 // Exact multiply-add:
 // out_i = c(_i) (+|-) a(_i) * b_i
+// or max(out_i, 0) if relu is set
 // Some of A, B, C and out may in fact be the same, but there are no write
 // dependencies between them, so we mark them all as __restrict
 #define kTileSize 4
@@ -148,6 +271,7 @@ void positMulAdd8_1(global FloatType* restrict positC,
                     DeviceBool subtract,
                     DeviceBool roundStochastic,
                     char scaleOut,
+                    DeviceBool relu,
 
                     unsigned int n,
                     global FloatType* restrict positOut) {
@@ -183,9 +307,228 @@ void positMulAdd8_1(global FloatType* restrict positC,
       Product prod = positQuireMultiply8_1RTL(pa, positB[i], scaleAB);
       acc = quirePositAdd8_1RTL(prod, acc);
 
-      positOut[i] = quireToPosit8_1RTL(acc, scaleOut, roundStochastic);
+      FloatType pout = quireToPosit8_1RTL(acc, scaleOut, roundStochastic);
+      if (relu) {
+        pout = positMax8_1RTL(pout, kZeroValue);
+      }
+
+      positOut[i] = pout;
+    }
+  }
+}
+
+// One step of SGD with momentum:
+// v = momentum * v + grad
+// param = param - lr * v
+// The momentum buffer is either of FloatType (kMomentumNarrow) or float
+// (kMomentumWide). A float v enters the quire as the sum of its two
+// nearest FloatType terms, so the parameter sees it at about twice our
+// precision. Each stored result is rounded once.
+__kernel
+__attribute((max_global_work_dim(0)))
+void positSGD8_1(global FloatType* restrict param,
+                 global FloatType* restrict grad,
+                 global FloatType* restrict momentumBuf,
+                 global unsigned int* restrict wideMomentumBuf,
+                 OpType momentumMode,
+                 float lr,
+                 float momentum,
+                 DeviceBool roundStochastic,
+                 unsigned int n) {
+  FloatType negLr = floatToPosit8_1RTL(as_uint(-lr), (char) 0);
+  FloatType momentumP = floatToPosit8_1RTL(as_uint(momentum), (char) 0);
+
+  unsigned int tiles = ((n + kTileSize - 1) / kTileSize);
+
+  for (unsigned int t = 0; t < tiles; ++t) {
+#pragma unroll
+    for (unsigned int j = 0; j < kTileSize; ++j) {
+      unsigned int i = t * kTileSize + j;
+
+      if (i < n) {
+        FloatType g = grad[i];
+
+        // The step taken is -lr * (vHi + vLo)
+        FloatType vHi = g;
+        FloatType vLo = kZeroValue;
+
+        if (momentumMode == kMomentumNarrow) {
+          // v = momentum * v + g
+          Accumulator accV = positToQuire8_1RTL(g, (char) 0);
+          Product prodV =
+            positQuireMultiply8_1RTL(momentumP, momentumBuf[i], (char) 0);
+          accV = quirePositAdd8_1RTL(prodV, accV);
+
+          vHi = quireToPosit8_1RTL(accV, (char) 0, roundStochastic);
+
+          momentumBuf[i] = vHi;
+        } else if (momentumMode == kMomentumWide) {
+          float v = momentum * as_float(wideMomentumBuf[i]) +
+            as_float(positToFloat8_1RTL(g, (char) 0));
+          wideMomentumBuf[i] = as_uint(v);
+
+          vHi = floatToPosit8_1RTL(as_uint(v), (char) 0);
+          vLo = floatToPosit8_1RTL(
+            as_uint(v - as_float(positToFloat8_1RTL(vHi, (char) 0))), (char) 0);
+        }
+
+        // param = param - lr * v
+        Accumulator acc = positToQuire8_1RTL(param[i], (char) 0);
+
+        Product prodHi = positQuireMultiply8_1RTL(negLr, vHi, (char) 0);
+        acc = quirePositAdd8_1RTL(prodHi, acc);
+
+        Product prodLo = positQuireMultiply8_1RTL(negLr, vLo, (char) 0);
+        acc = quirePositAdd8_1RTL(prodLo, acc);
+
+        param[i] = quireToPosit8_1RTL(acc, (char) 0, roundStochastic);
+      }
+    }
+  }
+}
+
+#define kFuncTableSize (1 << TYPE_WIDTH)
+
+// Row-wise log-softmax over input [rows][cols], and optionally the NLL loss
+// and its gradient for the class target[r] of each row r.
+// funcTable holds exp, ln and 1/x of every encoding in turn, as computed by
+// positSpecialFunc8_1; they are looked up on chip.
+// The max and the sum of exp(x - max) are found in one pass: the sum is
+// exact in the quire between updates of the max, each of which rounds it
+// once to rescale by exp(oldMax - newMax). A second pass writes
+// round(x - (max + ln(sum))), with max + ln(sum) held in the quire.
+// With a target, loss[r] = -scale * out[r][target[r]] and
+// gradInput[r][j] = scale * (exp(out[r][j]) - (j == target[r])), where scale
+// is weight[target[r]] (1 without weights), divided by the sum of it over the
+// rows if sizeAverage.
+__kernel
+__attribute((max_global_work_dim(0)))
+void positLogSoftmax8_1(global FloatType* restrict input,
+                        global FloatType* restrict funcTable,
+                        global unsigned int* restrict target,
+                        global FloatType* restrict weight,
+                        DeviceBool useTarget,
+                        DeviceBool useWeight,
+                        DeviceBool sizeAverage,
+                        DeviceBool useGrad,
+                        DeviceBool roundStochastic,
+                        unsigned int rows,
+                        unsigned int cols,
+                        global FloatType* restrict output,
+                        global FloatType* restrict loss,
+                        global FloatType* restrict gradInput) {
+  FloatType expTable[kFuncTableSize];
+  FloatType lnTable[kFuncTableSize];
+  FloatType invTable[kFuncTableSize];
+
+  for (unsigned int i = 0; i < kFuncTableSize; ++i) {
+    expTable[i] = funcTable[i];
+    lnTable[i] = funcTable[kFuncTableSize + i];
+    invTable[i] = funcTable[2 * kFuncTableSize + i];
+  }
+
+  FloatType one = floatToPosit8_1RTL(as_uint(1.0f), (char) 0);
+
+  FloatType invTotalWeight = one;
+
+  if (useTarget && sizeAverage) {
+    Accumulator accW;
+    ACC_ZERO(accW);
+
+    for (unsigned int r = 0; r < rows; ++r) {
+      FloatType w = useWeight ? weight[target[r]] : one;
+      accW = quirePositAdd8_1RTL(positQuireConvert8_1RTL(w, (char) 0), accW);
+    }
+
+    invTotalWeight = invTable[quireToPosit8_1RTL(accW, (char) 0, kDeviceFalse)];
+  }
+
+  for (unsigned int r = 0; r < rows; ++r) {
+    global FloatType* inRow = input + r * cols;
+    global FloatType* outRow = output + r * cols;
+    global FloatType* gradRow = gradInput + r * cols;
+
+    // exp(x_0 - x_0) = 1
+    FloatType maxV = inRow[0];
+    Accumulator accSum = positToQuire8_1RTL(one, (char) 0);
+
+    for (unsigned int c = 1; c < cols; ++c) {
+      FloatType v = inRow[c];
+
+      if (positComp8_1RTL(v, maxV, kComp_GT)) {
+        // sum = sum * exp(maxV - v) + exp(v - v)
+        FloatType sum = quireToPosit8_1RTL(accSum, (char) 0, kDeviceFalse);
+        FloatType rescale =
+          expTable[positAdd8_1RTL(maxV, v, kDeviceTrue, kDeviceFalse)];
+
+        accSum = positToQuire8_1RTL(one, (char) 0);
+        accSum = quirePositAdd8_1RTL(
+          positQuireMultiply8_1RTL(sum, rescale, (char) 0), accSum);
+
+        maxV = v;
+      } else {
+        FloatType e =
+          expTable[positAdd8_1RTL(v, maxV, kDeviceTrue, kDeviceFalse)];
+        accSum = quirePositAdd8_1RTL(positQuireConvert8_1RTL(e, (char) 0),
+                                     accSum);
+      }
+    }
+
+    // -(max + ln(sum))
+    FloatType lnSum =
+      lnTable[quireToPosit8_1RTL(accSum, (char) 0, kDeviceFalse)];
+
+    Accumulator negLse = positToQuire8_1RTL(NEG_FLOAT(maxV), (char) 0);
+    negLse = quirePositAdd8_1RTL(
+      positQuireConvert8_1RTL(NEG_FLOAT(lnSum), (char) 0), negLse);
+
+    unsigned int t = useTarget ? target[r] : 0;
+
+    FloatType scale = one;
+    if (useTarget) {
+      FloatType w = useWeight ? weight[t] : one;
+
+      Accumulator accScale;
+      ACC_ZERO(accScale);
+      accScale = quirePositAdd8_1RTL(
+        positQuireMultiply8_1RTL(w, invTotalWeight, (char) 0), accScale);
+
+      scale = quireToPosit8_1RTL(accScale, (char) 0, kDeviceFalse);
+    }
+
+    for (unsigned int c = 0; c < cols; ++c) {
+      Accumulator acc = quirePositAdd8_1RTL(
+        positQuireConvert8_1RTL(inRow[c], (char) 0), negLse);
+
+      FloatType out = quireToPosit8_1RTL(acc, (char) 0, roundStochastic);
+      outRow[c] = out;
+
+      if (useTarget && c == t) {
+        Accumulator accLoss;
+        ACC_ZERO(accLoss);
+        accLoss = quirePositAdd8_1RTL(
+          positQuireMultiply8_1RTL(NEG_FLOAT(scale), out, (char) 0), accLoss);
+
+        loss[r] = quireToPosit8_1RTL(accLoss, (char) 0, roundStochastic);
+      }
+
+      if (useGrad) {
+        Accumulator accGrad;
+        ACC_ZERO(accGrad);
+        accGrad = quirePositAdd8_1RTL(
+          positQuireMultiply8_1RTL(scale, expTable[out], (char) 0), accGrad);
+
+        if (c == t) {
+          accGrad = quirePositAdd8_1RTL(
+            positQuireConvert8_1RTL(NEG_FLOAT(scale), (char) 0), accGrad);
+        }
+
+        gradRow[c] = quireToPosit8_1RTL(accGrad, (char) 0, roundStochastic);
+      }
     }
   }
 }
 
+#undef kFuncTableSize
+
 #undef kTileSize
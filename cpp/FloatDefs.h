@@ -91,6 +91,24 @@ constexpr OpType kMathOp_Div = 3;
 constexpr OpType kMathOp_Min = 4;
 constexpr OpType kMathOp_Max = 5;
 
+/// Matrix multiply bias broadcast options
+constexpr OpType kBiasNone = 0;
+constexpr OpType kBiasRow = 1;
+constexpr OpType kBiasCol = 2;
+
+/// SGD momentum buffer options
+constexpr OpType kMomentumNone = 0;
+constexpr OpType kMomentumNarrow = 1;
+constexpr OpType kMomentumWide = 2;
+
+/// Reduction options
+constexpr OpType kReduceSum = 0;
+constexpr OpType kReduceMin = 1;
+constexpr OpType kReduceMax = 2;
+constexpr OpType kReduceArgMin = 3;
+constexpr OpType kReduceArgMax = 4;
+constexpr OpType kReduceSumSquares = 5;
+
 /// Comparison options
 /// FIXME: remove
 constexpr OpType kComp_EQ = 0;
@@ -9,12 +9,22 @@
 
 #include "TorchUtils.h"
 #include "FloatDefs.h"
+#include "bench/Benchmark.h"
+#include "engine/DevicePool.h"
+#include "engine/InferenceEngine.h"
+#include "engine/PipelineEngine.h"
+#include "engine/SGD.h"
 #include "layers/Add.h"
 #include "layers/Conv2d.h"
+#include "layers/GraphPass.h"
 #include "layers/Linear.h"
 #include "layers/Pool2d.h"
 #include "layers/ReLU.h"
+#include "layers/ResNet.h"
 #include "layers/View.h"
+#include "ops/TensorInspect.h"
+#include "utils/Profiler.h"
+#include "verify/Verify.h"
 
 namespace facebook { namespace cl {
 
@@ -52,6 +62,60 @@ fpga_init(const std::string& dir,
   return createOpenCLProgram(lib.c_str());
 }
 
+std::vector<size_t>
+torchSizes(at::Tensor& t) {
+  std::vector<size_t> sizes(t.ndimension());
+  for (int i = 0; i < t.ndimension(); ++i) {
+    sizes[i] = (size_t) t.sizes()[i];
+  }
+
+  return sizes;
+}
+
+at::Tensor
+hostVectorToTorch(const std::vector<float>& v,
+                  const std::vector<size_t>& sizes) {
+  std::vector<int64_t> torchSizes;
+  for (auto s : sizes) {
+    torchSizes.push_back((int64_t) s);
+  }
+
+  return torch::CPU(at::kFloat).
+    tensorFromBlob(const_cast<float*>(v.data()), torchSizes).clone();
+}
+
+size_t
+engineSubmit(InferenceEngine& engine, at::Tensor& t) {
+  CL_ASSERT(t.is_contiguous());
+  return engine.submit(t.data<float>(), torchSizes(t));
+}
+
+at::Tensor
+engineRetrieve(InferenceEngine& engine) {
+  auto& out = engine.retrieve();
+  return hostVectorToTorch(out, engine.getOutputSizes());
+}
+
+void
+poolSubmit(DevicePool& pool, at::Tensor& t) {
+  CL_ASSERT(t.is_contiguous());
+  pool.submit(t.data<float>(), torchSizes(t));
+}
+
+at::Tensor
+poolRetrieve(DevicePool& pool) {
+  auto& out = pool.retrieve();
+  return hostVectorToTorch(out, pool.getOutputSizes());
+}
+
+at::Tensor
+pipelineForward(PipelineEngine& engine, at::Tensor& t, int numMicroBatches) {
+  CL_ASSERT(t.is_contiguous());
+  auto& out = engine.forward(t.data<float>(), torchSizes(t), numMicroBatches);
+
+  return hostVectorToTorch(out, engine.getOutputSizes());
+}
+
 PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
   m.def("fpga_init",
         &fpga_init,
@@ -89,6 +153,14 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
     .value("Vector", ScalarOp::Vector)
     .value("Scalar", ScalarOp::Scalar);
 
+  py::enum_<ReduceOp>(m, "ReduceOp", py::arithmetic())
+    .value("Sum", ReduceOp::Sum)
+    .value("Min", ReduceOp::Min)
+    .value("Max", ReduceOp::Max)
+    .value("ArgMin", ReduceOp::ArgMin)
+    .value("ArgMax", ReduceOp::ArgMax)
+    .value("SumSquares", ReduceOp::SumSquares);
+
   py::enum_<CompareOp>(m, "CompareOp", py::arithmetic())
     .value("EQ", CompareOp::EQ)
     .value("NE", CompareOp::NE)
@@ -118,6 +190,29 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
     .def("forward", &Linear::forward)
     .def("str", &Linear::str);
 
+  // KernelGeometry(kH, kW, strideH, strideW, padT, padB, padL, padR,
+  // dilationH, dilationW)
+  py::class_<KernelGeometry>(m, "KernelGeometry")
+    .def(py::init([](int kH, int kW,
+                     int strideH, int strideW,
+                     int padT, int padB, int padL, int padR,
+                     int dilationH, int dilationW) {
+           return KernelGeometry{kH, kW, strideH, strideW,
+               padT, padB, padL, padR, dilationH, dilationW};
+         }))
+    .def_static("square", &KernelGeometry::square)
+    .def_readwrite("kH", &KernelGeometry::kH)
+    .def_readwrite("kW", &KernelGeometry::kW)
+    .def_readwrite("strideH", &KernelGeometry::strideH)
+    .def_readwrite("strideW", &KernelGeometry::strideW)
+    .def_readwrite("padT", &KernelGeometry::padT)
+    .def_readwrite("padB", &KernelGeometry::padB)
+    .def_readwrite("padL", &KernelGeometry::padL)
+    .def_readwrite("padR", &KernelGeometry::padR)
+    .def_readwrite("dilationH", &KernelGeometry::dilationH)
+    .def_readwrite("dilationW", &KernelGeometry::dilationW)
+    .def("str", &KernelGeometry::str);
+
   py::class_<Conv2d>(m, "Conv2d")
     .def(py::init<Context&,
          Program&,
@@ -131,6 +226,31 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
          bool,
          int,
          int>())
+    .def(py::init<Context&,
+         Program&,
+         Queue&,
+         int,
+         int,
+         int,
+         int,
+         int,
+         int,
+         bool,
+         int,
+         int,
+         int>())
+    .def(py::init<Context&,
+         Program&,
+         Queue&,
+         int,
+         int,
+         const KernelGeometry&,
+         bool,
+         int,
+         int,
+         int>())
+    .def("getGeometry", &Conv2d::getGeometry)
+    .def("getGroups", &Conv2d::getGroups)
     .def("setRoundMode", &Conv2d::setRoundMode)
     .def("setOutputScale", &Conv2d::setOutputScale)
     .def("setInputScale", &Conv2d::setInputScale)
@@ -138,6 +258,11 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
     .def("getInputScale", &Conv2d::getInputScale)
     .def("setWeight", &Conv2d::setWeight)
     .def("setBias", &Conv2d::setBias)
+    .def("setFuseReLU", &Conv2d::setFuseReLU)
+    .def("getFuseReLU", &Conv2d::getFuseReLU)
+    .def("canUseWinograd", &Conv2d::canUseWinograd)
+    .def("setWinograd", &Conv2d::setWinograd)
+    .def("getWinograd", &Conv2d::getWinograd)
     .def("getInput", &Conv2d::getInput)
     .def("getOutput", &Conv2d::getOutput)
     .def("forward", &Conv2d::forward)
@@ -158,6 +283,13 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
          PoolOp,
          int,
          int>())
+    .def(py::init<Context&,
+         Program&,
+         Queue&,
+         const KernelGeometry&,
+         PoolOp,
+         int,
+         int>())
     .def("setRoundMode", &Pool2d::setRoundMode)
     .def("setOutputScale", &Pool2d::setOutputScale)
     .def("setInputScale", &Pool2d::setInputScale)
@@ -191,6 +323,8 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
     .def("getInputScale", &Add::getInputScale)
     .def("setAddScale", &Add::setAddScale)
     .def("getAddScale", &Add::getAddScale)
+    .def("setFuseReLU", &Add::setFuseReLU)
+    .def("getFuseReLU", &Add::getFuseReLU)
     .def("getInput", &Add::getInput)
     .def("getOutput", &Add::getOutput)
     .def("forward", &Add::forward)
@@ -207,7 +341,317 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
     .def("getOutput", &View::getOutput)
     .def("str", &View::str);
 
+  py::enum_<Layout>(m, "Layout", py::arithmetic())
+    .value("NCHW", Layout::NCHW)
+    .value("NHWC", Layout::NHWC);
+
+  py::enum_<ResNetBlockType>(m, "ResNetBlockType", py::arithmetic())
+    .value("Basic", ResNetBlockType::Basic)
+    .value("Bottleneck", ResNetBlockType::Bottleneck);
+
+  py::class_<Layer>(m, "Layer");
+
+  py::class_<Graph, Layer>(m, "Graph")
+    .def("setRoundMode", &Graph::setRoundMode)
+    .def("setLayout", &Graph::setLayout)
+    .def("getLayout", &Graph::getLayout)
+    .def("forward", &Graph::forward)
+    .def("numNodes", &Graph::numNodes)
+    .def("isBypassed", &Graph::isBypassed)
+    .def("getOutput", &Graph::getOutput)
+    .def("str", &Graph::str);
+
+  py::class_<GraphPassResult>(m, "GraphPassResult")
+    .def_readonly("pass_name", &GraphPassResult::pass)
+    .def_readonly("rewrites", &GraphPassResult::rewrites)
+    .def_readonly("mismatches", &GraphPassResult::mismatches)
+    .def_readonly("num_elements", &GraphPassResult::numElements);
+
+  // `verify_input` may be None to skip comparing against the unfused graph
+  m.def("optimize_graph",
+        [](Context& context,
+           Program& program,
+           Queue& queue,
+           Graph& graph,
+           const CLTensor<facebook::FloatType<facebook::kWidth>::T>* in) {
+          return optimizeGraph(context, program, queue, graph, in);
+        },
+        "optimize_graph");
+
+  // Switches every eligible convolution of `graph` to Winograd, reporting
+  // the mismatches this causes on `verify_input` (which may be None)
+  m.def("winograd_graph",
+        [](Context& context,
+           Program& program,
+           Queue& queue,
+           Graph& graph,
+           const CLTensor<facebook::FloatType<facebook::kWidth>::T>* in) {
+          std::vector<std::unique_ptr<GraphPass>> passes;
+          passes.emplace_back(new WinogradConvPass);
+
+          return runGraphPasses(context, program, queue, graph, passes, in);
+        },
+        "winograd_graph");
+
+  py::class_<ResNet, Graph>(m, "ResNet")
+    .def(py::init<Context&,
+         Program&,
+         Queue&,
+         ResNetBlockType,
+         const std::vector<int>&,
+         int,
+         int,
+         int>())
+    .def("hasPart", &ResNet::hasPart)
+    .def("setRoundMode", &ResNet::setRoundMode)
+    .def("setLayout", &ResNet::setLayout)
+    .def("getLayout", &ResNet::getLayout)
+    .def("forward", &ResNet::forward)
+    .def("getConv1", &ResNet::getConv1,
+         py::return_value_policy::reference_internal)
+    .def("getReLU", &ResNet::getReLU,
+         py::return_value_policy::reference_internal)
+    .def("getMaxPool", &ResNet::getMaxPool,
+         py::return_value_policy::reference_internal)
+    .def("getAvgPool", &ResNet::getAvgPool,
+         py::return_value_policy::reference_internal)
+    .def("getView", &ResNet::getView,
+         py::return_value_policy::reference_internal)
+    .def("getFc", &ResNet::getFc,
+         py::return_value_policy::reference_internal)
+    .def("numStages", &ResNet::numStages)
+    .def("numBlocks", &ResNet::numBlocks)
+    .def("getBlockConv", &ResNet::getBlockConv,
+         py::return_value_policy::reference_internal)
+    .def("getBlockReLU", &ResNet::getBlockReLU,
+         py::return_value_policy::reference_internal)
+    .def("hasBlockDownsample", &ResNet::hasBlockDownsample)
+    .def("getBlockDownsample", &ResNet::getBlockDownsample,
+         py::return_value_policy::reference_internal)
+    .def("getBlockAdd", &ResNet::getBlockAdd,
+         py::return_value_policy::reference_internal)
+    .def("getOutput", &ResNet::getOutput)
+    .def("str", &ResNet::str);
+
+  py::class_<InferenceEngine>(m, "InferenceEngine")
+    .def(py::init<Context&,
+         Program&,
+         Queue&,
+         Layer&,
+         int>(),
+         py::keep_alive<1, 2>(),
+         py::keep_alive<1, 3>(),
+         py::keep_alive<1, 4>(),
+         py::keep_alive<1, 5>())
+    .def("getDepth", &InferenceEngine::getDepth)
+    .def("numInFlight", &InferenceEngine::numInFlight)
+    .def("submit", &engineSubmit)
+    .def("retrieve", &engineRetrieve)
+    .def("reset", &InferenceEngine::reset);
+
+  py::class_<SGD>(m, "SGD")
+    .def(py::init<Context&,
+         Program&,
+         Queue&,
+         Layer&,
+         float,
+         float,
+         bool>(),
+         py::arg("context"),
+         py::arg("program"),
+         py::arg("queue"),
+         py::arg("model"),
+         py::arg("lr"),
+         py::arg("momentum") = 0.0f,
+         py::arg("wide_momentum") = false,
+         py::keep_alive<1, 2>(),
+         py::keep_alive<1, 3>(),
+         py::keep_alive<1, 4>(),
+         py::keep_alive<1, 5>())
+    .def("setLearningRate", &SGD::setLearningRate)
+    .def("getLearningRate", &SGD::getLearningRate)
+    .def("getMomentum", &SGD::getMomentum)
+    .def("setRoundMode", &SGD::setRoundMode)
+    .def("getRoundMode", &SGD::getRoundMode)
+    .def("zeroGrad", &SGD::zeroGrad)
+    .def("step", &SGD::step);
+
+  // Devices are selected by platform name, e.g. "FPGA"; `cpu` selects CPU
+  // rather than accelerator devices
+  py::class_<DevicePool>(m, "DevicePool")
+    .def(py::init([](const std::string& platform,
+                     const std::string& binaryFile,
+                     int maxDevices,
+                     bool cpu) {
+                    return new DevicePool(platform,
+                                          cpu ? CL_DEVICE_TYPE_CPU :
+                                          CL_DEVICE_TYPE_ALL,
+                                          binaryFile,
+                                          maxDevices);
+                  }))
+    .def("numDevices", &DevicePool::numDevices)
+    .def("getContext", &DevicePool::getContext,
+         py::return_value_policy::reference_internal)
+    .def("getProgram", &DevicePool::getProgram,
+         py::return_value_policy::reference_internal)
+    .def("getQueue", &DevicePool::getQueue,
+         py::return_value_policy::reference_internal)
+    .def("setModel", &DevicePool::setModel,
+         py::keep_alive<1, 3>())
+    .def("getDepth", &DevicePool::getDepth)
+    .def("numInFlight", &DevicePool::numInFlight)
+    .def("getThroughputs", &DevicePool::getThroughputs)
+    .def("submit", &poolSubmit)
+    .def("retrieve", &poolRetrieve);
+
+  py::class_<PipelineEngine>(m, "PipelineEngine")
+    .def(py::init<>())
+    .def("addStage", &PipelineEngine::addStage,
+         py::keep_alive<1, 2>(),
+         py::keep_alive<1, 3>(),
+         py::keep_alive<1, 4>(),
+         py::keep_alive<1, 5>())
+    .def("numStages", &PipelineEngine::numStages)
+    .def("forward", &pipelineForward);
+
+  py::class_<ProfileLayerStats>(m, "ProfileLayerStats")
+    .def_readonly("scope", &ProfileLayerStats::scope)
+    .def_readonly("launches", &ProfileLayerStats::launches)
+    .def_readonly("device_time", &ProfileLayerStats::deviceTime)
+    .def_readonly("wall_time", &ProfileLayerStats::wallTime)
+    .def_readonly("bytes", &ProfileLayerStats::bytes);
+
+  m.def("profiler_enable",
+        [](bool enable) { Profiler::get().enable(enable); },
+        "profiler_enable");
+  m.def("profiler_clear",
+        []() { Profiler::get().clear(); },
+        "profiler_clear");
+  m.def("profiler_layer_stats",
+        []() { return Profiler::get().getLayerStats(); },
+        "profiler_layer_stats");
+  m.def("profiler_write_trace",
+        [](const std::string& file) {
+          Profiler::get().writeChromeTrace(file);
+        },
+        "profiler_write_trace");
+
+  py::class_<TensorStats>(m, "TensorStats")
+    .def_readonly("num_elements", &TensorStats::numElements)
+    .def_readonly("min", &TensorStats::min)
+    .def_readonly("max", &TensorStats::max)
+    .def_readonly("mean", &TensorStats::mean)
+    .def_readonly("zeros", &TensorStats::zeros)
+    .def_readonly("saturated", &TensorStats::saturated)
+    .def_readonly("infs", &TensorStats::infs)
+    .def_readonly("min_exponent", &TensorStats::minExponent)
+    .def_readonly("exponent_histogram", &TensorStats::exponentHistogram);
+
+  py::class_<InspectRecord>(m, "InspectRecord")
+    .def_readonly("layer", &InspectRecord::layer)
+    .def_readonly("tag", &InspectRecord::tag)
+    .def_readonly("sizes", &InspectRecord::sizes)
+    .def_readonly("stats", &InspectRecord::stats);
+
+  m.def("inspector_enable",
+        [](bool enable) { Inspector::get().enable(enable); },
+        "inspector_enable");
+  m.def("inspector_set_filter",
+        [](const std::string& filter) { Inspector::get().setFilter(filter); },
+        "inspector_set_filter");
+  m.def("inspector_print",
+        [](bool print) {
+          static int id = -1;
+
+          if (print && id < 0) {
+            id = Inspector::get().addHook(printInspectHook());
+          } else if (!print && id >= 0) {
+            Inspector::get().removeHook(id);
+            id = -1;
+          }
+
+          // Only print
+          Inspector::get().setRecord(!print);
+        },
+        "inspector_print");
+  m.def("inspector_clear",
+        []() { Inspector::get().clear(); },
+        "inspector_clear");
+  m.def("inspector_records",
+        [](Context& context, Program& program, Queue& queue) {
+          return Inspector::get().getRecords(context, program, queue);
+        },
+        "inspector_records");
+  m.def("inspector_summary",
+        [](Context& context, Program& program, Queue& queue) {
+          return inspectRecordsToString(
+            Inspector::get().getRecords(context, program, queue));
+        },
+        "inspector_summary");
+
+  py::class_<BenchResult>(m, "BenchResult")
+    .def_readonly("op", &BenchResult::op)
+    .def_readonly("shape", &BenchResult::shape)
+    .def_readonly("ops", &BenchResult::ops)
+    .def_readonly("bytes", &BenchResult::bytes)
+    .def_readonly("device_ms", &BenchResult::deviceMs)
+    .def_readonly("wall_ms", &BenchResult::wallMs)
+    .def_readonly("iters", &BenchResult::iters)
+    .def_readonly("host_timed", &BenchResult::hostTimed)
+    .def("ms", &BenchResult::ms)
+    .def("gops", &BenchResult::gops)
+    .def("bytes_per_sec", &BenchResult::bytesPerSec)
+    .def("intensity", &BenchResult::intensity);
+
+  m.def("bench_all", &benchAll, "bench_all");
+  m.def("bench_convert_all", &benchConvertAll, "bench_convert_all");
+  m.def("bench_mm",
+        [](Context& context, Program& program, Queue& queue,
+           size_t batch, size_t m, size_t n, size_t k, int iters) {
+          MMShape s;
+          s.name = std::to_string(batch) + "x" + std::to_string(m) + "x" +
+            std::to_string(n) + "x" + std::to_string(k);
+          s.batch = batch;
+          s.m = m;
+          s.n = n;
+          s.k = k;
+          s.count = 1;
+
+          return benchMM(context, program, queue, s, iters);
+        },
+        "bench_mm");
+  m.def("bench_results_to_json", &benchResultsToJson, "bench_results_to_json");
+
+  py::enum_<RandomMode>(m, "RandomMode", py::arithmetic())
+    .value("Philox", RandomMode::Philox)
+    .value("LFSR", RandomMode::LFSR);
+
+  py::enum_<ConvertPath>(m, "ConvertPath", py::arithmetic())
+    .value("Device", ConvertPath::Device)
+    .value("HostTable", ConvertPath::HostTable);
+
+  m.def("get_convert_path", &getConvertPath, "get_convert_path");
+  m.def("set_convert_path", &setConvertPath, "set_convert_path");
+  m.def("select_convert_path", &selectConvertPath, "select_convert_path");
+
+  py::class_<VerifyResult>(m, "VerifyResult")
+    .def_readonly("op", &VerifyResult::op)
+    .def_readonly("skipped", &VerifyResult::skipped)
+    .def_readonly("tested", &VerifyResult::tested)
+    .def_readonly("mismatches", &VerifyResult::mismatches)
+    .def("passed", &VerifyResult::passed);
+
+  m.def("verify_all", &verifyAll, "verify_all");
+  m.def("verify_results_to_string",
+        &verifyResultsToString,
+        "verify_results_to_string");
+
   m.def("to_posit", &torchToDevicePosit, "to_posit");
+  m.def("to_posit_stochastic", &torchToDevicePositStochastic,
+        py::arg("context"), py::arg("program"), py::arg("queue"),
+        py::arg("t"), py::arg("seed"),
+        py::arg("mode") = RandomMode::Philox,
+        "to_posit_stochastic");
   m.def("to_float", &devicePositToTorch, "to_float");
   m.def("to_host_posit", &devicePositToTorchPosit, "to_host_posit");
 
@@ -220,6 +664,71 @@ PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
          facebook::kWidth>::T>&, ScalarOp>());
 
   m.def("reduce", &facebook::cl::runReduce, "reduce");
+  // (values, indices) of the k largest values of each row; only these are
+  // downloaded
+  m.def("topk",
+        [](Context& context, Program& program, Queue& queue,
+           const CLTensor<facebook::FloatType<facebook::kWidth>::T>& a,
+           size_t k) {
+          auto rows = a.dims() == 1 ? (size_t) 1 : a.getSize(0);
+          std::vector<size_t> sizes = a.dims() == 1 ?
+            std::vector<size_t>{k} : std::vector<size_t>{rows, k};
+
+          CLTensor<facebook::FloatType<facebook::kWidth>::T> values(
+            context, sizes);
+          CLTensor<unsigned int> indices(
+            context, std::vector<size_t>{rows * k});
+
+          runTopK(context, program, queue, a, k, values, indices);
+
+          auto hostIndices = indices.toHost<1>(queue);
+
+          std::vector<int64_t> torchSizes(sizes.begin(), sizes.end());
+          auto torchIndices = torch::CPU(at::kLong).zeros(torchSizes);
+
+          auto indexData = torchIndices.data<int64_t>();
+          for (size_t i = 0; i < rows * k; ++i) {
+            indexData[i] = (int64_t) hostIndices.data()[i];
+          }
+
+          return std::make_tuple(
+            devicePositToTorch(context, program, queue, values),
+            torchIndices);
+        },
+        "topk");
+  // Returns the indices for ArgMin / ArgMax (as int64, of the size of out),
+  // else an empty tensor
+  m.def("reduce_dim",
+        [](Context& context, Program& program, Queue& queue,
+           const CLTensor<facebook::FloatType<facebook::kWidth>::T>& a,
+           const std::vector<int>& dims,
+           ReduceOp reduceOp,
+           RoundOp rounding,
+           CLTensor<facebook::FloatType<facebook::kWidth>::T>& out) {
+          if (reduceOp != ReduceOp::ArgMin && reduceOp != ReduceOp::ArgMax) {
+            runReduceDim(context, program, queue,
+                         a, dims, reduceOp, rounding, out);
+            return at::Tensor();
+          }
+
+          CLTensor<unsigned int> index(
+            context, std::vector<size_t>{out.numElements()});
+          runReduceDim(context, program, queue,
+                       a, dims, reduceOp, rounding, out, &index);
+
+          auto hostIndex = index.toHost<1>(queue);
+
+          std::vector<int64_t> sizes(out.sizes().begin(), out.sizes().end());
+          auto ret = torch::CPU(at::kLong).zeros(sizes);
+
+          auto retData = ret.data<int64_t>();
+          for (size_t i = 0; i < out.numElements(); ++i) {
+            retData[i] = (int64_t) hostIndex.data()[i];
+          }
+
+          return ret;
+        },
+        "reduce_dim");
   m.def("mm", &facebook::cl::runMM, "mm");
   m.def("mul_add", &facebook::cl::runMulAdd, "mul_add");
   m.def("binary_math", &facebook::cl::runBinaryMath, "binary_math");
@@ -141,4 +141,29 @@ torchToDevicePosit(Context& context,
   return toDevicePosit(context, program, queue, ft);
 }
 
+// Rounded stochastically on the host; the result only depends on `seed`
+inline CLTensor<FloatType<kWidth>::T>
+torchToDevicePositStochastic(Context& context,
+                             Program& program,
+                             Queue& queue,
+                             at::Tensor& t,
+                             uint64_t seed,
+                             RandomMode mode) {
+  CL_ASSERT(t.is_contiguous());
+
+  std::vector<size_t> sizes(t.ndimension());
+  for (int i = 0; i < t.ndimension(); ++i) {
+    sizes[i] = (size_t) t.sizes()[i];
+  }
+
+  std::vector<FloatType<kWidth>::T> p(t.numel());
+  getHostRounder(context, program, queue).roundStochastic(
+    t.data<float>(), p.data(), p.size(), seed, mode);
+
+  auto out = CLTensor<FloatType<kWidth>::T>(context, sizes);
+  out.getDeviceMem().copyH2D(queue, p.data(), p.size(), 0);
+
+  return out;
+}
+
 } } // namespace
@@ -0,0 +1,519 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "bench/Benchmark.h"
+
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include "ops/TensorConv.h"
+#include "ops/TensorConvert.h"
+#include "utils/Context.h"
+#include "utils/OpenCLUtils.h"
+#include "utils/Profiler.h"
+#include "utils/Queue.h"
+
+namespace facebook { namespace cl {
+
+namespace {
+
+constexpr double kElementBytes = sizeof(FloatType<kWidth>::T);
+
+// Runs `fn` once to warm up, then `iters` times, returning the average
+// kernel (and optionally copy) execution time and wall time per iteration
+// in ms
+template <typename F>
+void
+timeOp(Queue& queue, int iters, const F& fn,
+       double& deviceMs, double& wallMs, bool includeCopies = false) {
+  CL_ASSERT(iters >= 1);
+
+  fn();
+  queue.blockingWait();
+
+  // Kernel times are taken from the profiler, so that ops made of several
+  // launches are accounted for
+  auto& profiler = Profiler::get();
+  bool wasEnabled = Profiler::isEnabled();
+  profiler.enable(true);
+  size_t first = profiler.getRecords().size();
+
+  auto start = std::chrono::high_resolution_clock::now();
+
+  for (int i = 0; i < iters; ++i) {
+    fn();
+  }
+
+  queue.blockingWait();
+  auto end = std::chrono::high_resolution_clock::now();
+
+  profiler.enable(wasEnabled);
+
+  auto& records = profiler.getRecords();
+  double ns = 0;
+  for (size_t i = first; i < records.size(); ++i) {
+    if (includeCopies || !records[i].isCopy) {
+      ns += (double) (records[i].end - records[i].start);
+    }
+  }
+
+  // Only keep our records if the caller is profiling as well
+  if (!wasEnabled) {
+    profiler.clear(first);
+  }
+
+  deviceMs = ns / (1e6 * iters);
+  wallMs = std::chrono::duration<double, std::milli>(end - start).count() /
+    iters;
+}
+
+std::string
+convName(size_t inChannels, size_t outChannels, size_t inHW,
+         int kHW, int strideHW, int padHW) {
+  std::stringstream ss;
+  ss << inChannels << "x" << inHW << "x" << inHW
+     << " -> " << outChannels
+     << " k" << kHW << " s" << strideHW << " p" << padHW;
+
+  return ss.str();
+}
+
+void
+addConv(std::vector<ConvShape>& shapes,
+        size_t batch,
+        size_t inChannels,
+        size_t outChannels,
+        size_t inHW,
+        int kHW,
+        int strideHW,
+        int padHW) {
+  auto name = convName(inChannels, outChannels, inHW, kHW, strideHW, padHW);
+
+  for (auto& s : shapes) {
+    if (s.name == name) {
+      ++s.count;
+      return;
+    }
+  }
+
+  ConvShape s;
+  s.name = name;
+  s.batch = batch;
+  s.inChannels = inChannels;
+  s.outChannels = outChannels;
+  s.inHW = inHW;
+  s.kHW = kHW;
+  s.strideHW = strideHW;
+  s.padHW = padHW;
+  s.count = 1;
+
+  shapes.push_back(s);
+}
+
+}
+
+std::vector<ConvShape>
+getResNet50ConvShapes(size_t batch) {
+  std::vector<ConvShape> shapes;
+
+  // stem; followed by a stride 2 max pool
+  addConv(shapes, batch, 3, 64, 224, 7, 2, 3);
+
+  // Bottleneck stages: (width, blocks, stride). The stride is applied in the
+  // 3x3 convolution, and the first block of each stage has a 1x1 projection
+  const int kStages[4][3] = {{64, 3, 1}, {128, 4, 2}, {256, 6, 2}, {512, 3, 2}};
+
+  size_t channels = 64;
+  size_t hw = 56;
+
+  for (auto& stage : kStages) {
+    size_t width = stage[0];
+
+    for (int b = 0; b < stage[1]; ++b) {
+      int stride = (b == 0) ? stage[2] : 1;
+      size_t outHW = calcKernelOutputSize(hw, 1, 1, 3, stride);
+
+      addConv(shapes, batch, channels, width, hw, 1, 1, 0);
+      addConv(shapes, batch, width, width, hw, 3, stride, 1);
+      addConv(shapes, batch, width, width * 4, outHW, 1, 1, 0);
+
+      if (b == 0) {
+        addConv(shapes, batch, channels, width * 4, hw, 1, stride, 0);
+      }
+
+      channels = width * 4;
+      hw = outHW;
+    }
+  }
+
+  return shapes;
+}
+
+std::vector<MMShape>
+getResNet50MMShapes(size_t batch) {
+  std::vector<MMShape> shapes;
+
+  for (auto& c : getResNet50ConvShapes(batch)) {
+    size_t outHW = calcKernelOutputSize(c.inHW, c.padHW, c.padHW,
+                                        c.kHW, c.strideHW);
+
+    MMShape s;
+    s.name = c.name;
+    s.batch = c.batch;
+    s.m = c.outChannels;
+    s.n = outHW * outHW;
+    s.k = c.inChannels * c.kHW * c.kHW;
+    s.count = c.count;
+
+    shapes.push_back(s);
+  }
+
+  return shapes;
+}
+
+std::vector<MMShape>
+getSquareMMShapes(size_t minSize, size_t maxSize) {
+  std::vector<MMShape> shapes;
+
+  for (size_t size = minSize; size <= maxSize; size *= 2) {
+    MMShape s;
+    s.name = std::to_string(size) + "^3";
+    s.batch = 1;
+    s.m = size;
+    s.n = size;
+    s.k = size;
+    s.count = 1;
+
+    shapes.push_back(s);
+  }
+
+  return shapes;
+}
+
+BenchResult
+benchMM(Context& context,
+        Program& program,
+        Queue& queue,
+        const MMShape& shape,
+        int iters) {
+  CLTensor<FloatType<kWidth>::T> a(context, {shape.m, shape.k});
+  CLTensor<FloatType<kWidth>::T> b(context, {shape.batch, shape.k, shape.n});
+  CLTensor<FloatType<kWidth>::T> c(context, {shape.batch, shape.m, shape.n});
+
+  runUniform(context, program, queue, -1.0f, 1.0f, a);
+  runUniform(context, program, queue, -1.0f, 1.0f, b);
+
+  BenchResult r;
+  r.op = "mm";
+  r.shape = shape.name;
+  r.ops = 2.0 * shape.batch * shape.m * shape.n * shape.k;
+  r.bytes = kElementBytes *
+    (shape.m * shape.k + shape.batch * (shape.k * shape.n + shape.m * shape.n));
+  r.iters = iters;
+  r.hostTimed = false;
+
+  timeOp(queue, iters, [&]() {
+      runMM(context, program, queue, a, b, false, RoundOp::R2NE, 0, 0, c);
+    }, r.deviceMs, r.wallMs);
+
+  return r;
+}
+
+BenchResult
+benchConv2d(Context& context,
+            Program& program,
+            Queue& queue,
+            const ConvShape& shape,
+            int iters) {
+  size_t outHW = calcKernelOutputSize(shape.inHW, shape.padHW, shape.padHW,
+                                      shape.kHW, shape.strideHW);
+  size_t kHW = shape.kHW;
+
+  CLTensor<FloatType<kWidth>::T> in(
+    context, {shape.batch, shape.inChannels, shape.inHW, shape.inHW});
+  CLTensor<FloatType<kWidth>::T> ker(
+    context, {shape.outChannels, shape.inChannels, kHW, kHW});
+  CLTensor<FloatType<kWidth>::T> out(
+    context, {shape.batch, shape.outChannels, outHW, outHW});
+  CLTensor<FloatType<kWidth>::T> workspace;
+
+  runUniform(context, program, queue, -1.0f, 1.0f, in);
+  runUniform(context, program, queue, -1.0f, 1.0f, ker);
+
+  BenchResult r;
+  r.op = "conv2d";
+  r.shape = shape.name;
+  r.ops = 2.0 * out.numElements() * shape.inChannels * kHW * kHW;
+  r.bytes = kElementBytes *
+    (in.numElements() + ker.numElements() + out.numElements());
+  r.iters = iters;
+  r.hostTimed = false;
+
+  timeOp(queue, iters, [&]() {
+      runForwardConv2dNCHW(context, program, queue,
+                           in, workspace, ker, nullptr,
+                           KernelGeometry::square(shape.kHW, shape.strideHW,
+                                                  shape.padHW, shape.padHW),
+                           RoundOp::R2NE, 0, 0, out);
+    }, r.deviceMs, r.wallMs);
+
+  return r;
+}
+
+BenchResult
+benchPool2d(Context& context,
+            Program& program,
+            Queue& queue,
+            PoolOp op,
+            size_t batch,
+            size_t channels,
+            size_t inHW,
+            int kHW,
+            int strideHW,
+            int padHW,
+            int iters) {
+  size_t outHW = calcKernelOutputSize(inHW, padHW, padHW, kHW, strideHW);
+
+  CLTensor<FloatType<kWidth>::T> in(context, {batch, channels, inHW, inHW});
+  CLTensor<FloatType<kWidth>::T> out(context, {batch, channels, outHW, outHW});
+
+  runUniform(context, program, queue, -1.0f, 1.0f, in);
+
+  BenchResult r;
+  r.op = (op == PoolOp::Max) ? "maxpool2d" : "avgpool2d";
+  r.shape = convName(channels, channels, inHW, kHW, strideHW, padHW);
+  r.ops = (double) out.numElements() * kHW * kHW;
+  r.bytes = kElementBytes * (in.numElements() + out.numElements());
+  r.iters = iters;
+  r.hostTimed = false;
+
+  timeOp(queue, iters, [&]() {
+      runForwardPool2dNCHW(context, program, queue,
+                           in, op,
+                           KernelGeometry::square(kHW, strideHW, padHW, padHW),
+                           RoundOp::R2NE, 0, 0, out);
+    }, r.deviceMs, r.wallMs);
+
+  return r;
+}
+
+BenchResult
+benchPointwise(Context& context,
+               Program& program,
+               Queue& queue,
+               const std::string& op,
+               size_t size,
+               int iters) {
+  bool mulAdd = (op == "muladd");
+  CL_ASSERT_MSG(op == "add" || op == "mul" || mulAdd,
+                "pointwise op must be add, mul or muladd");
+
+  CLTensor<FloatType<kWidth>::T> a(context, {size});
+  CLTensor<FloatType<kWidth>::T> b(context, {size});
+  CLTensor<FloatType<kWidth>::T> c(context, {size});
+  CLTensor<FloatType<kWidth>::T> out(context, {size});
+
+  runUniform(context, program, queue, -1.0f, 1.0f, a);
+  runUniform(context, program, queue, -1.0f, 1.0f, b);
+  runUniform(context, program, queue, -1.0f, 1.0f, c);
+
+  BenchResult r;
+  r.op = op;
+  r.shape = std::to_string(size);
+  r.ops = (mulAdd ? 2.0 : 1.0) * size;
+  r.bytes = kElementBytes * size * (mulAdd ? 4 : 3);
+  r.iters = iters;
+  r.hostTimed = false;
+
+  timeOp(queue, iters, [&]() {
+      if (mulAdd) {
+        runMulAdd(context, program, queue,
+                  c, 0, a, b, 0, false, RoundOp::R2NE, 0, out);
+      } else {
+        runBinaryMath(context, program, queue,
+                      a, b, op == "add" ? MathOp::Add : MathOp::Mul,
+                      RoundOp::R2NE, out);
+      }
+    }, r.deviceMs, r.wallMs);
+
+  return r;
+}
+
+BenchResult
+benchConvert(Context& context,
+             Program& program,
+             Queue& queue,
+             const std::string& path,
+             size_t size,
+             int iters) {
+  HostTensor<float, 1> hostF({size});
+  for (size_t i = 0; i < size; ++i) {
+    hostF[i] = (float) i / size * 2.0f - 1.0f;
+  }
+
+  CLTensor<float> f(context, queue, hostF);
+  CLTensor<FloatType<kWidth>::T> p(context, {size});
+  runToPosit8(context, program, queue, f, p);
+
+  auto& decoder = getHostDecoder(context, program, queue);
+  auto hostP = p.toHost<1>(queue);
+
+  BenchResult r;
+  r.op = path;
+  r.shape = std::to_string(size);
+  r.ops = size;
+  r.bytes = (double) size * (sizeof(float) + kElementBytes);
+  r.iters = iters;
+  r.hostTimed = (path != "to_posit_device" && path != "to_float_device");
+
+  auto prevPath = getConvertPath();
+
+  if (path == "to_posit_device") {
+    timeOp(queue, iters, [&]() {
+        runToPosit8(context, program, queue, f, p);
+      }, r.deviceMs, r.wallMs);
+  } else if (path == "to_float_device") {
+    timeOp(queue, iters, [&]() {
+        runToFloat(context, program, queue, p, f);
+      }, r.deviceMs, r.wallMs);
+  } else if (path == "to_posit_host") {
+    timeOp(queue, iters, [&]() {
+        toDevicePosit(context, program, queue, hostF);
+      }, r.deviceMs, r.wallMs, true);
+  } else if (path == "to_float_host_device" ||
+             path == "to_float_host_table") {
+    setConvertPath(path == "to_float_host_table" ?
+                   ConvertPath::HostTable : ConvertPath::Device);
+
+    timeOp(queue, iters, [&]() {
+        fromDevicePosit<1>(context, program, queue, p);
+      }, r.deviceMs, r.wallMs, true);
+  } else if (path == "decode_table") {
+    timeOp(queue, iters, [&]() {
+        decoder.decode(hostP.data(), hostF.data(), size);
+      }, r.deviceMs, r.wallMs);
+  } else {
+    CL_ASSERT_MSG(false, "unknown conversion path");
+  }
+
+  setConvertPath(prevPath);
+
+  return r;
+}
+
+std::vector<BenchResult>
+benchConvertAll(Context& context,
+                Program& program,
+                Queue& queue,
+                int iters) {
+  std::vector<BenchResult> results;
+
+  // From a ResNet-50 classifier output to a batch of input images
+  for (size_t size : {1000, 1 << 16, 1 << 20, 3 * 224 * 224 * 16}) {
+    for (auto path : {"to_posit_device", "to_float_device",
+                      "to_posit_host", "to_float_host_device",
+                      "to_float_host_table", "decode_table"}) {
+      results.push_back(benchConvert(context, program, queue,
+                                     path, size, iters));
+    }
+  }
+
+  return results;
+}
+
+ConvertPath
+selectConvertPath(Context& context,
+                  Program& program,
+                  Queue& queue,
+                  size_t size,
+                  int iters) {
+  auto device = benchConvert(context, program, queue,
+                             "to_float_host_device", size, iters);
+  auto table = benchConvert(context, program, queue,
+                            "to_float_host_table", size, iters);
+
+  auto path = (table.wallMs < device.wallMs) ?
+    ConvertPath::HostTable : ConvertPath::Device;
+  setConvertPath(path);
+
+  return path;
+}
+
+std::vector<BenchResult>
+benchAll(Context& context,
+         Program& program,
+         Queue& queue,
+         size_t batch,
+         int iters) {
+  std::vector<BenchResult> results;
+
+  for (auto& s : getResNet50ConvShapes(batch)) {
+    results.push_back(benchConv2d(context, program, queue, s, iters));
+  }
+
+  for (auto& s : getResNet50MMShapes(batch)) {
+    results.push_back(benchMM(context, program, queue, s, iters));
+  }
+
+  for (auto& s : getSquareMMShapes(64, 1024)) {
+    results.push_back(benchMM(context, program, queue, s, iters));
+  }
+
+  // The ResNet-50 stem and head pools
+  results.push_back(benchPool2d(context, program, queue,
+                                PoolOp::Max, batch, 64, 112, 3, 2, 1, iters));
+  results.push_back(benchPool2d(context, program, queue,
+                                PoolOp::Avg, batch, 2048, 7, 7, 1, 0, iters));
+
+  for (size_t size = 1 << 16; size <= (1 << 24); size <<= 4) {
+    for (auto op : {"add", "mul", "muladd"}) {
+      results.push_back(benchPointwise(context, program, queue,
+                                       op, size, iters));
+    }
+  }
+
+  for (auto& r : benchConvertAll(context, program, queue, iters)) {
+    results.push_back(r);
+  }
+
+  return results;
+}
+
+std::string
+benchResultsToJson(Context& context,
+                   const std::vector<BenchResult>& results,
+                   const std::string& tag) {
+  std::stringstream ss;
+  ss << std::setprecision(6);
+
+  ss << "{\"device\":\"" << escapeJson(context.getDeviceName()) << "\""
+     << ",\"width\":" << kWidth
+     << ",\"es\":" << kES
+     << ",\"tag\":\"" << escapeJson(tag) << "\""
+     << ",\"results\":[";
+
+  for (int i = 0; i < results.size(); ++i) {
+    auto& r = results[i];
+
+    ss << (i > 0 ? ",\n" : "\n")
+       << "{\"op\":\"" << escapeJson(r.op) << "\""
+       << ",\"shape\":\"" << escapeJson(r.shape) << "\""
+       << ",\"ops\":" << r.ops
+       << ",\"bytes\":" << r.bytes
+       << ",\"device_ms\":" << r.deviceMs
+       << ",\"wall_ms\":" << r.wallMs
+       << ",\"iters\":" << r.iters
+       << ",\"host_timed\":" << (r.hostTimed ? "true" : "false")
+       << ",\"gops\":" << r.gops()
+       << ",\"bytes_per_sec\":" << r.bytesPerSec()
+       << ",\"intensity\":" << r.intensity()
+       << "}";
+  }
+
+  ss << "\n]}\n";
+  return ss.str();
+}
+
+} }
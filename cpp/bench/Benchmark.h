@@ -0,0 +1,183 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FloatDefs.h"
+#include "ops/HostCodec.h"
+#include "ops/PoolOp.h"
+#include "ops/TensorMath.h"
+
+/// Roofline-style benchmarks of the core ops. Each result reports achieved
+/// ops/s, bytes/s and the arithmetic intensity (ops per byte) of the shape,
+/// so that results can be placed against the compute and memory bandwidth
+/// roofs of a device.
+
+namespace facebook { namespace cl {
+
+class Context;
+class Program;
+class Queue;
+
+// c[batch][m][n] = a[m][k] * b[batch][k][n], as used by convolution
+struct MMShape {
+  std::string name;
+  size_t batch;
+  size_t m;
+  size_t n;
+  size_t k;
+
+  // Number of times this shape occurs in the model it was taken from
+  int count;
+};
+
+struct ConvShape {
+  std::string name;
+  size_t batch;
+  size_t inChannels;
+  size_t outChannels;
+  size_t inHW;
+  int kHW;
+  int strideHW;
+  int padHW;
+  int count;
+};
+
+struct BenchResult {
+  // Op benchmarked (e.g., "mm", "conv2d", "maxpool2d", "add")
+  std::string op;
+  std::string shape;
+
+  // Per iteration: multiply-accumulates count as two ops
+  double ops;
+
+  // Per iteration: compulsory traffic, each input read and each output
+  // written once
+  double bytes;
+
+  // Averages per iteration, in ms. Device time is the sum of the kernel
+  // (and for host paths, copy) execution times; wall time includes launch
+  // overhead and any host work
+  double deviceMs;
+  double wallMs;
+  int iters;
+
+  // If set, rates are computed from wall time, as the op does work on the
+  // host
+  bool hostTimed;
+
+  inline double ms() const {
+    return hostTimed ? wallMs : deviceMs;
+  }
+
+  inline double gops() const {
+    return ms() > 0 ? ops / (ms() * 1e6) : 0;
+  }
+
+  inline double bytesPerSec() const {
+    return ms() > 0 ? bytes / (ms() * 1e-3) : 0;
+  }
+
+  inline double intensity() const {
+    return bytes > 0 ? ops / bytes : 0;
+  }
+};
+
+// Every convolution in ResNet-50 at 224 x 224 input; repeated shapes are
+// listed once with their count
+std::vector<ConvShape> getResNet50ConvShapes(size_t batch);
+
+// The above convolutions lowered to matrix multiplication via im2col
+std::vector<MMShape> getResNet50MMShapes(size_t batch);
+
+// m = n = k for every power of 2 in [minSize, maxSize]
+std::vector<MMShape> getSquareMMShapes(size_t minSize, size_t maxSize);
+
+BenchResult
+benchMM(Context& context,
+        Program& program,
+        Queue& queue,
+        const MMShape& shape,
+        int iters);
+
+BenchResult
+benchConv2d(Context& context,
+            Program& program,
+            Queue& queue,
+            const ConvShape& shape,
+            int iters);
+
+BenchResult
+benchPool2d(Context& context,
+            Program& program,
+            Queue& queue,
+            PoolOp op,
+            size_t batch,
+            size_t channels,
+            size_t inHW,
+            int kHW,
+            int strideHW,
+            int padHW,
+            int iters);
+
+// Add, Mul or MulAdd (c + a * b) over `size` elements
+BenchResult
+benchPointwise(Context& context,
+               Program& program,
+               Queue& queue,
+               const std::string& op,
+               size_t size,
+               int iters);
+
+// Float <-> FloatType<kWidth>::T conversion of `size` elements; each element
+// counts as one op. `path` is one of
+//   to_posit_device:      runToPosit8
+//   to_float_device:      runToFloat
+//   to_posit_host:        toDevicePosit from host floats
+//   to_float_host_device: fromDevicePosit via ConvertPath::Device
+//   to_float_host_table:  fromDevicePosit via ConvertPath::HostTable
+//   decode_table:         HostDecoder alone, host memory to host memory
+BenchResult
+benchConvert(Context& context,
+             Program& program,
+             Queue& queue,
+             const std::string& path,
+             size_t size,
+             int iters);
+
+// All conversion paths at several sizes
+std::vector<BenchResult>
+benchConvertAll(Context& context,
+                Program& program,
+                Queue& queue,
+                int iters);
+
+// Times both device -> host conversion paths for `size` elements and makes
+// the faster one current via setConvertPath, returning it
+ConvertPath
+selectConvertPath(Context& context,
+                  Program& program,
+                  Queue& queue,
+                  size_t size,
+                  int iters);
+
+// All of the above at default sizes for a ResNet-50 batch
+std::vector<BenchResult>
+benchAll(Context& context,
+         Program& program,
+         Queue& queue,
+         size_t batch,
+         int iters);
+
+// JSON document of the results, tagged with the device, the number format
+// and a user-provided tag (e.g., a commit) for regression tracking
+std::string
+benchResultsToJson(Context& context,
+                   const std::vector<BenchResult>& results,
+                   const std::string& tag);
+
+} } // namespace
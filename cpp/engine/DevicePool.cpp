@@ -0,0 +1,223 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "engine/DevicePool.h"
+
+#include <algorithm>
+#include <cmath>
+#include "utils/OpenCLUtils.h"
+
+namespace facebook { namespace cl {
+
+namespace {
+
+// Weight of a new throughput measurement
+constexpr double kThroughputDecay = 0.25;
+
+}
+
+DevicePool::DevicePool(const std::string& platform,
+                       cl_device_type deviceType,
+                       const std::string& binaryFile,
+                       int maxDevices) {
+  auto ids = getClDevices(platform, deviceType);
+  CL_ASSERT_MSG(!ids.empty(), "Did not find a device for the device pool");
+
+  if (maxDevices >= 0 && ids.size() > maxDevices) {
+    ids.resize(maxDevices);
+  }
+
+  for (auto id : ids) {
+    std::unique_ptr<Device> dev(new Device);
+    dev->context = Context(id);
+    dev->queue = dev->context.makeQueue();
+    dev->program = dev->context.makeBinaryProgram(binaryFile);
+    dev->throughput = 0;
+
+    devices_.emplace_back(std::move(dev));
+  }
+}
+
+int
+DevicePool::numDevices() const {
+  return devices_.size();
+}
+
+Context&
+DevicePool::getContext(int device) {
+  CL_ASSERT(device >= 0 && device < devices_.size());
+  return devices_[device]->context;
+}
+
+Program&
+DevicePool::getProgram(int device) {
+  CL_ASSERT(device >= 0 && device < devices_.size());
+  return devices_[device]->program;
+}
+
+Queue&
+DevicePool::getQueue(int device) {
+  CL_ASSERT(device >= 0 && device < devices_.size());
+  return devices_[device]->queue;
+}
+
+void
+DevicePool::setModel(int device, Layer& model, int depth) {
+  CL_ASSERT(device >= 0 && device < devices_.size());
+  CL_ASSERT_MSG(inFlight_.empty(), "cannot change models with work in flight");
+
+  auto& dev = *devices_[device];
+  dev.engine.reset(new InferenceEngine(dev.context,
+                                       dev.program,
+                                       dev.queue,
+                                       model,
+                                       depth));
+}
+
+int
+DevicePool::getDepth() const {
+  int depth = 0;
+
+  for (auto& dev : devices_) {
+    CL_ASSERT_MSG(dev->engine, "all devices must have a model");
+    depth = (depth == 0) ? dev->engine->getDepth() :
+      std::min(depth, dev->engine->getDepth());
+  }
+
+  return depth;
+}
+
+int
+DevicePool::numInFlight() const {
+  return inFlight_.size();
+}
+
+std::vector<double>
+DevicePool::getThroughputs() const {
+  std::vector<double> out;
+  for (auto& dev : devices_) {
+    out.push_back(dev->throughput);
+  }
+
+  return out;
+}
+
+std::vector<size_t>
+DevicePool::getShards(size_t batch) const {
+  // Split evenly until every device has been measured
+  bool measured = true;
+  for (auto& dev : devices_) {
+    measured = measured && (dev->throughput > 0);
+  }
+
+  std::vector<double> weights;
+  double total = 0;
+  for (auto& dev : devices_) {
+    weights.push_back(measured ? dev->throughput : 1.0);
+    total += weights.back();
+  }
+
+  // Largest remainder apportionment
+  std::vector<size_t> shards(devices_.size());
+  std::vector<std::pair<double, int>> remainders;
+  size_t assigned = 0;
+
+  for (int i = 0; i < devices_.size(); ++i) {
+    double exact = (double) batch * weights[i] / total;
+    shards[i] = (size_t) std::floor(exact);
+    assigned += shards[i];
+
+    remainders.push_back(std::make_pair(exact - shards[i], i));
+  }
+
+  std::sort(remainders.begin(), remainders.end(),
+            [](const std::pair<double, int>& a,
+               const std::pair<double, int>& b) {
+              return a.first > b.first;
+            });
+
+  for (int i = 0; assigned < batch; ++i) {
+    ++shards[remainders[i % remainders.size()].second];
+    ++assigned;
+  }
+
+  return shards;
+}
+
+void
+DevicePool::submit(const float* data, const std::vector<size_t>& sizes) {
+  CL_ASSERT_MSG(numInFlight() < getDepth(),
+                "all slots are in flight; retrieve a batch first");
+  CL_ASSERT(!sizes.empty());
+
+  size_t batch = sizes[0];
+  size_t itemSize = 1;
+  for (int i = 1; i < sizes.size(); ++i) {
+    itemSize *= sizes[i];
+  }
+
+  auto shards = getShards(batch);
+  auto shardSizes = sizes;
+  size_t offset = 0;
+
+  for (int i = 0; i < devices_.size(); ++i) {
+    if (shards[i] == 0) {
+      continue;
+    }
+
+    shardSizes[0] = shards[i];
+    devices_[i]->engine->submit(data + offset * itemSize, shardSizes);
+    offset += shards[i];
+  }
+
+  inFlight_.push_back(std::move(shards));
+}
+
+const std::vector<float>&
+DevicePool::retrieve() {
+  CL_ASSERT_MSG(!inFlight_.empty(), "no batches in flight");
+
+  auto shards = std::move(inFlight_.front());
+  inFlight_.pop_front();
+
+  output_.clear();
+  outputSizes_.clear();
+
+  for (int i = 0; i < devices_.size(); ++i) {
+    if (shards[i] == 0) {
+      continue;
+    }
+
+    auto& dev = *devices_[i];
+    auto& out = dev.engine->retrieve();
+    auto& outSizes = dev.engine->getOutputSizes();
+    CL_ASSERT(!outSizes.empty() && outSizes[0] == shards[i]);
+
+    // Outputs are gathered along the outermost (batch) dimension
+    if (outputSizes_.empty()) {
+      outputSizes_ = outSizes;
+      outputSizes_[0] = 0;
+    }
+
+    outputSizes_[0] += outSizes[0];
+    output_.insert(output_.end(), out.begin(), out.end());
+
+    double ns = dev.engine->getLastDeviceTime();
+    if (ns > 0) {
+      double t = (double) shards[i] * 1e9 / ns;
+      dev.throughput = (dev.throughput == 0) ? t :
+        (1.0 - kThroughputDecay) * dev.throughput + kThroughputDecay * t;
+    }
+  }
+
+  return output_;
+}
+
+const std::vector<size_t>&
+DevicePool::getOutputSizes() const {
+  return outputSizes_;
+}
+
+} }
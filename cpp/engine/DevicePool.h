@@ -0,0 +1,82 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "engine/InferenceEngine.h"
+#include "utils/Context.h"
+#include "utils/Program.h"
+#include "utils/Queue.h"
+
+namespace facebook { namespace cl {
+
+// Data-parallel inference over every device of a platform. Each device has
+// its own Context / Program / Queue and its own replica of the model (built
+// and loaded by the caller on that device's handles). A batch is split along
+// its outermost dimension into one shard per device, sized in proportion to
+// each device's measured throughput, and the outputs are gathered in order.
+class DevicePool {
+ public:
+  // Opens up to `maxDevices` (all if -1) devices of type `deviceType` on the
+  // first platform whose name contains `platform`, loading `binaryFile` on
+  // each
+  DevicePool(const std::string& platform,
+             cl_device_type deviceType,
+             const std::string& binaryFile,
+             int maxDevices = -1);
+
+  int numDevices() const;
+
+  Context& getContext(int device);
+  Program& getProgram(int device);
+  Queue& getQueue(int device);
+
+  // Sets the model replica that runs on `device`; all devices must have a
+  // model before submit. Up to `depth` batches may be in flight.
+  void setModel(int device, Layer& model, int depth = 2);
+
+  int getDepth() const;
+  int numInFlight() const;
+
+  // Splits a batch of contiguous float data of size `sizes` across the
+  // devices and starts inference on each shard
+  void submit(const float* data, const std::vector<size_t>& sizes);
+
+  // Waits for the oldest batch in flight and gathers its output
+  const std::vector<float>& retrieve();
+  const std::vector<size_t>& getOutputSizes() const;
+
+  // Measured throughput of each device in batch items per second, used to
+  // size the shards
+  std::vector<double> getThroughputs() const;
+
+ private:
+  // Returns the shard size for each device for a batch of `batch` items
+  std::vector<size_t> getShards(size_t batch) const;
+
+  struct Device {
+    Context context;
+    Program program;
+    Queue queue;
+    std::unique_ptr<InferenceEngine> engine;
+
+    // Exponential moving average of items / s; 0 until measured
+    double throughput;
+  };
+
+  std::vector<std::unique_ptr<Device>> devices_;
+
+  // Shard sizes of each batch in flight, oldest first
+  std::deque<std::vector<size_t>> inFlight_;
+
+  std::vector<float> output_;
+  std::vector<size_t> outputSizes_;
+};
+
+} } // namespace
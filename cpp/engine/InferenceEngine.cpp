@@ -0,0 +1,154 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "engine/InferenceEngine.h"
+
+#include <cstring>
+#include "ops/TensorMath.h"
+#include "utils/CopyUtils.h"
+
+namespace facebook { namespace cl {
+
+namespace {
+
+size_t
+numElementsOf(const std::vector<size_t>& sizes) {
+  size_t n = 1;
+  for (auto s : sizes) {
+    n *= s;
+  }
+
+  return n;
+}
+
+}
+
+InferenceEngine::InferenceEngine(Context& context,
+                                 Program& program,
+                                 Queue& computeQueue,
+                                 Layer& model,
+                                 int depth)
+    : context_(context),
+      program_(program),
+      computeQueue_(computeQueue),
+      model_(model),
+      uploadQueue_(context.makeQueue()),
+      downloadQueue_(context.makeQueue()),
+      slots_(depth),
+      head_(0),
+      tail_(0),
+      retrievedTime_(0) {
+  CL_ASSERT(depth >= 1);
+}
+
+int
+InferenceEngine::getDepth() const {
+  return slots_.size();
+}
+
+int
+InferenceEngine::numInFlight() const {
+  return head_ - tail_;
+}
+
+size_t
+InferenceEngine::submit(const float* data, const std::vector<size_t>& sizes) {
+  CL_ASSERT_MSG(numInFlight() < getDepth(),
+                "all slots are in flight; retrieve a batch first");
+
+  auto ticket = head_++;
+  auto& slot = slots_[ticket % slots_.size()];
+  slot.ticket = ticket;
+
+  // The slot was last used by batch ticket - depth, which has been
+  // retrieved, so none of its buffers are still in use by the device
+  size_t num = numElementsOf(sizes);
+  slot.hostInput.resize(num);
+  std::memcpy(slot.hostInput.data(), data, num * sizeof(float));
+
+  if (slot.inputF.dims() != sizes.size() || slot.inputF.sizes() != sizes) {
+    slot.inputF = CLTensor<float>(context_, sizes);
+    slot.inputP = CLTensor<FloatType<kWidth>::T>(context_, sizes);
+  }
+
+  // upload
+  slot.uploaded = utils::copyH2DAsync(uploadQueue_,
+                                      slot.inputF.getDeviceMem().get(),
+                                      slot.hostInput.data(),
+                                      num,
+                                      0);
+  uploadQueue_.flush();
+
+  // compute
+  computeQueue_.waitFor(slot.uploaded);
+
+  runToPosit8(context_, program_, computeQueue_, slot.inputF, slot.inputP);
+  auto& out = model_.forward(context_, program_, computeQueue_, slot.inputP);
+
+  if (slot.outputF.dims() != out.dims() ||
+      slot.outputF.sizes() != out.sizes()) {
+    slot.outputF = CLTensor<float>(context_, out.sizes());
+  }
+
+  runToFloat(context_, program_, computeQueue_, out, slot.outputF);
+  slot.computed = computeQueue_.marker();
+  computeQueue_.flush();
+
+  // download
+  slot.outputSizes = out.sizes();
+  slot.hostOutput.resize(slot.outputF.numElements());
+
+  downloadQueue_.waitFor(slot.computed);
+  slot.downloaded = utils::copyD2HAsync(downloadQueue_,
+                                        slot.outputF.getDeviceMem().get(),
+                                        slot.hostOutput.data(),
+                                        slot.hostOutput.size(),
+                                        0);
+  downloadQueue_.flush();
+
+  return ticket;
+}
+
+const std::vector<float>&
+InferenceEngine::retrieve(size_t* ticket) {
+  CL_ASSERT_MSG(numInFlight() > 0, "no batches in flight");
+
+  auto& slot = slots_[tail_ % slots_.size()];
+  CL_ASSERT(slot.ticket == tail_);
+  ++tail_;
+
+  slot.downloaded.wait();
+
+  if (ticket) {
+    *ticket = slot.ticket;
+  }
+
+  retrievedSizes_ = slot.outputSizes;
+  retrievedTime_ =
+    (double) (slot.downloaded.getEndTime() - slot.uploaded.getStartTime());
+
+  return slot.hostOutput;
+}
+
+const std::vector<size_t>&
+InferenceEngine::getOutputSizes() const {
+  return retrievedSizes_;
+}
+
+double
+InferenceEngine::getLastDeviceTime() const {
+  return retrievedTime_;
+}
+
+void
+InferenceEngine::reset() {
+  uploadQueue_.blockingWait();
+  computeQueue_.blockingWait();
+  downloadQueue_.blockingWait();
+
+  tail_ = head_;
+}
+
+} }
@@ -0,0 +1,95 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <vector>
+#include "FloatDefs.h"
+#include "layers/Layer.h"
+#include "utils/Event.h"
+
+namespace facebook { namespace cl {
+
+// Streams batches through a model with up to `depth` batches in flight.
+//
+// Each batch passes through three stages on separate queues, chained with
+// events so that they overlap across batches:
+//   upload:   host float input -> device (H2D)
+//   compute:  float -> posit, model forward, posit -> float
+//   download: device float output -> host (D2H)
+//
+// Inputs and outputs are staged through a ring of `depth` slots. The layer
+// activations themselves are not replicated: all compute work is issued to a
+// single in-order queue, and each batch's output is converted into its own
+// slot before the next batch's forward begins, so a layer's output buffer is
+// never overwritten while still needed.
+class InferenceEngine {
+ public:
+  InferenceEngine(Context& context,
+                  Program& program,
+                  Queue& computeQueue,
+                  Layer& model,
+                  int depth = 2);
+
+  int getDepth() const;
+
+  // Number of batches submitted but not yet retrieved
+  int numInFlight() const;
+
+  // Starts inference on a batch of contiguous float data of size `sizes`.
+  // The data is copied, so it may be reused upon return. Must have fewer than
+  // getDepth() batches in flight. Returns the ticket of this batch.
+  size_t submit(const float* data, const std::vector<size_t>& sizes);
+
+  // Waits for the oldest batch in flight, returning its float output. The
+  // reference is valid until the next submit.
+  const std::vector<float>& retrieve(size_t* ticket = nullptr);
+
+  // Sizes of the output last returned by retrieve()
+  const std::vector<size_t>& getOutputSizes() const;
+
+  // Device time in ns from the start of upload to the end of download of
+  // the batch last returned by retrieve()
+  double getLastDeviceTime() const;
+
+  // Waits for all work to complete and drops any results not yet retrieved
+  void reset();
+
+ private:
+  struct Slot {
+    std::vector<float> hostInput;
+    CLTensor<float> inputF;
+    CLTensor<FloatType<kWidth>::T> inputP;
+
+    CLTensor<float> outputF;
+    std::vector<size_t> outputSizes;
+    std::vector<float> hostOutput;
+
+    Event uploaded;
+    Event computed;
+    Event downloaded;
+    size_t ticket;
+  };
+
+  Context& context_;
+  Program& program_;
+  Queue& computeQueue_;
+  Layer& model_;
+
+  Queue uploadQueue_;
+  Queue downloadQueue_;
+
+  std::vector<Slot> slots_;
+
+  // Next ticket to be submitted and retrieved respectively; the slot for a
+  // ticket is ticket % depth
+  size_t head_;
+  size_t tail_;
+
+  std::vector<size_t> retrievedSizes_;
+  double retrievedTime_;
+};
+
+} } // namespace
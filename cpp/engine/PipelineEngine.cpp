@@ -0,0 +1,211 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "engine/PipelineEngine.h"
+
+#include "ops/TensorMath.h"
+#include "utils/CopyUtils.h"
+
+namespace facebook { namespace cl {
+
+namespace {
+
+template <typename T>
+void
+ensureSize(Context& context,
+           CLTensor<T>& t,
+           const std::vector<size_t>& sizes) {
+  if (t.dims() != sizes.size() || t.sizes() != sizes) {
+    t = CLTensor<T>(context, sizes);
+  }
+}
+
+inline bool
+isValid(Event& e) {
+  return (cl_event) e != 0;
+}
+
+}
+
+PipelineEngine::PipelineEngine() {
+}
+
+void
+PipelineEngine::addStage(Context& context,
+                         Program& program,
+                         Queue& queue,
+                         Layer& layer) {
+  std::unique_ptr<Stage> stage(new Stage);
+  stage->context = &context;
+  stage->program = &program;
+  stage->queue = &queue;
+  stage->layer = &layer;
+  stage->upload = context.makeQueue();
+  stage->download = context.makeQueue();
+
+  stages_.emplace_back(std::move(stage));
+}
+
+int
+PipelineEngine::numStages() const {
+  return stages_.size();
+}
+
+const std::vector<float>&
+PipelineEngine::forward(const float* data,
+                        const std::vector<size_t>& sizes,
+                        int numMicroBatches) {
+  CL_ASSERT(!stages_.empty());
+  CL_ASSERT(!sizes.empty());
+  CL_ASSERT(numMicroBatches >= 1 && numMicroBatches <= sizes[0]);
+
+  size_t batch = sizes[0];
+  size_t itemSize = 1;
+  for (int i = 1; i < sizes.size(); ++i) {
+    itemSize *= sizes[i];
+  }
+
+  int numStages = stages_.size();
+
+  staging_.resize(numStages - 1);
+  for (auto& s : staging_) {
+    s.resize(numMicroBatches);
+  }
+
+  std::vector<std::vector<float>> finalHost(numMicroBatches);
+  std::vector<std::vector<size_t>> finalSizes(numMicroBatches);
+
+  size_t offset = 0;
+
+  // Everything is enqueued micro-batch by micro-batch; the devices run the
+  // stages concurrently as their inputs become available
+  for (int i = 0; i < numMicroBatches; ++i) {
+    int b = i % 2;
+
+    auto mbSizes = sizes;
+    mbSizes[0] = batch / numMicroBatches +
+      (i < (batch % numMicroBatches) ? 1 : 0);
+
+    // The host staging copy of the previous stage's output, and its
+    // completion as a user event in the current stage's context
+    std::vector<size_t> prevSizes;
+    Event staged;
+
+    for (int s = 0; s < numStages; ++s) {
+      auto& st = *stages_[s];
+      auto& context = *st.context;
+      auto& queue = *st.queue;
+      bool last = (s == numStages - 1);
+
+      // Input buffer b was last read by micro-batch i - 2
+      if (isValid(st.inputConsumed[b])) {
+        st.upload.waitFor(st.inputConsumed[b]);
+      }
+
+      Event uploaded;
+      if (s == 0) {
+        ensureSize(context, st.inputF[b], mbSizes);
+        ensureSize(context, st.input[b], mbSizes);
+
+        uploaded = utils::copyH2DAsync(st.upload,
+                                       st.inputF[b].getDeviceMem().get(),
+                                       data + offset * itemSize,
+                                       mbSizes[0] * itemSize,
+                                       0);
+      } else {
+        ensureSize(context, st.input[b], prevSizes);
+
+        st.upload.waitFor(staged);
+        uploaded = utils::copyH2DAsync(st.upload,
+                                       st.input[b].getDeviceMem().get(),
+                                       staging_[s - 1][i].data(),
+                                       staging_[s - 1][i].size(),
+                                       0);
+      }
+
+      st.upload.flush();
+
+      // compute
+      queue.waitFor(uploaded);
+
+      if (s == 0) {
+        runToPosit8(context, *st.program, queue, st.inputF[b], st.input[b]);
+      }
+
+      auto& out = st.layer->forward(context, *st.program, queue, st.input[b]);
+      st.inputConsumed[b] = queue.marker();
+
+      // Output buffer b was last read by micro-batch i - 2
+      if (isValid(st.outputRead[b])) {
+        queue.waitFor(st.outputRead[b]);
+      }
+
+      if (last) {
+        ensureSize(context, st.outputF[b], out.sizes());
+        runToFloat(context, *st.program, queue, out, st.outputF[b]);
+      } else {
+        ensureSize(context, st.output[b], out.sizes());
+        st.output[b].copyFrom(queue, out);
+      }
+
+      auto computed = queue.marker();
+      queue.flush();
+
+      // download
+      st.download.waitFor(computed);
+
+      if (last) {
+        finalHost[i].resize(out.numElements());
+        finalSizes[i] = out.sizes();
+
+        st.outputRead[b] =
+          utils::copyD2HAsync(st.download,
+                              st.outputF[b].getDeviceMem().get(),
+                              finalHost[i].data(),
+                              finalHost[i].size(),
+                              0);
+      } else {
+        staging_[s][i].resize(out.numElements());
+        prevSizes = out.sizes();
+
+        st.outputRead[b] =
+          utils::copyD2HAsync(st.download,
+                              st.output[b].getDeviceMem().get(),
+                              staging_[s][i].data(),
+                              staging_[s][i].size(),
+                              0);
+
+        staged = Event::user(*stages_[s + 1]->context);
+        st.outputRead[b].signalOnCompletion(staged);
+      }
+
+      st.download.flush();
+    }
+
+    offset += mbSizes[0];
+  }
+
+  // The last download of the last stage depends on all other work
+  stages_.back()->download.blockingWait();
+
+  // Gather along the outermost (batch) dimension
+  output_.clear();
+  outputSizes_ = finalSizes[0];
+  outputSizes_[0] = 0;
+
+  for (int i = 0; i < numMicroBatches; ++i) {
+    outputSizes_[0] += finalSizes[i][0];
+    output_.insert(output_.end(), finalHost[i].begin(), finalHost[i].end());
+  }
+
+  return output_;
+}
+
+const std::vector<size_t>&
+PipelineEngine::getOutputSizes() const {
+  return outputSizes_;
+}
+
+} }
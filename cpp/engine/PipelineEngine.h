@@ -0,0 +1,82 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "FloatDefs.h"
+#include "layers/Layer.h"
+#include "utils/Event.h"
+
+namespace facebook { namespace cl {
+
+// Layer-pipeline model parallelism: a model is split into contiguous stages,
+// each a Layer whose weights live on its own device, and a batch is split
+// into micro-batches that flow through the stages.
+//
+// All work for a batch is enqueued up front. Stages are linked by
+// device -> host -> device copies of the posit activations; as the devices
+// belong to different contexts, the host copy's completion is forwarded to
+// the next device with a user event, so no host thread waits in between.
+// Stage s can thus work on micro-batch i while stage s + 1 works on i - 1.
+//
+// Each stage ping-pongs between two device input and two device output
+// buffers, so a transfer of micro-batch i overlaps compute on i + 1.
+class PipelineEngine {
+ public:
+  PipelineEngine();
+
+  // Appends a stage; its input is the output of the previous stage (or the
+  // float network input, converted on the device, for the first stage)
+  void addStage(Context& context,
+                Program& program,
+                Queue& queue,
+                Layer& layer);
+
+  int numStages() const;
+
+  // Runs a batch of contiguous float data of size `sizes`, split into
+  // `numMicroBatches` along the outermost dimension, returning the float
+  // output of the last stage
+  const std::vector<float>& forward(const float* data,
+                                    const std::vector<size_t>& sizes,
+                                    int numMicroBatches);
+
+  const std::vector<size_t>& getOutputSizes() const;
+
+ private:
+  struct Stage {
+    Context* context;
+    Program* program;
+    Queue* queue;
+    Layer* layer;
+
+    Queue upload;
+    Queue download;
+
+    // First stage only
+    CLTensor<float> inputF[2];
+
+    CLTensor<FloatType<kWidth>::T> input[2];
+    Event inputConsumed[2];
+
+    // Posit output for all but the last stage, float for the last stage
+    CLTensor<FloatType<kWidth>::T> output[2];
+    CLTensor<float> outputF[2];
+    Event outputRead[2];
+  };
+
+  std::vector<std::unique_ptr<Stage>> stages_;
+
+  // Host copy of the activations passed between stage s and s + 1 for each
+  // micro-batch, indexed [s][micro-batch]
+  std::vector<std::vector<std::vector<FloatType<kWidth>::T>>> staging_;
+
+  std::vector<float> output_;
+  std::vector<size_t> outputSizes_;
+};
+
+} } // namespace
@@ -0,0 +1,102 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "engine/SGD.h"
+
+#include "ops/TensorMath.h"
+#include "ops/TensorMemory.h"
+#include "utils/HostTensor.h"
+
+namespace facebook { namespace cl {
+
+SGD::SGD(Context& context,
+         Program& program,
+         Queue& queue,
+         Layer& model,
+         float lr,
+         float momentum,
+         bool wideMomentum)
+    : context_(context),
+      program_(program),
+      queue_(queue),
+      model_(model),
+      lr_(lr),
+      momentum_(momentum),
+      roundMode_(RoundOp::Stochastic),
+      params_(model.getParameters()) {
+  for (auto& p : params_) {
+    CL_ASSERT_MSG(p.gradParam, "parameter has no gradient");
+    CL_ASSERT(p.param->isSameSize(*p.gradParam));
+  }
+
+  if (momentum_ == 0.0f) {
+    return;
+  }
+
+  // The buffers start at zero
+  for (auto& p : params_) {
+    if (wideMomentum) {
+      HostTensor<float, 1> zeros({p.param->numElements()});
+      for (size_t i = 0; i < zeros.numElements(); ++i) {
+        zeros[i] = 0.0f;
+      }
+
+      wideMomentumBufs_.emplace_back(context_, queue_, zeros);
+    } else {
+      momentumBufs_.emplace_back(context_, p.param->sizes());
+      runMemset(context_, program_, queue_,
+                FloatType<kWidth>::kZero,
+                momentumBufs_.back());
+    }
+  }
+}
+
+void
+SGD::setLearningRate(float lr) {
+  lr_ = lr;
+}
+
+float
+SGD::getLearningRate() const {
+  return lr_;
+}
+
+float
+SGD::getMomentum() const {
+  return momentum_;
+}
+
+void
+SGD::setRoundMode(RoundOp mode) {
+  roundMode_ = mode;
+}
+
+RoundOp
+SGD::getRoundMode() const {
+  return roundMode_;
+}
+
+void
+SGD::zeroGrad() {
+  model_.zeroGrad(context_, program_, queue_);
+}
+
+void
+SGD::step() {
+  for (size_t i = 0; i < params_.size(); ++i) {
+    auto& p = params_[i];
+
+    runSGD(context_, program_, queue_,
+           *p.param,
+           *p.gradParam,
+           momentumBufs_.empty() ? nullptr : &momentumBufs_[i],
+           wideMomentumBufs_.empty() ? nullptr : &wideMomentumBufs_[i],
+           lr_,
+           momentum_,
+           roundMode_);
+  }
+}
+
+} }
@@ -0,0 +1,63 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <vector>
+#include "FloatDefs.h"
+#include "layers/Layer.h"
+#include "ops/RoundOp.h"
+
+namespace facebook { namespace cl {
+
+// SGD with momentum over the parameters of a model, applied as one fused
+// kernel per parameter tensor (see runSGD). The update is rounded
+// stochastically by default, so that steps much smaller than the spacing of
+// our values are not lost.
+//
+// With `wideMomentum`, the momentum buffers are kept in float rather than as
+// FloatType values.
+class SGD {
+ public:
+  SGD(Context& context,
+      Program& program,
+      Queue& queue,
+      Layer& model,
+      float lr,
+      float momentum = 0.0f,
+      bool wideMomentum = false);
+
+  void setLearningRate(float lr);
+  float getLearningRate() const;
+
+  float getMomentum() const;
+
+  void setRoundMode(RoundOp mode);
+  RoundOp getRoundMode() const;
+
+  // Zeros the gradients of the model
+  void zeroGrad();
+
+  // param = param - lr * (momentum * v + grad) for every parameter
+  void step();
+
+ private:
+  Context& context_;
+  Program& program_;
+  Queue& queue_;
+  Layer& model_;
+
+  float lr_;
+  float momentum_;
+  RoundOp roundMode_;
+
+  std::vector<ParameterInfo> params_;
+
+  // One per parameter, if momentum is used; only one of these is populated
+  std::vector<CLTensor<FloatType<kWidth>::T>> momentumBufs_;
+  std::vector<CLTensor<float>> wideMomentumBufs_;
+};
+
+} } // namespace
@@ -18,12 +18,13 @@ Add::Add(Context& context,
          int outputScale)
     : inputScale_(inputScale),
       addScale_(addScale),
-      outputScale_(outputScale) {
+      outputScale_(outputScale),
+      fuseReLU_(false) {
 }
 
 std::string
 Add::str() const {
-  return "Add";
+  return fuseReLU_ ? "Add + ReLU" : "Add";
 }
 
 void
@@ -56,6 +57,16 @@ Add::getAddScale() const {
   return addScale_;
 }
 
+void
+Add::setFuseReLU(bool fuse) {
+  fuseReLU_ = fuse;
+}
+
+bool
+Add::getFuseReLU() const {
+  return fuseReLU_;
+}
+
 void
 Add::setAdd(CLTensor<FloatType<kWidth>::T>& add) {
   add_ = add;
@@ -84,7 +95,8 @@ Add::forward(Context& context,
             false, // subtract
             getRoundMode(),
             outputScale_,
-            output_);
+            output_,
+            fuseReLU_);
 
   return output_;
 }
@@ -29,6 +29,10 @@ struct Add : public Layer {
   void setAddScale(int scale);
   int getAddScale() const;
 
+  // If set, max(x, 0) is applied to the sum within the add
+  void setFuseReLU(bool fuse);
+  bool getFuseReLU() const;
+
   CLTensor<FloatType<kWidth>::T>& forward(
     Context& context,
     Program& program,
@@ -39,6 +43,7 @@ struct Add : public Layer {
   char inputScale_;
   char addScale_;
   char outputScale_;
+  bool fuseReLU_;
 };
 
 } } // namespace
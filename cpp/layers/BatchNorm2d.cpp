@@ -7,6 +7,7 @@
 
 #include <cmath>
 #include <sstream>
+#include <utility>
 #include "FloatDefs.h"
 #include "ops/TensorConvert.h"
 #include "ops/TensorMath.h"
@@ -22,6 +23,7 @@ BatchNorm2d::BatchNorm2d(Context& context,
     : factoredWeight_(context, {planes}),
       runningMean_(context, {planes}),
       bias_(context, {planes}),
+      rowCopies_(0),
       planes_(planes) {
   reset(context, program, queue);
 }
@@ -41,6 +43,7 @@ BatchNorm2d::reset(Context& context,
   runMemset(context, program, queue, FloatType<kWidth>::kOne, factoredWeight_);
   runMemset(context, program, queue, FloatType<kWidth>::kZero, runningMean_);
   runMemset(context, program, queue, FloatType<kWidth>::kZero, bias_);
+  rowCopies_ = 0;
 }
 
 void
@@ -74,6 +77,7 @@ BatchNorm2d::setParameters(Context& context,
   factoredWeight_ = toDevicePosit<1>(context, program, queue, v);
   runningMean_ = toDevicePosit<1>(context, program, queue, runningMean);
   bias_ = toDevicePosit<1>(context, program, queue, bias);
+  rowCopies_ = 0;
 }
 
 CLTensor<FloatType<kWidth>::T>&
@@ -81,7 +85,7 @@ BatchNorm2d::forward(Context& context,
                      Program& program,
                      Queue& queue,
                      const CLTensor<FloatType<kWidth>::T>& input) {
-  CL_ASSERT(input.getSize(1) == planes_);
+  CL_ASSERT(input.getSize(getLayoutDims(layout_).c) == planes_);
 
   if (!output_.isSameSize(input)) {
     output_ = CLTensor<FloatType<kWidth>::T>(context, input.sizes());
@@ -89,35 +93,116 @@ BatchNorm2d::forward(Context& context,
 
   input_ = input;
 
-  // FIXME: all of this work is planewise
+  if (layout_ == Layout::NHWC) {
+    return forwardNHWC(context, program, queue, input);
+  }
+
+  // The work is planewise: view the input as (batch x planes) rows of
+  // (h x w), with the per-plane parameters expanded to one per row
+  size_t batch = input.getSize(0);
+  size_t rows = batch * planes_;
+  size_t cols = input.numElements() / rows;
+
+  expandParameters(context, program, queue, batch);
 
-// For each plane, subtract
+  auto inView = input.view({rows, cols});
+  auto outView = output_.view({rows, cols});
 
   // in - mean
-  runBinaryMath(context, program, queue,
-                MathArg<FloatType<kWidth>::T>(input),
-                MathArg<FloatType<kWidth>::T>(runningMean_),
-                MathOp::Sub,
-                getRoundMode(),
-                output_);
+  runBinaryMathPerRow(context, program, queue,
+                      inView,
+                      rowMean_,
+                      MathOp::Sub,
+                      getRoundMode(),
+                      outView);
 
   // (in - mean) * (1 / sqrt(running_var) * w
-  runBinaryMath(context, program, queue,
-                MathArg<FloatType<kWidth>::T>(output_),
-                MathArg<FloatType<kWidth>::T>(factoredWeight_),
-                MathOp::Mul,
-                getRoundMode(),
-                output_);
+  runBinaryMathPerRow(context, program, queue,
+                      outView,
+                      rowWeight_,
+                      MathOp::Mul,
+                      getRoundMode(),
+                      outView);
 
   // (in - mean) * (1 / sqrt(running_var) * w + b
-  runBinaryMath(context, program, queue,
-                MathArg<FloatType<kWidth>::T>(output_),
-                MathArg<FloatType<kWidth>::T>(bias_),
-                MathOp::Sub,
-                getRoundMode(),
-                output_);
+  runBinaryMathPerRow(context, program, queue,
+                      outView,
+                      rowBias_,
+                      MathOp::Add,
+                      getRoundMode(),
+                      outView);
 
   return output_;
 }
 
+CLTensor<FloatType<kWidth>::T>&
+BatchNorm2d::forwardNHWC(Context& context,
+                         Program& program,
+                         Queue& queue,
+                         const CLTensor<FloatType<kWidth>::T>& input) {
+  // The plane is innermost: view the input as (batch x h x w) rows of
+  // planes, with the per-plane parameters broadcast along each row
+  size_t cols = planes_;
+  size_t rows = input.numElements() / cols;
+
+  auto inView = input.view({rows, cols});
+  auto outView = output_.view({rows, cols});
+
+  // (in - mean) * (1 / sqrt(running_var) * w + b
+  runBinaryMathPerCol(context, program, queue,
+                      inView,
+                      runningMean_,
+                      MathOp::Sub,
+                      getRoundMode(),
+                      outView);
+
+  runBinaryMathPerCol(context, program, queue,
+                      outView,
+                      factoredWeight_,
+                      MathOp::Mul,
+                      getRoundMode(),
+                      outView);
+
+  runBinaryMathPerCol(context, program, queue,
+                      outView,
+                      bias_,
+                      MathOp::Add,
+                      getRoundMode(),
+                      outView);
+
+  return output_;
+}
+
+void
+BatchNorm2d::expandParameters(Context& context,
+                              Program& program,
+                              Queue& queue,
+                              size_t copies) {
+  if (copies == rowCopies_) {
+    return;
+  }
+
+  size_t n = copies * planes_;
+
+  if (rowMean_.dims() != 1 || rowMean_.getSize(0) != n) {
+    rowMean_ = CLTensor<FloatType<kWidth>::T>(context, {n});
+    rowWeight_ = CLTensor<FloatType<kWidth>::T>(context, {n});
+    rowBias_ = CLTensor<FloatType<kWidth>::T>(context, {n});
+  }
+
+  for (auto p : {std::make_pair(&runningMean_, &rowMean_),
+        std::make_pair(&factoredWeight_, &rowWeight_),
+        std::make_pair(&bias_, &rowBias_)}) {
+    runMemcpy(context, program, queue,
+              *p.first,
+              planes_, // batch size
+              copies, // num batches
+              0, // src stride
+              planes_, // dst stride
+              *p.second);
+  }
+
+  rowCopies_ = copies;
+}
+
 } }
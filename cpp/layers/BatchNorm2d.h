@@ -36,10 +36,31 @@ struct BatchNorm2d : public Layer {
     Queue& queue,
     const CLTensor<FloatType<kWidth>::T>& in) override;
 
+  CLTensor<FloatType<kWidth>::T>& forwardNHWC(
+    Context& context,
+    Program& program,
+    Queue& queue,
+    const CLTensor<FloatType<kWidth>::T>& in);
+
+  // Fills the row tensors below with `copies` back to back copies of the
+  // per-plane parameters, unless they already hold them
+  void expandParameters(Context& context,
+                        Program& program,
+                        Queue& queue,
+                        size_t copies);
+
   CLTensor<FloatType<kWidth>::T> factoredWeight_;
   CLTensor<FloatType<kWidth>::T> runningMean_;
   CLTensor<FloatType<kWidth>::T> bias_;
 
+  // The above, expanded to one value per (batch, plane) for the NCHW forward
+  CLTensor<FloatType<kWidth>::T> rowMean_;
+  CLTensor<FloatType<kWidth>::T> rowWeight_;
+  CLTensor<FloatType<kWidth>::T> rowBias_;
+
+  // Copies held by the row tensors; 0 once the parameters change
+  size_t rowCopies_;
+
   int planes_;
 };
 
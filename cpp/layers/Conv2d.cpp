@@ -5,6 +5,7 @@
 // LICENSE file in the root directory of this source tree.
 #include "layers/Conv2d.h"
 
+#include "layers/BatchNorm2d.h"
 #include <cmath>
 #include <sstream>
 #include "ops/TensorConv.h"
@@ -14,43 +15,96 @@
 
 namespace facebook { namespace cl {
 
+namespace {
+
+// Validates the group count before any member sized by it is allocated
+int
+checkedGroups(int inPlane, int outPlane, int groups) {
+  CL_ASSERT(groups > 0);
+  CL_ASSERT_MSG(inPlane % groups == 0,
+                "input planes must be divisible by groups");
+  CL_ASSERT_MSG(outPlane % groups == 0,
+                "output planes must be divisible by groups");
+
+  return groups;
+}
+
+}
+
 Conv2d::Conv2d(Context& context,
                Program& program,
                Queue& queue,
                int inPlane,
                int outPlane,
-               int kernelHW,
-               int strideHW,
-               int padT,
-               int padL,
+               const KernelGeometry& geom,
                bool bias,
                int inputScale,
-               int outputScale)
-    : weight_(context, {outPlane, inPlane, kernelHW, kernelHW}),
+               int outputScale,
+               int groups)
+    : weight_(context, {outPlane,
+                        inPlane / checkedGroups(inPlane, outPlane, groups),
+                        geom.kH, geom.kW}),
       bias_(bias ? new CLTensor<FloatType<kWidth>::T>(context, {outPlane}) : nullptr),
+      gradWeight_(context, {outPlane, inPlane / groups, geom.kH, geom.kW}),
+      gradBias_(bias ? new CLTensor<FloatType<kWidth>::T>(context, {outPlane}) : nullptr),
+      weightNHWCValid_(false),
+      gradReLUSource_(nullptr),
       inPlane_(inPlane),
       outPlane_(outPlane),
-      kernelHW_(kernelHW),
-      strideHW_(strideHW),
-      padT_(padT),
-      padL_(padL),
+      geom_(geom),
+      groups_(groups),
       inputScale_(inputScale),
-      outputScale_(outputScale) {
+      outputScale_(outputScale),
+      fuseReLU_(false),
+      winograd_(false) {
+  CL_ASSERT(geom_.isValid());
+
   reset(context, program, queue);
 }
 
+Conv2d::Conv2d(Context& context,
+               Program& program,
+               Queue& queue,
+               int inPlane,
+               int outPlane,
+               int kernelHW,
+               int strideHW,
+               int padT,
+               int padL,
+               bool bias,
+               int inputScale,
+               int outputScale,
+               int groups)
+    : Conv2d(context, program, queue,
+             inPlane,
+             outPlane,
+             KernelGeometry::square(kernelHW, strideHW, padT, padL),
+             bias,
+             inputScale,
+             outputScale,
+             groups) {
+}
+
 std::string
 Conv2d::str() const {
   std::stringstream ss;
   ss << "Conv2d (in " << inPlane_
      << " out " << outPlane_
-     << " ker (" << kernelHW_
-     << ", " << kernelHW_
-     << ") st (" << strideHW_
-     << ", " << strideHW_
-     << ") pad (" << padT_
-     << ", " << padL_
-     << "))";
+     << " " << geom_.str();
+
+  if (groups_ > 1) {
+    ss << " groups " << groups_;
+  }
+
+  ss << ")";
+
+  if (winograd_) {
+    ss << " Winograd";
+  }
+
+  if (fuseReLU_) {
+    ss << " + ReLU";
+  }
 
   return ss.str();
 }
@@ -79,12 +133,15 @@ void
 Conv2d::reset(Context& context,
               Program& program,
               Queue& queue) {
-  float stdv = 1.0f / std::sqrt((float) kernelHW_ * inPlane_);
+  float stdv = 1.0f / std::sqrt((float) geom_.kH * (inPlane_ / groups_));
   runUniform(context, program, queue, -stdv, stdv, weight_);
+  weightNHWCValid_ = false;
 
   if (bias_) {
     runUniform(context, program, queue, -stdv, stdv, *bias_);
   }
+
+  updateWinogradWeight(context, program, queue);
 }
 
 void
@@ -92,10 +149,13 @@ Conv2d::setWeightHost(Context& context,
                       Program& program,
                       Queue& queue,
                       const HostTensor<float, 4>& weight) {
-  CL_ASSERT(weight.isSize({outPlane_, inPlane_, kernelHW_, kernelHW_}));
+  CL_ASSERT(weight.isSize({outPlane_, inPlane_ / groups_,
+          geom_.kH, geom_.kW}));
 
   CLTensor<float> tmp(context, queue, weight);
   runToPosit8(context, program, queue, tmp, weight_);
+  weightNHWCValid_ = false;
+  updateWinogradWeight(context, program, queue);
 }
 
 void
@@ -103,9 +163,12 @@ Conv2d::setWeight(Context& context,
                   Program& program,
                   Queue& queue,
                   const CLTensor<FloatType<kWidth>::T>& weight) {
-  CL_ASSERT(weight.isSize({outPlane_, inPlane_, kernelHW_, kernelHW_}));
+  CL_ASSERT(weight.isSize({outPlane_, inPlane_ / groups_,
+          geom_.kH, geom_.kW}));
 
   weight_ = weight;
+  weightNHWCValid_ = false;
+  updateWinogradWeight(context, program, queue);
 }
 
 const CLTensor<FloatType<kWidth>::T>&
@@ -113,6 +176,20 @@ Conv2d::getWeight() const {
   return weight_;
 }
 
+const CLTensor<FloatType<kWidth>::T>&
+Conv2d::getWeightNHWC(Context& context,
+                      Program& program,
+                      Queue& queue) {
+  if (!weightNHWCValid_) {
+    weightNHWC_ = CLTensor<FloatType<kWidth>::T>(
+      context, {(size_t) inPlane_ * geom_.kH * geom_.kW, (size_t) outPlane_});
+    runConvWeightToNHWC(context, program, queue, weight_, weightNHWC_);
+    weightNHWCValid_ = true;
+  }
+
+  return weightNHWC_;
+}
+
 void
 Conv2d::setBiasHost(Context& context,
                     Program& program,
@@ -123,6 +200,7 @@ Conv2d::setBiasHost(Context& context,
   CLTensor<float> tmp(context, queue, bias);
   if (!bias_) {
     bias_.reset(new CLTensor<FloatType<kWidth>::T>(context, {outPlane_}));
+    gradBias_.reset(new CLTensor<FloatType<kWidth>::T>(context, {outPlane_}));
   }
 
   runToPosit8(context, program, queue, tmp, *bias_);
@@ -137,6 +215,7 @@ Conv2d::setBias(Context& context,
 
   if (!bias_) {
     bias_.reset(new CLTensor<FloatType<kWidth>::T>(context, {outPlane_}));
+    gradBias_.reset(new CLTensor<FloatType<kWidth>::T>(context, {outPlane_}));
   }
 
   *bias_ = bias;
@@ -147,15 +226,142 @@ Conv2d::getBias() const {
   return bias_.get();
 }
 
+void
+Conv2d::setFuseReLU(bool fuse) {
+  fuseReLU_ = fuse;
+}
+
+bool
+Conv2d::getFuseReLU() const {
+  return fuseReLU_;
+}
+
+const KernelGeometry&
+Conv2d::getGeometry() const {
+  return geom_;
+}
+
+int
+Conv2d::getGroups() const {
+  return groups_;
+}
+
+bool
+Conv2d::canUseWinograd() const {
+  return groups_ == 1 &&
+    geom_.kH == 3 && geom_.kW == 3 &&
+    geom_.strideH == 1 && geom_.strideW == 1 &&
+    geom_.dilationH == 1 && geom_.dilationW == 1;
+}
+
+void
+Conv2d::setWinograd(Context& context,
+                    Program& program,
+                    Queue& queue,
+                    bool winograd) {
+  CL_ASSERT_MSG(!winograd || canUseWinograd(),
+                "Winograd is only for 3x3 stride 1 convolutions");
+
+  winograd_ = winograd;
+
+  if (winograd_) {
+    updateWinogradWeight(context, program, queue);
+  } else {
+    weightWinograd_ = CLTensor<FloatType<kWidth>::T>();
+    workspaceProd_ = CLTensor<FloatType<kWidth>::T>();
+  }
+}
+
+bool
+Conv2d::getWinograd() const {
+  return winograd_;
+}
+
+void
+Conv2d::updateWinogradWeight(Context& context,
+                             Program& program,
+                             Queue& queue) {
+  if (!winograd_) {
+    return;
+  }
+
+  if (!weightWinograd_.isSize({kWinogradTilePoints,
+          (size_t) outPlane_, (size_t) inPlane_})) {
+    weightWinograd_ = CLTensor<FloatType<kWidth>::T>(
+      context, {kWinogradTilePoints, (size_t) outPlane_, (size_t) inPlane_});
+  }
+
+  runWinogradFilterNCHW(context, program, queue, weight_, weightWinograd_);
+}
+
+void
+Conv2d::foldBatchNorm(Context& context,
+                      Program& program,
+                      Queue& queue,
+                      const BatchNorm2d& bn) {
+  CL_ASSERT(bn.planes_ == outPlane_);
+
+  // New tensors are produced, as our parameters may be shared with others
+  // via setWeight / setBias
+  CLTensor<FloatType<kWidth>::T> weight(context, weight_.sizes());
+
+  // w' = w * v, per output plane
+  auto weightView = weight.view({(size_t) outPlane_,
+        weight.numElements() / outPlane_});
+  runBinaryMathPerRow(context, program, queue,
+                      weight_.view({(size_t) outPlane_,
+                            weight_.numElements() / outPlane_}),
+                      bn.factoredWeight_,
+                      MathOp::Mul,
+                      RoundOp::R2NE,
+                      weightView);
+
+  // b' = (b - mean) * v + bn_b, with b = 0 if we have no bias
+  CLTensor<FloatType<kWidth>::T> centered(context, {outPlane_});
+  runBinaryMath(context, program, queue,
+                bias_ ?
+                MathArg<FloatType<kWidth>::T>(*bias_) :
+                MathArg<FloatType<kWidth>::T>(FloatType<kWidth>::kZero),
+                MathArg<FloatType<kWidth>::T>(bn.runningMean_),
+                MathOp::Sub,
+                RoundOp::R2NE,
+                centered);
+
+  CLTensor<FloatType<kWidth>::T> bias(context, {outPlane_});
+  runMulAdd(context, program, queue,
+            MathArg<FloatType<kWidth>::T>(bn.bias_),
+            0,
+            MathArg<FloatType<kWidth>::T>(centered),
+            MathArg<FloatType<kWidth>::T>(bn.factoredWeight_),
+            0,
+            false, // subtract
+            RoundOp::R2NE,
+            0,
+            bias);
+
+  weight_ = weight;
+  weightNHWCValid_ = false;
+  updateWinogradWeight(context, program, queue);
+  bias_.reset(new CLTensor<FloatType<kWidth>::T>(bias));
+
+  if (!gradBias_) {
+    gradBias_.reset(new CLTensor<FloatType<kWidth>::T>(context, {outPlane_}));
+  }
+}
+
 CLTensor<FloatType<kWidth>::T>&
 Conv2d::forward(Context& context,
                 Program& program,
                 Queue& queue,
                 const CLTensor<FloatType<kWidth>::T>& input) {
-  size_t outputH =
-    calcKernelOutputSize(input.getSize(2), padT_, padT_, kernelHW_, strideHW_);
-  size_t outputW =
-    calcKernelOutputSize(input.getSize(3), padL_, padL_, kernelHW_, strideHW_);
+  gradReLUSource_ = nullptr;
+
+  if (layout_ == Layout::NHWC) {
+    return forwardNHWC(context, program, queue, input);
+  }
+
+  size_t outputH = geom_.outputH(input.getSize(2));
+  size_t outputW = geom_.outputW(input.getSize(3));
 
   CL_ASSERT(input.dims() == 4);
   CL_ASSERT(input.getSize(1) == inPlane_);
@@ -172,28 +378,144 @@ Conv2d::forward(Context& context,
                                    outputW});
   }
 
+  if (groups_ > 1) {
+    runForwardGroupConv2dNCHW(context, program, queue,
+                              input,
+                              weight_,
+                              bias_.get(),
+                              groups_,
+                              geom_,
+                              getRoundMode(),
+                              inputScale_,
+                              outputScale_,
+                              output_,
+                              fuseReLU_);
+
+    return output_;
+  }
+
+  if (winograd_) {
+    runForwardConv2dWinogradNCHW(context, program, queue,
+                                 input,
+                                 workspace_,
+                                 workspaceProd_,
+                                 weightWinograd_,
+                                 bias_.get(),
+                                 geom_,
+                                 getRoundMode(),
+                                 inputScale_,
+                                 outputScale_,
+                                 output_,
+                                 fuseReLU_);
+
+    return output_;
+  }
+
   runForwardConv2dNCHW(context, program, queue,
                        input,
                        workspace_,
                        weight_,
                        bias_.get(),
-                       padT_,
-                       padL_,
-                       strideHW_,
+                       geom_,
                        getRoundMode(),
                        inputScale_,
                        outputScale_,
-                       output_);
+                       output_,
+                       fuseReLU_);
 
   return output_;
 }
 
+CLTensor<FloatType<kWidth>::T>&
+Conv2d::forwardNHWC(Context& context,
+                    Program& program,
+                    Queue& queue,
+                    const CLTensor<FloatType<kWidth>::T>& input) {
+  gradReLUSource_ = nullptr;
+
+  CL_ASSERT_MSG(groups_ == 1, "grouped convolution is NCHW only");
+  CL_ASSERT(input.dims() == 4);
+  CL_ASSERT(input.getSize(3) == inPlane_);
+
+  size_t outputH = geom_.outputH(input.getSize(1));
+  size_t outputW = geom_.outputW(input.getSize(2));
+
+  auto outSizes = getLayoutSizes(Layout::NHWC,
+                                 input.getSize(0), outPlane_, outputH, outputW);
+  if (output_.sizes() != outSizes) {
+    output_ = CLTensor<FloatType<kWidth>::T>(context, outSizes);
+  }
+
+  runForwardConv2dNHWC(context, program, queue,
+                       input,
+                       workspace_,
+                       getWeightNHWC(context, program, queue),
+                       bias_.get(),
+                       geom_,
+                       getRoundMode(),
+                       inputScale_,
+                       outputScale_,
+                       output_,
+                       fuseReLU_);
+
+  return output_;
+}
+
+const CLTensor<FloatType<kWidth>::T>&
+Conv2d::fuseReLUGrad(Context& context,
+                     Program& program,
+                     Queue& queue,
+                     const CLTensor<FloatType<kWidth>::T>& gradOutput) {
+  if (!fuseReLU_) {
+    return gradOutput;
+  }
+
+  if (gradReLUSource_ == &gradOutput) {
+    return gradReLU_;
+  }
+
+  if (!gradReLU_.isSameSize(gradOutput)) {
+    gradReLU_ = CLTensor<FloatType<kWidth>::T>(context, gradOutput.sizes());
+  }
+
+  // gradOutput of the convolution itself = output > 0 ? gradOutput : 0
+  runThresholdScalarHost(context, program, queue,
+                         output_, FloatType<kWidth>::kZero, gradOutput,
+                         CompareOp::GT, gradReLU_);
+  gradReLUSource_ = &gradOutput;
+
+  return gradReLU_;
+}
+
 CLTensor<FloatType<kWidth>::T>&
 Conv2d::updateGradInput(Context& context,
                         Program& program,
                         Queue& queue,
                         const CLTensor<FloatType<kWidth>::T>& input,
                         const CLTensor<FloatType<kWidth>::T>& gradOutput) {
+  CL_ASSERT_MSG(layout_ == Layout::NCHW, "NHWC is inference only");
+  CL_ASSERT_MSG(groups_ == 1, "grouped convolution is inference only");
+  CL_ASSERT(input.dims() == 4);
+  CL_ASSERT(input.getSize(1) == inPlane_);
+  CL_ASSERT(gradOutput.isSameSize(output_));
+
+  if (!gradInput_.isSameSize(input)) {
+    gradInput_ = CLTensor<FloatType<kWidth>::T>(context, input.sizes());
+  }
+
+  // gradOutput may have changed since a previous call
+  gradReLUSource_ = nullptr;
+
+  // gradInput = col2im(weight^t x gradOutput)
+  runBackwardInputConv2dNCHW(context, program, queue,
+                             fuseReLUGrad(context, program, queue, gradOutput),
+                             workspace_,
+                             weightTranspose_,
+                             weight_,
+                             geom_,
+                             getRoundMode(),
+                             gradInput_);
+
   return gradInput_;
 }
 
@@ -204,7 +526,33 @@ Conv2d::accGradParameters(Context& context,
                           float scale,
                           const CLTensor<FloatType<kWidth>::T>& input,
                           const CLTensor<FloatType<kWidth>::T>& gradOutput) {
-  CL_ASSERT(false);
+  // The matrix multiply has no alpha, so a scaled gradient is not supported
+  CL_ASSERT_MSG(scale == 1.0f,
+                "Conv2d only accumulates gradients with scale 1");
+  CL_ASSERT_MSG(layout_ == Layout::NCHW, "NHWC is inference only");
+  CL_ASSERT_MSG(groups_ == 1, "grouped convolution is inference only");
+  CL_ASSERT(input.dims() == 4);
+  CL_ASSERT(input.getSize(1) == inPlane_);
+  CL_ASSERT(gradOutput.isSameSize(output_));
+
+  // gradWeight += gradOutput x im2col(input)^t
+  // gradBias += gradOutput x [batch x output point 1s]
+
+  runBackwardWeightConv2dNCHW(context, program, queue,
+                              input,
+                              fuseReLUGrad(context, program, queue,
+                                           gradOutput),
+                              workspace_,
+                              colTranspose_,
+                              gradOutRows_,
+                              ones_,
+                              geom_,
+                              getRoundMode(),
+                              gradWeight_,
+                              gradBias_.get());
+
+  // A later call may pass the same gradOutput with new contents
+  gradReLUSource_ = nullptr;
 }
 
 std::vector<ParameterInfo>
@@ -213,14 +561,14 @@ Conv2d::getParameters() {
 
   ParameterInfo info;
   info.param = &weight_;
-  info.gradParam = nullptr; // FIXME
+  info.gradParam = &gradWeight_;
   info.name = str() + " W";
   params.emplace_back(std::move(info));
 
   if (bias_) {
     ParameterInfo info;
     info.param = bias_.get();
-    info.gradParam = nullptr; // FIXME
+    info.gradParam = gradBias_.get();
     info.name = str() + " bias";
     params.emplace_back(std::move(info));
   }
@@ -232,6 +580,10 @@ void
 Conv2d::zeroGrad(Context& context,
                  Program& program,
                  Queue& queue) {
+  runMemset(context, program, queue, FloatType<kWidth>::kZero, gradWeight_);
+  if (bias_) {
+    runMemset(context, program, queue, FloatType<kWidth>::kZero, *gradBias_);
+  }
 }
 
 } }
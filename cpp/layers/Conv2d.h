@@ -7,10 +7,27 @@
 
 #include <memory>
 #include "layers/Layer.h"
+#include "ops/KernelGeometry.h"
 
 namespace facebook { namespace cl {
 
+struct BatchNorm2d;
+
 struct Conv2d : public Layer {
+  Conv2d(Context& context,
+         Program& program,
+         Queue& queue,
+         int inPlane,
+         int outPlane,
+         const KernelGeometry& geom,
+         bool bias,
+         int inputScale,
+         int outputScale,
+         // input and output channels are split into this many groups, each
+         // only connected to its own; inPlane for depthwise convolution
+         int groups = 1);
+
+  // A square kernel with symmetric padding
   Conv2d(Context& context,
          Program& program,
          Queue& queue,
@@ -22,7 +39,8 @@ struct Conv2d : public Layer {
          int padL,
          bool bias,
          int inputScale,
-         int outputScale);
+         int outputScale,
+         int groups = 1);
 
   std::string str() const override;
 
@@ -47,6 +65,12 @@ struct Conv2d : public Layer {
 
   const CLTensor<FloatType<kWidth>::T>& getWeight() const;
 
+  // Our weight reordered for the NHWC layout, built on first use after the
+  // weight changes
+  const CLTensor<FloatType<kWidth>::T>& getWeightNHWC(Context& context,
+                                                     Program& program,
+                                                     Queue& queue);
+
   void setBiasHost(Context& context,
                    Program& program,
                    Queue& queue,
@@ -59,12 +83,44 @@ struct Conv2d : public Layer {
 
   const CLTensor<FloatType<kWidth>::T>* getBias() const;
 
+  // If set, max(x, 0) is applied to the output within the convolution
+  void setFuseReLU(bool fuse);
+  bool getFuseReLU() const;
+
+  const KernelGeometry& getGeometry() const;
+  int getGroups() const;
+
+  // Whether we are a dense 3x3 stride 1 convolution, which can use Winograd
+  bool canUseWinograd() const;
+
+  // If set, the NCHW forward pass uses Winograd F(2x2, 3x3) (see
+  // runForwardConv2dWinogradNCHW), with the weight transformed whenever it
+  // is set. This changes rounding, so it is chosen per layer.
+  void setWinograd(Context& context,
+                   Program& program,
+                   Queue& queue,
+                   bool winograd);
+  bool getWinograd() const;
+
+  // Folds a following batch norm into our weight and bias:
+  // w' = w * v, b' = (b - mean) * v + bn_b
+  void foldBatchNorm(Context& context,
+                     Program& program,
+                     Queue& queue,
+                     const BatchNorm2d& bn);
+
   CLTensor<FloatType<kWidth>::T>& forward(
     Context& context,
     Program& program,
     Queue& queue,
     const CLTensor<FloatType<kWidth>::T>& in) override;
 
+  CLTensor<FloatType<kWidth>::T>& forwardNHWC(
+    Context& context,
+    Program& program,
+    Queue& queue,
+    const CLTensor<FloatType<kWidth>::T>& in);
+
   CLTensor<FloatType<kWidth>::T>& updateGradInput(
     Context& context,
     Program& program,
@@ -72,6 +128,7 @@ struct Conv2d : public Layer {
     const CLTensor<FloatType<kWidth>::T>& input,
     const CLTensor<FloatType<kWidth>::T>& gradOutput) override;
 
+  // Only scale == 1 is supported
   void accGradParameters(
     Context& context,
     Program& program,
@@ -86,18 +143,59 @@ struct Conv2d : public Layer {
                 Program& program,
                 Queue& queue) override;
 
+  // Recomputes weightWinograd_ from weight_, if Winograd is in use
+  void updateWinogradWeight(Context& context,
+                            Program& program,
+                            Queue& queue);
+
+  // With a fused ReLU, masks gradOutput by our output, otherwise returns
+  // gradOutput. The mask computed by updateGradInput is reused if gradOutput
+  // is the same tensor.
+  const CLTensor<FloatType<kWidth>::T>& fuseReLUGrad(
+    Context& context,
+    Program& program,
+    Queue& queue,
+    const CLTensor<FloatType<kWidth>::T>& gradOutput);
+
   CLTensor<FloatType<kWidth>::T> weight_;
   std::unique_ptr<CLTensor<FloatType<kWidth>::T>> bias_;
+  CLTensor<FloatType<kWidth>::T> gradWeight_;
+  std::unique_ptr<CLTensor<FloatType<kWidth>::T>> gradBias_;
+
+  // weight_ as [kH x kW x in plane][out plane], valid if weightNHWCValid_
+  CLTensor<FloatType<kWidth>::T> weightNHWC_;
+  bool weightNHWCValid_;
+
+  // weight_ as [16][out plane][in plane], if winograd_
+  CLTensor<FloatType<kWidth>::T> weightWinograd_;
+
+  // im2col columns, shared by the forward and backward passes
   CLTensor<FloatType<kWidth>::T> workspace_;
+  CLTensor<FloatType<kWidth>::T> gradReLU_;
+
+  // The gradOutput that gradReLU_ was computed from by updateGradInput, if
+  // still valid
+  const CLTensor<FloatType<kWidth>::T>* gradReLUSource_;
+
+  // Backward pass scratch: weight_^t, the transposed im2col columns,
+  // gradOutput as [out plane][batch x output points], and a vector of 1s
+  // for gradBias
+  CLTensor<FloatType<kWidth>::T> weightTranspose_;
+  CLTensor<FloatType<kWidth>::T> colTranspose_;
+  CLTensor<FloatType<kWidth>::T> gradOutRows_;
+  CLTensor<FloatType<kWidth>::T> ones_;
+
+  // Winograd products, with the transformed input in workspace_
+  CLTensor<FloatType<kWidth>::T> workspaceProd_;
 
   int inPlane_;
   int outPlane_;
-  int kernelHW_;
-  int strideHW_;
-  int padT_;
-  int padL_;
+  KernelGeometry geom_;
+  int groups_;
   char inputScale_;
   char outputScale_;
+  bool fuseReLU_;
+  bool winograd_;
 };
 
 } } // namespace
@@ -0,0 +1,251 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "layers/Graph.h"
+
+#include <sstream>
+#include "utils/Profiler.h"
+
+namespace facebook { namespace cl {
+
+constexpr int Graph::kInput;
+constexpr int Graph::kPrev;
+constexpr int Graph::kNoResidual;
+
+Graph::Graph(const std::string& name)
+    : name_(name) {
+}
+
+std::string
+Graph::str() const {
+  std::stringstream ss;
+  ss << "Graph";
+  if (!name_.empty()) {
+    ss << " " << name_;
+  }
+
+  if (!nodes_.empty()) {
+    ss << "\n";
+  }
+
+  for (int i = 0; i < nodes_.size(); ++i) {
+    auto& node = nodes_[i];
+
+    ss << i << " (in " << node.input;
+    if (node.residual != kNoResidual) {
+      ss << ", residual " << node.residual;
+    }
+    if (node.bypass) {
+      ss << ", bypassed";
+    }
+    ss << "):\n";
+    ss << node.layer->str() << "\n";
+  }
+
+  return ss.str();
+}
+
+size_t
+Graph::numNodes() const {
+  return nodes_.size();
+}
+
+Layer&
+Graph::getNode(int id) {
+  CL_ASSERT(id >= 0 && id < nodes_.size());
+  return *nodes_[id].layer;
+}
+
+int
+Graph::getNodeInput(int id) const {
+  CL_ASSERT(id >= 0 && id < nodes_.size());
+  return nodes_[id].input;
+}
+
+int
+Graph::getNodeResidual(int id) const {
+  CL_ASSERT(id >= 0 && id < nodes_.size());
+  return nodes_[id].residual;
+}
+
+std::vector<int>
+Graph::getConsumers(int id) const {
+  CL_ASSERT(id >= 0 && id < nodes_.size());
+  std::vector<int> consumers;
+
+  for (int i = id + 1; i < nodes_.size(); ++i) {
+    auto& node = nodes_[i];
+    if (node.bypass) {
+      continue;
+    }
+
+    if (resolveBypass(node.input) == id) {
+      consumers.push_back(i);
+    }
+
+    if (node.residual != kNoResidual && resolveBypass(node.residual) == id) {
+      consumers.push_back(i);
+    }
+  }
+
+  if (resolveBypass((int) nodes_.size() - 1) == id) {
+    consumers.push_back(nodes_.size());
+  }
+
+  return consumers;
+}
+
+void
+Graph::bypassNode(int id) {
+  CL_ASSERT(id >= 0 && id < nodes_.size());
+  CL_ASSERT_MSG(nodes_[id].residual == kNoResidual,
+                "cannot bypass a residual node");
+
+  nodes_[id].bypass = true;
+}
+
+bool
+Graph::isBypassed(int id) const {
+  CL_ASSERT(id >= 0 && id < nodes_.size());
+  return nodes_[id].bypass;
+}
+
+int
+Graph::resolveBypass(int id) const {
+  while (id != kInput && nodes_[id].bypass) {
+    id = nodes_[id].input;
+  }
+
+  return id;
+}
+
+void
+Graph::setRoundMode(RoundOp mode) {
+  Layer::setRoundMode(mode);
+
+  for (auto& n : nodes_) {
+    n.layer->setRoundMode(mode);
+  }
+}
+
+RoundOp
+Graph::getRoundMode() const {
+  return Layer::getRoundMode();
+}
+
+void
+Graph::setLayout(Layout layout) {
+  Layer::setLayout(layout);
+
+  for (auto& n : nodes_) {
+    n.layer->setLayout(layout);
+  }
+}
+
+int
+Graph::resolveNode(int id) const {
+  if (id == kPrev) {
+    return (int) nodes_.size() - 1;
+  }
+
+  CL_ASSERT_MSG(id >= kInput && id < (int) nodes_.size(),
+                "graph edges must refer to the input or an earlier node");
+  return id;
+}
+
+int
+Graph::addNode(std::unique_ptr<Layer> layer, int input, int residual) {
+  Node node;
+  node.layer = std::move(layer);
+  node.input = resolveNode(input);
+  node.residual =
+    (residual == kNoResidual) ? kNoResidual : resolveNode(residual);
+  node.bypass = false;
+
+  nodes_.emplace_back(std::move(node));
+  return (int) nodes_.size() - 1;
+}
+
+int
+Graph::addResidual(Add l, int input, int residual) {
+  return addNode(std::unique_ptr<Layer>(new Add(std::move(l))),
+                 input, residual);
+}
+
+CLTensor<FloatType<kWidth>::T>&
+Graph::forward(Context& context,
+               Program& program,
+               Queue& queue,
+               const CLTensor<FloatType<kWidth>::T>& input) {
+  input_ = input;
+
+  ProfileScope graphScope([this]() {
+      return name_.empty() ? std::string("Graph") : name_;
+    });
+
+  // Outputs are owned by the layers; node ids index this
+  std::vector<CLTensor<FloatType<kWidth>::T>*> outs(nodes_.size(), nullptr);
+
+  auto getOut = [this, &outs](int id) -> CLTensor<FloatType<kWidth>::T>& {
+    return (id == kInput) ? input_ : *outs[id];
+  };
+
+  for (int i = 0; i < nodes_.size(); ++i) {
+    auto& node = nodes_[i];
+
+    if (node.bypass) {
+      outs[i] = &getOut(node.input);
+      continue;
+    }
+
+    if (node.residual != kNoResidual) {
+      // Only Add nodes are created with a residual edge (see addResidual)
+      static_cast<Add*>(node.layer.get())->setAdd(getOut(node.residual));
+    }
+
+    ProfileScope scope([&node, i]() {
+        return std::to_string(i) + ": " + node.layer->str();
+      });
+
+    outs[i] = &(node.layer->forward(context, program, queue,
+                                    getOut(node.input)));
+  }
+
+  if (!outs.empty()) {
+    output_ = *outs.back();
+  }
+
+  return output_;
+}
+
+std::vector<ParameterInfo>
+Graph::getParameters() {
+  std::vector<ParameterInfo> params;
+
+  for (auto& n : nodes_) {
+    if (n.bypass) {
+      continue;
+    }
+
+    auto lp = n.layer->getParameters();
+
+    params.insert(params.end(),
+                  std::make_move_iterator(lp.begin()),
+                  std::make_move_iterator(lp.end()));
+  }
+
+  return params;
+}
+
+void
+Graph::zeroGrad(Context& context,
+                Program& program,
+                Queue& queue) {
+  for (auto& n : nodes_) {
+    n.layer->zeroGrad(context, program, queue);
+  }
+}
+
+} }
@@ -0,0 +1,97 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <vector>
+#include "layers/Add.h"
+#include "layers/Layer.h"
+
+namespace facebook { namespace cl {
+
+// A directed acyclic graph of layers, evaluated in insertion order. Each node
+// consumes the output of an earlier node (or the graph input); residual nodes
+// are Add layers that take their second operand from another earlier node.
+struct Graph : public Layer {
+  // Node id referring to the input of the graph
+  static constexpr int kInput = -1;
+  // Node id referring to the most recently added node
+  static constexpr int kPrev = -2;
+
+  Graph(const std::string& name = "");
+
+  std::string str() const override;
+
+  size_t numNodes() const;
+  Layer& getNode(int id);
+
+  // Returns the id of the node feeding the primary input of `id`
+  int getNodeInput(int id) const;
+
+  // Returns the id of the node feeding the residual input of `id`, or
+  // kNoResidual if this is not a residual node
+  int getNodeResidual(int id) const;
+
+  // Returns the ids of the (non-bypassed) nodes reading the output of `id`;
+  // the graph output counts as a consumer of the last node, reported as
+  // numNodes()
+  std::vector<int> getConsumers(int id) const;
+
+  // Turns node `id` into the identity, e.g., after its work has been fused
+  // into the node producing its input. Node ids remain valid.
+  void bypassNode(int id);
+  bool isBypassed(int id) const;
+
+  // Returns the node whose output is seen through `id`, skipping bypassed
+  // nodes
+  int resolveBypass(int id) const;
+
+  void setRoundMode(RoundOp mode) override;
+  RoundOp getRoundMode() const override;
+
+  void setLayout(Layout layout) override;
+
+  CLTensor<FloatType<kWidth>::T>& forward(
+    Context& context,
+    Program& program,
+    Queue& queue,
+    const CLTensor<FloatType<kWidth>::T>& in) override;
+
+  std::vector<ParameterInfo> getParameters() override;
+
+  void zeroGrad(Context& context,
+                Program& program,
+                Queue& queue) override;
+
+  // Appends a layer consuming the output of node `input`; returns its id
+  template <typename LayerT>
+  int add(LayerT l, int input = kPrev) {
+    return addNode(std::unique_ptr<Layer>(new LayerT(std::move(l))),
+                   input, kNoResidual);
+  }
+
+  // Appends out = input + residual; returns its id
+  int addResidual(Add l, int input, int residual);
+
+  // Distinct from every node id, kInput and kPrev
+  static constexpr int kNoResidual = std::numeric_limits<int>::min();
+
+  struct Node {
+    std::unique_ptr<Layer> layer;
+    int input;
+    int residual;
+    bool bypass;
+  };
+
+  int addNode(std::unique_ptr<Layer> layer, int input, int residual);
+  int resolveNode(int id) const;
+
+  std::string name_;
+  std::vector<Node> nodes_;
+};
+
+} } // namespace
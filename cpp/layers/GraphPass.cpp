@@ -0,0 +1,344 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "layers/GraphPass.h"
+
+#include "layers/BatchNorm2d.h"
+#include "layers/Conv2d.h"
+#include "layers/Pool2d.h"
+#include "layers/ReLU.h"
+#include "layers/View.h"
+
+namespace facebook { namespace cl {
+
+GraphPass::~GraphPass() {
+}
+
+int
+GraphPass::getSoleConsumer(const Graph& graph, int id) {
+  auto consumers = graph.getConsumers(id);
+  if (consumers.size() != 1 || consumers[0] == graph.numNodes()) {
+    return -1;
+  }
+
+  int consumer = consumers[0];
+
+  // Must be read via the primary input, not a residual edge
+  if (graph.resolveBypass(graph.getNodeInput(consumer)) != id) {
+    return -1;
+  }
+
+  return consumer;
+}
+
+//
+// FoldBatchNormPass
+//
+
+std::string
+FoldBatchNormPass::str() const {
+  return "FoldBatchNorm";
+}
+
+bool
+FoldBatchNormPass::isExact() const {
+  return false;
+}
+
+int
+FoldBatchNormPass::run(Context& context,
+                       Program& program,
+                       Queue& queue,
+                       Graph& graph) {
+  int rewrites = 0;
+
+  for (int i = 0; i < graph.numNodes(); ++i) {
+    if (graph.isBypassed(i)) {
+      continue;
+    }
+
+    auto conv = dynamic_cast<Conv2d*>(&graph.getNode(i));
+    if (!conv || conv->getFuseReLU() || conv->getOutputScale() != 0) {
+      continue;
+    }
+
+    int next = getSoleConsumer(graph, i);
+    if (next == -1) {
+      continue;
+    }
+
+    auto bn = dynamic_cast<BatchNorm2d*>(&graph.getNode(next));
+    if (!bn || bn->planes_ != conv->outPlane_) {
+      continue;
+    }
+
+    conv->foldBatchNorm(context, program, queue, *bn);
+    graph.bypassNode(next);
+    ++rewrites;
+  }
+
+  return rewrites;
+}
+
+//
+// FuseConvReLUPass
+//
+
+std::string
+FuseConvReLUPass::str() const {
+  return "FuseConvReLU";
+}
+
+bool
+FuseConvReLUPass::isExact() const {
+  return true;
+}
+
+int
+FuseConvReLUPass::run(Context& context,
+                      Program& program,
+                      Queue& queue,
+                      Graph& graph) {
+  int rewrites = 0;
+
+  for (int i = 0; i < graph.numNodes(); ++i) {
+    if (graph.isBypassed(i)) {
+      continue;
+    }
+
+    auto conv = dynamic_cast<Conv2d*>(&graph.getNode(i));
+    if (!conv || conv->getFuseReLU()) {
+      continue;
+    }
+
+    int next = getSoleConsumer(graph, i);
+    if (next == -1 || !dynamic_cast<ReLU*>(&graph.getNode(next))) {
+      continue;
+    }
+
+    conv->setFuseReLU(true);
+    graph.bypassNode(next);
+    ++rewrites;
+  }
+
+  return rewrites;
+}
+
+//
+// FuseAddReLUPass
+//
+
+std::string
+FuseAddReLUPass::str() const {
+  return "FuseAddReLU";
+}
+
+bool
+FuseAddReLUPass::isExact() const {
+  return true;
+}
+
+int
+FuseAddReLUPass::run(Context& context,
+                     Program& program,
+                     Queue& queue,
+                     Graph& graph) {
+  int rewrites = 0;
+
+  for (int i = 0; i < graph.numNodes(); ++i) {
+    if (graph.isBypassed(i)) {
+      continue;
+    }
+
+    auto add = dynamic_cast<Add*>(&graph.getNode(i));
+    if (!add || add->getFuseReLU()) {
+      continue;
+    }
+
+    int next = getSoleConsumer(graph, i);
+    if (next == -1 || !dynamic_cast<ReLU*>(&graph.getNode(next))) {
+      continue;
+    }
+
+    add->setFuseReLU(true);
+    graph.bypassNode(next);
+    ++rewrites;
+  }
+
+  return rewrites;
+}
+
+//
+// FusePoolViewPass
+//
+
+std::string
+FusePoolViewPass::str() const {
+  return "FusePoolView";
+}
+
+bool
+FusePoolViewPass::isExact() const {
+  return true;
+}
+
+int
+FusePoolViewPass::run(Context& context,
+                      Program& program,
+                      Queue& queue,
+                      Graph& graph) {
+  int rewrites = 0;
+
+  for (int i = 0; i < graph.numNodes(); ++i) {
+    if (graph.isBypassed(i)) {
+      continue;
+    }
+
+    auto pool = dynamic_cast<Pool2d*>(&graph.getNode(i));
+    if (!pool || !pool->outputViewDims_.empty()) {
+      continue;
+    }
+
+    int next = getSoleConsumer(graph, i);
+    if (next == -1) {
+      continue;
+    }
+
+    auto view = dynamic_cast<View*>(&graph.getNode(next));
+    if (!view) {
+      continue;
+    }
+
+    pool->setOutputView(view->newDims_);
+    graph.bypassNode(next);
+    ++rewrites;
+  }
+
+  return rewrites;
+}
+
+//
+// WinogradConvPass
+//
+
+std::string
+WinogradConvPass::str() const {
+  return "WinogradConv";
+}
+
+bool
+WinogradConvPass::isExact() const {
+  return false;
+}
+
+int
+WinogradConvPass::run(Context& context,
+                      Program& program,
+                      Queue& queue,
+                      Graph& graph) {
+  int rewrites = 0;
+
+  for (int i = 0; i < graph.numNodes(); ++i) {
+    if (graph.isBypassed(i)) {
+      continue;
+    }
+
+    auto conv = dynamic_cast<Conv2d*>(&graph.getNode(i));
+    if (!conv || !conv->canUseWinograd() || conv->getWinograd() ||
+        conv->getLayout() != Layout::NCHW) {
+      continue;
+    }
+
+    conv->setWinograd(context, program, queue, true);
+    ++rewrites;
+  }
+
+  return rewrites;
+}
+
+//
+// Pass driver
+//
+
+namespace {
+
+HostTensor<FloatType<kWidth>::T, 1>
+evalGraph(Context& context,
+          Program& program,
+          Queue& queue,
+          Graph& graph,
+          const CLTensor<FloatType<kWidth>::T>& input) {
+  auto& out = graph.forward(context, program, queue, input);
+
+  return out.view({out.numElements()}).toHost<1>(queue);
+}
+
+}
+
+std::vector<GraphPassResult>
+runGraphPasses(Context& context,
+               Program& program,
+               Queue& queue,
+               Graph& graph,
+               const std::vector<std::unique_ptr<GraphPass>>& passes,
+               const CLTensor<FloatType<kWidth>::T>* verifyInput) {
+  std::vector<GraphPassResult> results;
+
+  HostTensor<FloatType<kWidth>::T, 1> ref;
+  if (verifyInput) {
+    ref = evalGraph(context, program, queue, graph, *verifyInput);
+  }
+
+  for (auto& pass : passes) {
+    GraphPassResult result;
+    result.pass = pass->str();
+    result.rewrites = pass->run(context, program, queue, graph);
+    result.mismatches = 0;
+    result.numElements = 0;
+
+    if (verifyInput && result.rewrites > 0) {
+      auto out = evalGraph(context, program, queue, graph, *verifyInput);
+      CL_ASSERT(out.numElements() == ref.numElements());
+
+      for (size_t i = 0; i < out.numElements(); ++i) {
+        if (out.data()[i] != ref.data()[i]) {
+          ++result.mismatches;
+        }
+      }
+
+      result.numElements = out.numElements();
+
+      CL_ASSERT_MSG(!pass->isExact() || result.mismatches == 0,
+                    "an exact graph pass changed the graph output");
+
+      // Later passes are compared against this pass' output, so that
+      // differences are attributed to the pass introducing them
+      ref = std::move(out);
+    }
+
+    results.push_back(result);
+  }
+
+  return results;
+}
+
+std::vector<GraphPassResult>
+optimizeGraph(Context& context,
+              Program& program,
+              Queue& queue,
+              Graph& graph,
+              const CLTensor<FloatType<kWidth>::T>* verifyInput) {
+  std::vector<std::unique_ptr<GraphPass>> passes;
+
+  // Batch norm must be folded before the convolution can absorb a ReLU
+  passes.emplace_back(new FoldBatchNormPass);
+  passes.emplace_back(new FuseConvReLUPass);
+  passes.emplace_back(new FuseAddReLUPass);
+  passes.emplace_back(new FusePoolViewPass);
+
+  return runGraphPasses(context, program, queue, graph, passes, verifyInput);
+}
+
+} }
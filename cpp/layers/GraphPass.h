@@ -0,0 +1,123 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "layers/Graph.h"
+
+namespace facebook { namespace cl {
+
+// A rewrite of a layer graph. Passes match a producer node followed by its
+// only consumer and fold the consumer's work into the producer, bypassing the
+// consumer in the graph.
+struct GraphPass {
+  virtual ~GraphPass();
+
+  virtual std::string str() const = 0;
+
+  // Whether the rewritten graph is expected to produce bit-identical results
+  // to the original graph
+  virtual bool isExact() const = 0;
+
+  // Applies the pass to `graph`, returning the number of rewrites performed
+  virtual int run(Context& context,
+                  Program& program,
+                  Queue& queue,
+                  Graph& graph) = 0;
+
+ protected:
+  // Returns the id of the single consumer of `id` if it is a node whose
+  // primary input is `id`, or -1 otherwise
+  static int getSoleConsumer(const Graph& graph, int id);
+};
+
+// Conv2d -> BatchNorm2d becomes Conv2d with rescaled weight and bias. The
+// folded parameters are rounded once more than the unfused computation, so
+// this is not exact.
+struct FoldBatchNormPass : public GraphPass {
+  std::string str() const override;
+  bool isExact() const override;
+  int run(Context& context,
+          Program& program,
+          Queue& queue,
+          Graph& graph) override;
+};
+
+// Conv2d (+ bias) -> ReLU becomes a single convolution kernel call
+struct FuseConvReLUPass : public GraphPass {
+  std::string str() const override;
+  bool isExact() const override;
+  int run(Context& context,
+          Program& program,
+          Queue& queue,
+          Graph& graph) override;
+};
+
+// Add -> ReLU becomes a single mul-add kernel call
+struct FuseAddReLUPass : public GraphPass {
+  std::string str() const override;
+  bool isExact() const override;
+  int run(Context& context,
+          Program& program,
+          Queue& queue,
+          Graph& graph) override;
+};
+
+// Pool2d -> View has the pool produce the viewed output directly
+struct FusePoolViewPass : public GraphPass {
+  std::string str() const override;
+  bool isExact() const override;
+  int run(Context& context,
+          Program& program,
+          Queue& queue,
+          Graph& graph) override;
+};
+
+// Has every 3x3 stride 1 Conv2d use Winograd F(2x2, 3x3) convolution. This
+// changes rounding, so it is not exact; the mismatches reported by
+// runGraphPasses give its effect on the graph output.
+struct WinogradConvPass : public GraphPass {
+  std::string str() const override;
+  bool isExact() const override;
+  int run(Context& context,
+          Program& program,
+          Queue& queue,
+          Graph& graph) override;
+};
+
+struct GraphPassResult {
+  std::string pass;
+  int rewrites;
+
+  // Number of output elements that differ from the graph before the pass; 0
+  // if the pass was not verified
+  size_t mismatches;
+  size_t numElements;
+};
+
+// Runs `passes` in order over `graph`. If `verifyInput` is given, the graph is
+// evaluated on it before and after each pass that performed a rewrite, and
+// an exact pass that changes the output throws.
+std::vector<GraphPassResult>
+runGraphPasses(Context& context,
+               Program& program,
+               Queue& queue,
+               Graph& graph,
+               const std::vector<std::unique_ptr<GraphPass>>& passes,
+               const CLTensor<FloatType<kWidth>::T>* verifyInput = nullptr);
+
+// Runs the default set of passes: batch norm folding, conv / add + ReLU and
+// pool + view fusion
+std::vector<GraphPassResult>
+optimizeGraph(Context& context,
+              Program& program,
+              Queue& queue,
+              Graph& graph,
+              const CLTensor<FloatType<kWidth>::T>* verifyInput = nullptr);
+
+} } // namespace
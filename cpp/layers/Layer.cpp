@@ -8,7 +8,8 @@
 namespace facebook { namespace cl {
 
 Layer::Layer()
-    : roundMode_(RoundOp::R2NE) {
+    : roundMode_(RoundOp::R2NE),
+      layout_(Layout::NCHW) {
 }
 
 Layer::~Layer() {
@@ -30,6 +31,16 @@ Layer::getRoundMode() const {
   return roundMode_;
 }
 
+void
+Layer::setLayout(Layout layout) {
+  layout_ = layout;
+}
+
+Layout
+Layer::getLayout() const {
+  return layout_;
+}
+
 CLTensor<FloatType<kWidth>::T>&
 Layer::forward(
   Context& context,
@@ -7,6 +7,7 @@
 
 #include "FloatDefs.h"
 #include "utils/Tensor.h"
+#include "ops/Layout.h"
 #include "ops/RoundOp.h"
 #include <string>
 
@@ -37,6 +38,11 @@ struct Layer {
   virtual void setRoundMode(RoundOp mode);
   virtual RoundOp getRoundMode() const;
 
+  // Layout of the 4-d activations consumed and produced; layers whose work
+  // doesn't depend on it ignore it
+  virtual void setLayout(Layout layout);
+  virtual Layout getLayout() const;
+
   virtual CLTensor<FloatType<kWidth>::T>& forward(
     Context& context,
     Program& program,
@@ -71,6 +77,7 @@ struct Layer {
   CLTensor<FloatType<kWidth>::T> output_;
   CLTensor<FloatType<kWidth>::T> gradInput_;
   RoundOp roundMode_;
+  Layout layout_;
 };
 
 } } // namespace
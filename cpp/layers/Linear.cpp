@@ -12,6 +12,15 @@
 
 namespace facebook { namespace cl {
 
+namespace {
+
+// Up to this batch size, the forward pass uses the matrix-vector kernel,
+// which streams the weight once per few vectors rather than padding the
+// batch to a full matrix multiply tile
+constexpr size_t kMaxMVBatch = 8;
+
+}
+
 Linear::Linear(Context& context,
                Program& program,
                Queue& queue,
@@ -148,25 +157,34 @@ Linear::forward(Context& context,
 
     CL_ASSERT(output_.getSize(0) == weight_.getSize(0));
 
-    if (bias_) {
-      CL_ASSERT(output_.getSize(0) == bias_->getSize(0));
-
-      runMemcpy(context, program, queue,
-                *bias_,
-                output_.getSize(0),
-                1,
-                0,
-                0,
-                output_);
+    // The bias is added within the kernel
+    runMVBias(context, program, queue,
+              weight_, input,
+              bias_.get(),
+              false, // relu
+              getRoundMode(),
+              inputScale_,
+              outputScale_,
+              output_);
+  } else if (input.dims() == 2 && input.getSize(0) <= kMaxMVBatch) {
+    int numBatch = input.getSize(0);
+
+    if ((output_.dims() != 2) ||
+        (output_.getSize(0) != numBatch) ||
+        (output_.getSize(1) != outFeatures_)) {
+      output_ = CLTensor<FloatType<kWidth>::T>(context, {numBatch, outFeatures_});
     }
 
-    runMV(context, program, queue,
-          weight_, input,
-          (bool) bias_, /* beta */
-          getRoundMode(),
-          inputScale_,
-          outputScale_,
-          output_);
+    // Each input row is a vector against the shared weight:
+    // (out x in) x (in) = (out), per batch row
+    runMVBias(context, program, queue,
+              weight_, input,
+              bias_.get(),
+              false, // relu
+              getRoundMode(),
+              inputScale_,
+              outputScale_,
+              output_);
   } else if (input.dims() == 2) {
     int numBatch = input.getSize(0);
 
@@ -176,29 +194,17 @@ Linear::forward(Context& context,
       output_ = CLTensor<FloatType<kWidth>::T>(context, {numBatch, outFeatures_});
     }
 
-    if (bias_) {
-      runMemcpy(context, program, queue,
-                *bias_,
-                // Size of batch
-                output_.getSize(1),
-                // Total number of batches
-                numBatch,
-                // Source stride
-                0,
-                // Dest stride
-                output_.getStride(0),
-                // Output
-                output_);
-    }
-
-    // (batch x in) x (in x out) = (batch x out)
-    runMM(context, program, queue,
-          input, weightTranspose_,
-          (bool) bias_ /* beta */,
-          getRoundMode(),
-          inputScale_,
-          outputScale_,
-          output_);
+    // (batch x in) x (in x out) = (batch x out), with the bias broadcast
+    // along each output row within the kernel
+    runMMBias(context, program, queue,
+              input, weightTranspose_,
+              bias_.get(),
+              bias_ ? BiasMode::Col : BiasMode::None,
+              false, // relu
+              getRoundMode(),
+              inputScale_,
+              outputScale_,
+              output_);
   }
 
   return output_;
@@ -5,9 +5,9 @@
 // LICENSE file in the root directory of this source tree.
 #include "layers/LogSoftmax.h"
 
+#include "ops/TensorInspect.h"
 #include "ops/TensorMath.h"
 #include "ops/TensorMemory.h"
-#include "ops/TensorPrint.h"
 #include <cmath>
 
 namespace facebook { namespace cl {
@@ -15,8 +15,7 @@ namespace facebook { namespace cl {
 LogSoftmax::LogSoftmax(Context& context,
                        Program& program,
                        Queue& queue)
-    : max_(context, {1}),
-      sum_(context, {1}) {
+    : sum_(context, {1}) {
 }
 
 std::string
@@ -35,48 +34,9 @@ LogSoftmax::forward(Context& context,
 
   input_ = input;
 
-  // max_ = max(x_i)
-  runReduce(context, program, queue,
-            input,
-            MathOp::Max,
-            getRoundMode(),
-            max_);
-
-  // tmp = x_i - max(x_i)
-  output_.copyFrom(queue, input);
-
-  runBinaryMath(context, program, queue,
-                MathArg<FloatType<kWidth>::T>(output_),
-                MathArg<FloatType<kWidth>::T>(max_, ScalarOp::Scalar),
-                MathOp::Sub,
-                getRoundMode(),
-                output_);
-
-  // tmp = exp(x_i - max(x_i))
-  runExp(context, program, queue, output_, output_);
-
-  // sum_ = sum(exp(x_i - max(x_i)))
-  runReduce(context, program, queue,
-            output_,
-            MathOp::Add,
-            getRoundMode(),
-            sum_);
-
-  // sum_ = max(x_i) + log(sum_)
-  runLn(context, program, queue, sum_, sum_);
-  runBinaryMath(context, program, queue,
-                MathArg<FloatType<kWidth>::T>(max_),
-                MathArg<FloatType<kWidth>::T>(sum_),
-                MathOp::Add,
-                getRoundMode(),
-                sum_);
-
-  // out = x_i - (max(x_i) + log(sum_))
-  output_.copyFrom(queue, input);
-  runBinaryMath(context, program, queue,
-                MathArg<FloatType<kWidth>::T>(output_),
-                MathArg<FloatType<kWidth>::T>(sum_, ScalarOp::Scalar),
-                MathOp::Sub,
+  // Row-wise, in a single launch
+  runLogSoftmax(context, program, queue,
+                input,
                 getRoundMode(),
                 output_);
 
@@ -100,68 +60,72 @@ LogSoftmax::updateGradInput(Context& context,
     inputExp_ = CLTensor<FloatType<kWidth>::T>(context, input.sizes());
   }
 
-  // gradInput = gradOutput - sum(gradOutput) * exp(output)
-  // exp(output) = exp(input[i]) / sum(exp(input[j]))
-  runExp(context, program, queue, input, inputExp_);
+  // Row-wise, gradInput = gradOutput - sum(gradOutput) * exp(output)
+  runExp(context, program, queue, output_, inputExp_);
+
+  auto layerName = []() { return std::string("LogSoftmax"); };
+  inspectTensor(context, program, queue, layerName, "softmax", inputExp_);
+
+  if (input.dims() == 1) {
+    if (sum_.numElements() != 1) {
+      sum_ = CLTensor<FloatType<kWidth>::T>(context, {1});
+    }
+
+    // sum_ = sum(gradOutput)
+    runReduce(context, program, queue,
+              gradOutput,
+              MathOp::Add,
+              getRoundMode(),
+              sum_);
+
+    inspectTensor(context, program, queue, layerName,
+                  "sum(gradOutput)", sum_);
+
+    // gradOutput - sum_ * exp(output), rounded once
+    runMulAdd(context, program, queue,
+              MathArg<FloatType<kWidth>::T>(gradOutput),
+              0,
+              MathArg<FloatType<kWidth>::T>(sum_, ScalarOp::Scalar),
+              MathArg<FloatType<kWidth>::T>(inputExp_),
+              0,
+              true, // subtract
+              getRoundMode(),
+              0,
+              gradInput_);
+
+    return gradInput_;
+  }
 
-  runReduce(context, program, queue,
-            inputExp_,
-            MathOp::Add,
-            getRoundMode(),
-            sum_);
+  CL_ASSERT(input.dims() == 2);
 
-  std::cout << "inputExp_\n";
-  printPositTensor(context, program, queue,
-                   inputExp_);
+  // sum_[i] = sum_j(gradOutput[i][j])
+  if (sum_.dims() != 1 || sum_.getSize(0) != input.getSize(0)) {
+    sum_ = CLTensor<FloatType<kWidth>::T>(context, {input.getSize(0)});
+  }
+
+  runReduceDim(context, program, queue,
+               gradOutput,
+               {1},
+               ReduceOp::Sum,
+               getRoundMode(),
+               sum_);
 
-  std::cout << "inputExp_ sum\n";
-  printPositTensor(context, program, queue,
-                   sum_);
+  inspectTensor(context, program, queue, layerName, "sum(gradOutput)", sum_);
+
+  // inputExp[i][j] = sum_[i] * exp(output[i][j])
+  runBinaryMathPerRow(context, program, queue,
+                      inputExp_,
+                      sum_,
+                      MathOp::Mul,
+                      getRoundMode(),
+                      inputExp_);
 
-  // inputExp = exp(output) = exp(input[i]) / sum(exp(input[j]))
   runBinaryMath(context, program, queue,
+                MathArg<FloatType<kWidth>::T>(gradOutput),
                 MathArg<FloatType<kWidth>::T>(inputExp_),
-                MathArg<FloatType<kWidth>::T>(sum_, ScalarOp::Scalar),
-                MathOp::Div,
+                MathOp::Sub,
                 getRoundMode(),
-                inputExp_);
-
-  std::cout << "div\n";
-  printPositTensor(context, program, queue,
-                   inputExp_);
-
-  // sum_ = sum(gradOutput)
-  runReduce(context, program, queue,
-            gradOutput,
-            MathOp::Add,
-            getRoundMode(),
-            sum_);
-
-  std::cout << "sum(gradOutput)\n";
-  printPositTensor(context, program, queue,
-                   sum_);
-
-  std::cout << "gradOutput\n";
-  printPositTensor(context, program, queue,
-                   gradOutput);
-
-  runMemset(context, program, queue, FloatType<kWidth>::kInf, gradInput_);
-
-  // gradOutput - sum_ * inputExp
-  runMulAdd(context, program, queue,
-            MathArg<FloatType<kWidth>::T>(gradOutput),
-            0,
-            MathArg<FloatType<kWidth>::T>(sum_, ScalarOp::Scalar),
-            MathArg<FloatType<kWidth>::T>(inputExp_),
-            0,
-            true, // subtract
-            getRoundMode(),
-            0,
-            gradInput_);
-
-  std::cout << "gradInput_\n";
-  printPositTensor(context, program, queue,
-                   gradInput_);
+                gradInput_);
 
   return gradInput_;
 }
@@ -29,7 +29,6 @@ struct LogSoftmax : public Layer {
     const CLTensor<FloatType<kWidth>::T>& input,
     const CLTensor<FloatType<kWidth>::T>& gradOutput) override;
 
-  CLTensor<FloatType<kWidth>::T> max_;
   CLTensor<FloatType<kWidth>::T> sum_;
   CLTensor<FloatType<kWidth>::T> inputExp_;
 };
@@ -16,6 +16,7 @@ NLLLoss::NLLLoss(Context& context,
                  Program& program,
                  Queue& queue)
     : sizeAverage_(true),
+      totalWeightBatch_(0),
       roundMode_(RoundOp::R2NE) {
 }
 
@@ -99,8 +100,10 @@ NLLLoss::forward(Context& context,
                 MathOp::Add,
                 getRoundMode(),
                 totalWeight_);
-    } else {
-      // sum_j weight[target[i]]
+      totalWeightBatch_ = 0;
+    } else if (totalWeightBatch_ != batchSize) {
+      // sum_j weight[target[i]] = batchSize; encoded on the device, whose
+      // rounding is defined by the RTL, and only when the batch size changes
       auto weightSumFloatHost = HostTensor<float, 1>({1});
       weightSumFloatHost[0] = (float) batchSize;
 
@@ -109,6 +112,7 @@ NLLLoss::forward(Context& context,
 
       runToPosit8(context, program, queue,
                   weightSumFloatDevice, totalWeight_);
+      totalWeightBatch_ = batchSize;
     }
 
     // div by totalWeight_ scalar
@@ -195,4 +199,40 @@ NLLLoss::updateGradInput(Context& context,
   return gradInput_;
 }
 
+CLTensor<FloatType<kWidth>::T>&
+NLLLoss::forwardLogSoftmax(Context& context,
+                           Program& program,
+                           Queue& queue,
+                           const CLTensor<FloatType<kWidth>::T>& input,
+                           const CLTensor<unsigned int>& target) {
+  CL_ASSERT(input.dims() <= 2);
+  CL_ASSERT(target.dims() == 1);
+  auto batchSize = input.dims() == 1 ? (size_t) 1 : input.getSize(0);
+  CL_ASSERT(target.getSize(0) == batchSize);
+
+  if (output_.dims() != 1 || output_.getSize(0) != batchSize) {
+    output_ = CLTensor<FloatType<kWidth>::T>(context, {batchSize});
+  }
+
+  if (!logSoftmax_.isSameSize(input)) {
+    logSoftmax_ = CLTensor<FloatType<kWidth>::T>(context, input.sizes());
+  }
+
+  if (!gradInput_.isSameSize(input)) {
+    gradInput_ = CLTensor<FloatType<kWidth>::T>(context, input.sizes());
+  }
+
+  runLogSoftmax(context, program, queue,
+                input,
+                getRoundMode(),
+                logSoftmax_,
+                &target,
+                weight_.get(),
+                sizeAverage_,
+                &output_,
+                &gradInput_);
+
+  return output_;
+}
+
 } }
@@ -36,6 +36,17 @@ struct NLLLoss {
                                     const CLTensor<FloatType<kWidth>::T>& input,
                                     const CLTensor<unsigned int>& target);
 
+  // Fused LogSoftmax and NLLLoss over the logits `input`, in a single
+  // launch: output_ is the loss, as forward(LogSoftmax(input)), logSoftmax_
+  // the log-softmax and gradInput_ the gradient of the loss with respect to
+  // `input` (not to the log-softmax)
+  CLTensor<FloatType<kWidth>::T>& forwardLogSoftmax(
+    Context& context,
+    Program& program,
+    Queue& queue,
+    const CLTensor<FloatType<kWidth>::T>& input,
+    const CLTensor<unsigned int>& target);
+
   bool sizeAverage_;
 
   /// The user-defined weight if available
@@ -43,9 +54,15 @@ struct NLLLoss {
   CLTensor<FloatType<kWidth>::T> output_;
   CLTensor<FloatType<kWidth>::T> gradInput_;
 
+  // Written by forwardLogSoftmax
+  CLTensor<FloatType<kWidth>::T> logSoftmax_;
+
   // sum of weights used
   CLTensor<FloatType<kWidth>::T> totalWeight_;
 
+  // Batch size encoded in totalWeight_ without a user weight, or 0
+  size_t totalWeightBatch_;
+
   RoundOp roundMode_;
 };
 
@@ -12,6 +12,20 @@
 
 namespace facebook { namespace cl {
 
+Pool2d::Pool2d(Context& context,
+               Program& program,
+               Queue& queue,
+               const KernelGeometry& geom,
+               PoolOp poolType,
+               int inScale,
+               int outScale)
+    : geom_(geom),
+      poolType_(poolType),
+      inputScale_(inScale),
+      outputScale_(outScale) {
+  CL_ASSERT(geom_.isValid());
+}
+
 Pool2d::Pool2d(Context& context,
                Program& program,
                Queue& queue,
@@ -22,13 +36,11 @@ Pool2d::Pool2d(Context& context,
                PoolOp poolType,
                int inScale,
                int outScale)
-    : kernelHW_(kernelHW),
-      strideHW_(strideHW),
-      padT_(padT),
-      padL_(padL),
-      poolType_(poolType),
-      inputScale_(inScale),
-      outputScale_(outScale) {
+    : Pool2d(context, program, queue,
+             KernelGeometry::square(kernelHW, strideHW, padT, padL),
+             poolType,
+             inScale,
+             outScale) {
 }
 
 void
@@ -56,52 +68,68 @@ Pool2d::str() const {
   std::stringstream ss;
   ss << "Pool2d ("
      << (poolType_ == PoolOp::Avg ? "avg" : "max")
-     << " size (" << kernelHW_
-     << ", " << kernelHW_
-     << ") st " << strideHW_
-     << ", " << strideHW_
-     << ") pad (" << padT_
-     << ", " << padL_
-     << "))";
+     << " " << geom_.str()
+     << ")";
+
+  if (!outputViewDims_.empty()) {
+    ss << " + View";
+  }
 
   return ss.str();
 }
 
+void
+Pool2d::setOutputView(const std::vector<std::vector<int>>& newDims) {
+  outputViewDims_ = newDims;
+}
+
 CLTensor<FloatType<kWidth>::T>&
 Pool2d::forward(Context& context,
                 Program& program,
                 Queue& queue,
                 const CLTensor<FloatType<kWidth>::T>& input) {
-  size_t outputH =
-    calcKernelOutputSize(input.getSize(2), padT_, padT_, kernelHW_, strideHW_);
-  size_t outputW =
-    calcKernelOutputSize(input.getSize(3), padL_, padL_, kernelHW_, strideHW_);
-
   CL_ASSERT(input.dims() == 4);
 
-  if (output_.dims() != 4 ||
-      output_.getSize(0) != input.getSize(0) ||
-      output_.getSize(1) != input.getSize(1) ||
-      output_.getSize(2) != outputH ||
-      output_.getSize(3) != outputW) {
-    output_ = CLTensor<FloatType<kWidth>::T>(context,
-                               {input.getSize(0),
-                                   input.getSize(1),
-                                   outputH,
-                                   outputW});
+  auto dims = getLayoutDims(layout_);
+
+  size_t outputH = geom_.outputH(input.getSize(dims.h));
+  size_t outputW = geom_.outputW(input.getSize(dims.w));
+
+  auto outSizes = getLayoutSizes(layout_,
+                                 input.getSize(dims.n),
+                                 input.getSize(dims.c),
+                                 outputH,
+                                 outputW);
+  if (output_.sizes() != outSizes) {
+    output_ = CLTensor<FloatType<kWidth>::T>(context, outSizes);
   }
 
-  runForwardPool2dNCHW(context, program, queue,
-                       input,
-                       poolType_,
-                       kernelHW_,
-                       padT_,
-                       padL_,
-                       strideHW_,
-                       getRoundMode(),
-                       inputScale_,
-                       outputScale_,
-                       output_);
+  auto runPool = layout_ == Layout::NHWC ?
+    runForwardPool2dNHWC : runForwardPool2dNCHW;
+
+  runPool(context, program, queue,
+          input,
+          poolType_,
+          geom_,
+          getRoundMode(),
+          inputScale_,
+          outputScale_,
+          output_);
+
+  if (!outputViewDims_.empty()) {
+    std::vector<size_t> newSizes;
+    for (auto& ds : outputViewDims_) {
+      size_t size = 1;
+      for (auto d : ds) {
+        size *= output_.getSize(d);
+      }
+
+      newSizes.push_back(size);
+    }
+
+    outputView_ = output_.view(newSizes);
+    return outputView_;
+  }
 
   return output_;
 }
@@ -7,11 +7,21 @@
 
 #include <memory>
 #include "layers/Layer.h"
+#include "ops/KernelGeometry.h"
 #include "ops/PoolOp.h"
 
 namespace facebook { namespace cl {
 
 struct Pool2d : public Layer {
+  Pool2d(Context& context,
+         Program& program,
+         Queue& queue,
+         const KernelGeometry& geom,
+         PoolOp poolType,
+         int inScale,
+         int outScale);
+
+  // A square window with symmetric padding
   Pool2d(Context& context,
          Program& program,
          Queue& queue,
@@ -30,6 +40,10 @@ struct Pool2d : public Layer {
 
   std::string str() const override;
 
+  // Reshapes our output as View would with `newDims`, so that a following
+  // View layer can be dropped
+  void setOutputView(const std::vector<std::vector<int>>& newDims);
+
   CLTensor<FloatType<kWidth>::T>& forward(
     Context& context,
     Program& program,
@@ -43,13 +57,13 @@ struct Pool2d : public Layer {
     const CLTensor<FloatType<kWidth>::T>& input,
     const CLTensor<FloatType<kWidth>::T>& gradOutput) override;
 
-  int kernelHW_;
-  int strideHW_;
-  int padT_;
-  int padL_;
+  KernelGeometry geom_;
   PoolOp poolType_;
   int inputScale_;
   int outputScale_;
+
+  std::vector<std::vector<int>> outputViewDims_;
+  CLTensor<FloatType<kWidth>::T> outputView_;
 };
 
 } } // namespace
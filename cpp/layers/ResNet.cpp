@@ -0,0 +1,283 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "layers/ResNet.h"
+
+#include <sstream>
+#include "ops/TensorConv.h"
+
+namespace facebook { namespace cl {
+
+constexpr int ResNet::kNumParts;
+
+ResNet::ResNet(Context& context,
+               Program& program,
+               Queue& queue,
+               ResNetBlockType blockType,
+               const std::vector<int>& layers,
+               int numClasses,
+               int firstPart,
+               int lastPart)
+    : Graph("ResNet"),
+      blockType_(blockType),
+      expansion_(blockType == ResNetBlockType::Basic ? 1 : 4),
+      inPlanes_(64),
+      firstPart_(firstPart),
+      lastPart_(lastPart),
+      conv1_(-1),
+      relu_(-1),
+      maxPool_(-1),
+      avgPool_(-1),
+      view_(-1),
+      fc_(-1) {
+  CL_ASSERT(layers.size() == 4);
+  CL_ASSERT(firstPart >= 0 && firstPart <= lastPart && lastPart < kNumParts);
+
+  if (hasPart(0)) {
+    conv1_ = add(Conv2d(context, program, queue,
+                        3, 64, 7, 2, 3, 3, false, 0, 0));
+    relu_ = add(ReLU(context, program, queue));
+    maxPool_ = add(Pool2d(context, program, queue,
+                          3, 2, 1, 1, PoolOp::Max, 0, 0));
+  }
+
+  const int planes[4] = {64, 128, 256, 512};
+  for (int i = 0; i < 4; ++i) {
+    makeStage(context, program, queue,
+              planes[i], layers[i], i == 0 ? 1 : 2, hasPart(i + 1));
+  }
+
+  if (hasPart(kNumParts - 1)) {
+    avgPool_ = add(Pool2d(context, program, queue,
+                          7, 1, 0, 0, PoolOp::Avg, 0, 0));
+    view_ = add(View(context, program, queue, {{0}, {1, 2, 3}}));
+    fc_ = add(Linear(context, program, queue,
+                     512 * expansion_, numClasses, true, 0, 0));
+  }
+}
+
+bool
+ResNet::hasPart(int part) const {
+  return part >= firstPart_ && part <= lastPart_;
+}
+
+CLTensor<FloatType<kWidth>::T>&
+ResNet::forward(Context& context,
+                Program& program,
+                Queue& queue,
+                const CLTensor<FloatType<kWidth>::T>& input) {
+  if (layout_ != Layout::NHWC || !hasPart(0)) {
+    return Graph::forward(context, program, queue, input);
+  }
+
+  CL_ASSERT(input.dims() == 4);
+
+  auto sizes = getLayoutSizes(Layout::NHWC,
+                              input.getSize(0), input.getSize(1),
+                              input.getSize(2), input.getSize(3));
+  if (inputNHWC_.sizes() != sizes) {
+    inputNHWC_ = CLTensor<FloatType<kWidth>::T>(context, sizes);
+  }
+
+  runNCHWToNHWC(context, program, queue, input, inputNHWC_);
+
+  return Graph::forward(context, program, queue, inputNHWC_);
+}
+
+std::string
+ResNet::str() const {
+  std::stringstream ss;
+  ss << "ResNet ("
+     << (blockType_ == ResNetBlockType::Basic ? "basic" : "bottleneck")
+     << " [";
+
+  for (int i = 0; i < stages_.size(); ++i) {
+    ss << stages_[i].size() << (i < stages_.size() - 1 ? ", " : "");
+  }
+
+  ss << "]";
+  if (firstPart_ != 0 || lastPart_ != kNumParts - 1) {
+    ss << " parts " << firstPart_ << "-" << lastPart_;
+  }
+
+  if (layout_ != Layout::NCHW) {
+    ss << " " << getLayoutName(layout_);
+  }
+
+  ss << ")";
+  return ss.str();
+}
+
+void
+ResNet::makeStage(Context& context,
+                  Program& program,
+                  Queue& queue,
+                  int planes,
+                  int blocks,
+                  int stride,
+                  bool build) {
+  std::vector<BlockNodes> stage;
+
+  if (!build) {
+    // Only track the shape, for the stages that follow
+    inPlanes_ = planes * expansion_;
+    stages_.emplace_back(std::move(stage));
+    return;
+  }
+
+  bool downsample = (stride != 1 || inPlanes_ != planes * expansion_);
+  stage.emplace_back(
+    makeBlock(context, program, queue, planes, stride, downsample));
+  inPlanes_ = planes * expansion_;
+
+  for (int i = 1; i < blocks; ++i) {
+    stage.emplace_back(
+      makeBlock(context, program, queue, planes, 1, false));
+  }
+
+  stages_.emplace_back(std::move(stage));
+}
+
+ResNet::BlockNodes
+ResNet::makeBlock(Context& context,
+                  Program& program,
+                  Queue& queue,
+                  int planes,
+                  int stride,
+                  bool downsample) {
+  BlockNodes block;
+  int blockIn = (int) numNodes() - 1;
+
+  if (blockType_ == ResNetBlockType::Basic) {
+    block.convs.push_back(add(Conv2d(context, program, queue,
+                                     inPlanes_, planes, 3, stride, 1, 1,
+                                     false, 0, 0)));
+    block.relus.push_back(add(ReLU(context, program, queue)));
+    block.convs.push_back(add(Conv2d(context, program, queue,
+                                     planes, planes, 3, 1, 1, 1,
+                                     false, 0, 0)));
+  } else {
+    block.convs.push_back(add(Conv2d(context, program, queue,
+                                     inPlanes_, planes, 1, 1, 0, 0,
+                                     false, 0, 0)));
+    block.relus.push_back(add(ReLU(context, program, queue)));
+    block.convs.push_back(add(Conv2d(context, program, queue,
+                                     planes, planes, 3, stride, 1, 1,
+                                     false, 0, 0)));
+    block.relus.push_back(add(ReLU(context, program, queue)));
+    block.convs.push_back(add(Conv2d(context, program, queue,
+                                     planes, planes * expansion_, 1, 1, 0, 0,
+                                     false, 0, 0)));
+  }
+
+  int out = block.convs.back();
+  int residual = blockIn;
+
+  block.downsample = kNoResidual;
+  if (downsample) {
+    block.downsample = add(Conv2d(context, program, queue,
+                                  inPlanes_, planes * expansion_,
+                                  1, stride, 0, 0,
+                                  false, 0, 0),
+                           blockIn);
+    residual = block.downsample;
+  }
+
+  block.add = addResidual(Add(context, program, queue, 0, 0, 0),
+                          out, residual);
+  block.relus.push_back(add(ReLU(context, program, queue)));
+
+  return block;
+}
+
+Conv2d&
+ResNet::getConv1() {
+  CL_ASSERT(conv1_ != -1);
+  return static_cast<Conv2d&>(getNode(conv1_));
+}
+
+ReLU&
+ResNet::getReLU() {
+  CL_ASSERT(relu_ != -1);
+  return static_cast<ReLU&>(getNode(relu_));
+}
+
+Pool2d&
+ResNet::getMaxPool() {
+  CL_ASSERT(maxPool_ != -1);
+  return static_cast<Pool2d&>(getNode(maxPool_));
+}
+
+Pool2d&
+ResNet::getAvgPool() {
+  CL_ASSERT(avgPool_ != -1);
+  return static_cast<Pool2d&>(getNode(avgPool_));
+}
+
+View&
+ResNet::getView() {
+  CL_ASSERT(view_ != -1);
+  return static_cast<View&>(getNode(view_));
+}
+
+Linear&
+ResNet::getFc() {
+  CL_ASSERT(fc_ != -1);
+  return static_cast<Linear&>(getNode(fc_));
+}
+
+int
+ResNet::numStages() const {
+  return stages_.size();
+}
+
+int
+ResNet::numBlocks(int stage) const {
+  CL_ASSERT(stage >= 0 && stage < stages_.size());
+  return stages_[stage].size();
+}
+
+const ResNet::BlockNodes&
+ResNet::getBlock(int stage, int block) const {
+  CL_ASSERT(stage >= 0 && stage < stages_.size());
+  CL_ASSERT(block >= 0 && block < stages_[stage].size());
+
+  return stages_[stage][block];
+}
+
+Conv2d&
+ResNet::getBlockConv(int stage, int block, int conv) {
+  auto& b = getBlock(stage, block);
+  CL_ASSERT(conv >= 1 && conv <= b.convs.size());
+
+  return static_cast<Conv2d&>(getNode(b.convs[conv - 1]));
+}
+
+ReLU&
+ResNet::getBlockReLU(int stage, int block, int relu) {
+  auto& b = getBlock(stage, block);
+  CL_ASSERT(relu >= 1 && relu <= b.relus.size());
+
+  return static_cast<ReLU&>(getNode(b.relus[relu - 1]));
+}
+
+bool
+ResNet::hasBlockDownsample(int stage, int block) const {
+  return getBlock(stage, block).downsample != kNoResidual;
+}
+
+Conv2d&
+ResNet::getBlockDownsample(int stage, int block) {
+  CL_ASSERT(hasBlockDownsample(stage, block));
+
+  return static_cast<Conv2d&>(getNode(getBlock(stage, block).downsample));
+}
+
+Add&
+ResNet::getBlockAdd(int stage, int block) {
+  return static_cast<Add&>(getNode(getBlock(stage, block).add));
+}
+
+} }
@@ -0,0 +1,117 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <vector>
+#include "layers/Add.h"
+#include "layers/Conv2d.h"
+#include "layers/Graph.h"
+#include "layers/Linear.h"
+#include "layers/Pool2d.h"
+#include "layers/ReLU.h"
+#include "layers/View.h"
+
+namespace facebook { namespace cl {
+
+enum class ResNetBlockType { Basic, Bottleneck };
+
+// torchvision-style ResNet (batch norm is expected to have been folded into
+// the convolutions) built as a single layer graph, so that a whole batch is
+// evaluated by one forward call.
+//
+// The network is made of kNumParts parts: the stem (conv1 / relu / maxpool),
+// the four stages and the head (avgpool / view / fc). Only parts
+// [firstPart, lastPart] are built, so that a network can be split into
+// pipeline stages whose weights live on different devices.
+//
+// With the NHWC layout (setLayout), the input image is still given as NCHW
+// and converted on entry; activations passed between parts, and the output of
+// a network without the head, are NHWC.
+struct ResNet : public Graph {
+  static constexpr int kNumParts = 6;
+
+  ResNet(Context& context,
+         Program& program,
+         Queue& queue,
+         ResNetBlockType blockType,
+         const std::vector<int>& layers,
+         int numClasses = 1000,
+         int firstPart = 0,
+         int lastPart = kNumParts - 1);
+
+  std::string str() const override;
+
+  bool hasPart(int part) const;
+
+  CLTensor<FloatType<kWidth>::T>& forward(
+    Context& context,
+    Program& program,
+    Queue& queue,
+    const CLTensor<FloatType<kWidth>::T>& in) override;
+
+  // Only valid if the stem / head are built
+  Conv2d& getConv1();
+  ReLU& getReLU();
+  Pool2d& getMaxPool();
+  Pool2d& getAvgPool();
+  View& getView();
+  Linear& getFc();
+
+  // Stages are torchvision's layer1 ... layer4; a stage that was not built
+  // has no blocks
+  int numStages() const;
+  int numBlocks(int stage) const;
+
+  // `conv` and `relu` are 1-based, following the torchvision names
+  Conv2d& getBlockConv(int stage, int block, int conv);
+  ReLU& getBlockReLU(int stage, int block, int relu);
+  bool hasBlockDownsample(int stage, int block) const;
+  Conv2d& getBlockDownsample(int stage, int block);
+  Add& getBlockAdd(int stage, int block);
+
+  struct BlockNodes {
+    std::vector<int> convs;
+    std::vector<int> relus;
+    int downsample;
+    int add;
+  };
+
+  void makeStage(Context& context,
+                 Program& program,
+                 Queue& queue,
+                 int planes,
+                 int blocks,
+                 int stride,
+                 bool build);
+
+  BlockNodes makeBlock(Context& context,
+                       Program& program,
+                       Queue& queue,
+                       int planes,
+                       int stride,
+                       bool downsample);
+
+  const BlockNodes& getBlock(int stage, int block) const;
+
+  ResNetBlockType blockType_;
+  int expansion_;
+  int inPlanes_;
+  int firstPart_;
+  int lastPart_;
+
+  int conv1_;
+  int relu_;
+  int maxPool_;
+  int avgPool_;
+  int view_;
+  int fc_;
+  std::vector<std::vector<BlockNodes>> stages_;
+
+  // The NCHW input converted to NHWC
+  CLTensor<FloatType<kWidth>::T> inputNHWC_;
+};
+
+} } // namespace
@@ -5,15 +5,14 @@
 // LICENSE file in the root directory of this source tree.
 #include "layers/Sequential.h"
 
-#include "ops/TensorPrint.h"
-#include <iostream>
+#include "ops/TensorInspect.h"
+#include "utils/Profiler.h"
 #include <sstream>
 
 namespace facebook { namespace cl {
 
 Sequential::Sequential(const std::string& name)
-    : name_(name),
-      log_(false) {
+    : name_(name) {
 }
 
 std::string
@@ -36,11 +35,6 @@ Sequential::str() const {
   return ss.str();
 }
 
-void
-Sequential::log(bool b) {
-  log_ = b;
-}
-
 size_t
 Sequential::numLayers() const {
   return layers_.size();
@@ -51,6 +45,12 @@ Sequential::getLayer(int i) {
   return *layers_[i];
 }
 
+std::string
+Sequential::getLayerName(int i) const {
+  return (name_.empty() ? std::string("Sequential") : name_) + " / " +
+    std::to_string(i) + ": " + layers_[i]->str();
+}
+
 void
 Sequential::setRoundMode(RoundOp mode) {
   Layer::setRoundMode(mode);
@@ -66,6 +66,15 @@ Sequential::getRoundMode() const {
   return Layer::getRoundMode();
 }
 
+void
+Sequential::setLayout(Layout layout) {
+  Layer::setLayout(layout);
+
+  for (auto& l : layers_) {
+    l->setLayout(layout);
+  }
+}
+
 CLTensor<FloatType<kWidth>::T>&
 Sequential::forward(Context& context,
                     Program& program,
@@ -75,13 +84,21 @@ Sequential::forward(Context& context,
 
   CLTensor<FloatType<kWidth>::T>* prevOut = nullptr;
 
+  ProfileScope seqScope([this]() {
+      return name_.empty() ? std::string("Sequential") : name_;
+    });
+
   for (int i = 0; i < layers_.size(); ++i) {
     auto& layer = layers_[i];
+
+    ProfileScope scope([&layer, i]() {
+        return std::to_string(i) + ": " + layer->str();
+      });
+
+    auto layerName = [this, i]() { return getLayerName(i); };
+
     if (!prevOut) {
-      if (log_) {
-        std::cout << "Layer " << (i + 1) << " input:" << std::endl;
-        printPositTensor(context, program, queue, input);
-      }
+      inspectTensor(context, program, queue, layerName, "input", input);
 
       prevOut = &(layer->forward(context, program, queue, input));
 
@@ -89,10 +106,7 @@ Sequential::forward(Context& context,
       prevOut = &(layer->forward(context, program, queue, *prevOut));
     }
 
-    if (log_) {
-      std::cout << "Layer " << (i + 1) << " output: " << layer->str() << std::endl;
-      printPositTensor(context, program, queue, *prevOut);
-    }
+    inspectTensor(context, program, queue, layerName, "output", *prevOut);
   }
 
   if (prevOut) {
@@ -115,11 +129,11 @@ Sequential::updateGradInput(Context& context,
   for (int i = layers_.size() - 1; i >= 0; --i) {
     auto& layer = layers_[i];
 
+    auto layerName = [this, i]() { return getLayerName(i); };
+
     if (!prevGradInput) {
-      if (log_) {
-        std::cout << "Layer " << (i + 1) << " gradOutput:" << std::endl;
-        printPositTensor(context, program, queue, gradOutput);
-      }
+      inspectTensor(context, program, queue, layerName,
+                    "gradOutput", gradOutput);
 
       prevGradInput =
         &(layer->updateGradInput(context, program, queue,
@@ -133,10 +147,8 @@ Sequential::updateGradInput(Context& context,
                                  layer->input_, *prevGradInput));
     }
 
-    if (log_) {
-      std::cout << "Layer " << (i + 1) << " gradInput: " << layer->str() << std::endl;
-      printPositTensor(context, program, queue, *prevGradInput);
-    }
+    inspectTensor(context, program, queue, layerName,
+                  "gradInput", *prevGradInput);
   }
 
   if (prevGradInput) {
@@ -165,13 +177,12 @@ Sequential::accGradParameters(Context& context,
                             scale,
                             curInput, curGradOutput);
 
-    auto params = layer.getParameters();
-    if (!params.empty()) {
-      if (log_) {
-        for (auto& p : params) {
-          std::cout << "Layer " << (i + 1) << " " << layer.str()
-                    << " grad param:" << std::endl;
-          printPositTensor(context, program, queue, *p.gradParam);
+    if (Inspector::isEnabled()) {
+      for (auto& p : layer.getParameters()) {
+        if (p.gradParam) {
+          Inspector::get().inspect(context, program, queue,
+                                   getLayerName(i), "grad " + p.name,
+                                   *p.gradParam);
         }
       }
     }
@@ -19,16 +19,19 @@ struct Sequential : public Layer {
   // Sequential(Sequential&) = delete;
   // Sequential& operator=(Sequential&) = delete;
 
-  void log(bool b);
-
   std::string str() const;
 
   size_t numLayers() const;
   Layer& getLayer(int i);
 
+  // Name of layer i for profiling and inspection
+  std::string getLayerName(int i) const;
+
   void setRoundMode(RoundOp mode) override;
   RoundOp getRoundMode() const override;
 
+  void setLayout(Layout layout) override;
+
   CLTensor<FloatType<kWidth>::T>& forward(
     Context& context,
     Program& program,
@@ -62,7 +65,6 @@ struct Sequential : public Layer {
   }
 
   std::string name_;
-  bool log_;
   std::vector<std::unique_ptr<Layer>> layers_;
 };
 
@@ -0,0 +1,66 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "ops/HostCodec.h"
+
+#include "ops/TensorMath.h"
+#include "utils/CLTensor.h"
+#include "utils/HostTensor.h"
+#include "utils/Program.h"
+
+namespace facebook { namespace cl {
+
+namespace {
+
+ConvertPath convertPath = ConvertPath::Device;
+
+}
+
+HostDecoder::HostDecoder(Context& context, Program& program, Queue& queue) {
+  size_t num = (size_t) 1 << kWidth;
+
+  HostTensor<FloatType<kWidth>::T, 1> codes({num});
+  for (size_t i = 0; i < num; ++i) {
+    codes[i] = (FloatType<kWidth>::T) i;
+  }
+
+  CLTensor<FloatType<kWidth>::T> codesDev(context, queue, codes);
+  CLTensor<float> valuesDev(context, {num});
+
+  runToFloat(context, program, queue, codesDev, valuesDev);
+  auto values = valuesDev.toHost<1>(queue);
+
+  table_.assign(values.data(), values.data() + num);
+}
+
+void
+HostDecoder::decode(const FloatType<kWidth>::T* in,
+                    float* out,
+                    size_t n) const {
+  const float* table = table_.data();
+
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = table[in[i] & kMask];
+  }
+}
+
+const HostDecoder&
+getHostDecoder(Context& context, Program& program, Queue& queue) {
+  return program.getCached<HostDecoder>("HostDecoder", [&]() {
+      return new HostDecoder(context, program, queue);
+    });
+}
+
+ConvertPath
+getConvertPath() {
+  return convertPath;
+}
+
+void
+setConvertPath(ConvertPath path) {
+  convertPath = path;
+}
+
+} }
@@ -0,0 +1,60 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+#include "FloatDefs.h"
+
+namespace facebook { namespace cl {
+
+class Context;
+class Program;
+class Queue;
+
+// How device values are converted to host floats
+enum class ConvertPath {
+  // runToFloat on the device, then download 4 bytes per element
+  Device,
+
+  // Download the encoded values, then decode with a host table
+  HostTable,
+};
+
+// Decodes FloatType<kWidth>::T to float on the host. Values are at most
+// 11 bits wide, so the decoder is a table of every encoding, filled in by the
+// program's own positToFloat8_1 kernel; host and device results are thus
+// bit-identical for both posit and log bitstreams.
+class HostDecoder {
+ public:
+  HostDecoder(Context& context, Program& program, Queue& queue);
+
+  inline float decode(FloatType<kWidth>::T v) const {
+    return table_[v & kMask];
+  }
+
+  void decode(const FloatType<kWidth>::T* in, float* out, size_t n) const;
+
+  // The value of every encoding, indexed by encoding
+  inline const std::vector<float>& getTable() const {
+    return table_;
+  }
+
+ private:
+  static constexpr unsigned int kMask = (1U << kWidth) - 1;
+
+  std::vector<float> table_;
+};
+
+// Returns the decoder for `program`, building it on first use
+const HostDecoder&
+getHostDecoder(Context& context, Program& program, Queue& queue);
+
+// The path used by fromDevicePosit and the torch bridges; Device by default
+ConvertPath getConvertPath();
+void setConvertPath(ConvertPath path);
+
+} } // namespace
@@ -0,0 +1,354 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "ops/HostRound.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "ops/HostCodec.h"
+#include "utils/OpenCLUtils.h"
+#include "utils/Program.h"
+
+namespace facebook { namespace cl {
+
+namespace {
+
+// Elements per thread below which we don't bother splitting
+constexpr size_t kMinElementsPerThread = 65536;
+
+inline uint32_t
+mulHiLo(uint32_t a, uint32_t b, uint32_t* hi) {
+  uint64_t p = (uint64_t) a * (uint64_t) b;
+  *hi = (uint32_t) (p >> 32);
+
+  return (uint32_t) p;
+}
+
+// Square matrices over GF(2) of up to 64 bits, one row per word; bit j of
+// row i is element (i, j)
+using BitMatrix = std::vector<uint64_t>;
+
+BitMatrix
+bitMatrixMul(const BitMatrix& a, const BitMatrix& b) {
+  BitMatrix c(a.size(), 0);
+
+  for (size_t i = 0; i < a.size(); ++i) {
+    for (size_t j = 0; j < b.size(); ++j) {
+      if ((a[i] >> j) & 1) {
+        c[i] ^= b[j];
+      }
+    }
+  }
+
+  return c;
+}
+
+uint64_t
+bitMatrixApply(const BitMatrix& m, uint64_t v) {
+  uint64_t out = 0;
+
+  for (size_t i = 0; i < m.size(); ++i) {
+    out |= (uint64_t) __builtin_parityll(m[i] & v) << i;
+  }
+
+  return out;
+}
+
+}
+
+void
+philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+  constexpr uint32_t kM0 = 0xD2511F53;
+  constexpr uint32_t kM1 = 0xCD9E8D57;
+  constexpr uint32_t kW0 = 0x9E3779B9;
+  constexpr uint32_t kW1 = 0xBB67AE85;
+
+  uint32_t c[4] = {ctr[0], ctr[1], ctr[2], ctr[3]};
+  uint32_t k[2] = {key[0], key[1]};
+
+  for (int round = 0; round < 10; ++round) {
+    uint32_t hi0;
+    uint32_t hi1;
+    uint32_t lo0 = mulHiLo(kM0, c[0], &hi0);
+    uint32_t lo1 = mulHiLo(kM1, c[2], &hi1);
+
+    c[0] = hi1 ^ c[1] ^ k[0];
+    c[1] = lo1;
+    c[2] = hi0 ^ c[3] ^ k[1];
+    c[3] = lo0;
+
+    k[0] += kW0;
+    k[1] += kW1;
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    out[i] = c[i];
+  }
+}
+
+LFSR::LFSR(int bits, uint64_t init) {
+  // We only support the state sizes of LFSR.sv
+  CL_ASSERT(bits > 0 && bits <= 33);
+
+  if (bits <= 9) {
+    stateBits_ = 9;
+    tap_ = 4;
+  } else if (bits <= 17) {
+    stateBits_ = 17;
+    tap_ = 13;
+  } else {
+    stateBits_ = 33;
+    tap_ = 19;
+  }
+
+  stateMask_ = ((uint64_t) 1 << stateBits_) - 1;
+  outMask_ = ((uint64_t) 1 << bits) - 1;
+
+  // The init value is zero padded on the right
+  state_ = ((init & outMask_) << (stateBits_ - bits)) & stateMask_;
+}
+
+void
+LFSR::advance(uint64_t steps) {
+  steps %= period();
+
+  // Short jumps are cheaper one clock at a time
+  if (steps <= (uint64_t) stateBits_ * stateBits_) {
+    for (uint64_t i = 0; i < steps; ++i) {
+      step();
+    }
+
+    return;
+  }
+
+  // A clock is affine over GF(2) (the feedback is an XNOR), so it is a
+  // linear map of the state extended with a constant 1 bit above it, and
+  // `steps` clocks are that map raised to the power `steps`
+  int n = stateBits_;
+  uint64_t one = (uint64_t) 1 << n;
+
+  BitMatrix clock(n + 1, 0);
+  clock[0] = ((uint64_t) 1 << (n - 1)) | ((uint64_t) 1 << tap_) | one;
+  for (int i = 1; i < n; ++i) {
+    clock[i] = (uint64_t) 1 << (i - 1);
+  }
+  clock[n] = one;
+
+  BitMatrix jump(n + 1, 0);
+  for (int i = 0; i <= n; ++i) {
+    jump[i] = (uint64_t) 1 << i;
+  }
+
+  for (; steps; steps >>= 1) {
+    if (steps & 1) {
+      jump = bitMatrixMul(clock, jump);
+    }
+
+    clock = bitMatrixMul(clock, clock);
+  }
+
+  state_ = bitMatrixApply(jump, state_ | one) & stateMask_;
+}
+
+uint64_t
+LFSR::period() const {
+  // The taps give maximal length sequences
+  return stateMask_;
+}
+
+HostRounder::HostRounder(const HostDecoder& decoder, int randomBits)
+    : randomBits_(randomBits),
+      infCode_(FloatType<kWidth>::kInf) {
+  // Probabilities are computed in double
+  CL_ASSERT(randomBits_ >= 2 && randomBits_ <= 32);
+
+  auto& table = decoder.getTable();
+
+  std::vector<std::pair<float, FloatType<kWidth>::T>> finite;
+  for (size_t i = 0; i < table.size(); ++i) {
+    if (std::isfinite(table[i])) {
+      finite.emplace_back(table[i], (FloatType<kWidth>::T) i);
+    } else {
+      infCode_ = (FloatType<kWidth>::T) i;
+    }
+  }
+
+  CL_ASSERT(finite.size() >= 2);
+  std::sort(finite.begin(), finite.end());
+
+  // Values with more than one encoding (e.g., signed zero) keep the lowest
+  for (auto& p : finite) {
+    if (!values_.empty() && values_.back() == p.first) {
+      continue;
+    }
+
+    values_.push_back(p.first);
+    codes_.push_back(p.second);
+  }
+}
+
+int
+HostRounder::getRandomBits() const {
+  return randomBits_;
+}
+
+size_t
+HostRounder::lowerIndex(float v) const {
+  auto it = std::upper_bound(values_.begin(), values_.end(), v);
+
+  return (size_t) (it - values_.begin()) - 1;
+}
+
+FloatType<kWidth>::T
+HostRounder::roundNearest(float v) const {
+  if (!std::isfinite(v)) {
+    return infCode_;
+  } else if (v >= values_.back()) {
+    return codes_.back();
+  } else if (v <= values_.front()) {
+    return codes_.front();
+  }
+
+  size_t k = lowerIndex(v);
+  if (values_[k] == v) {
+    return codes_[k];
+  }
+
+  double below = (double) v - (double) values_[k];
+  double above = (double) values_[k + 1] - (double) v;
+
+  if (below < above) {
+    return codes_[k];
+  } else if (above < below) {
+    return codes_[k + 1];
+  }
+
+  return (codes_[k] & 1) ? codes_[k + 1] : codes_[k];
+}
+
+FloatType<kWidth>::T
+HostRounder::roundStochastic(float v, uint32_t random) const {
+  if (!std::isfinite(v)) {
+    return infCode_;
+  } else if (v >= values_.back()) {
+    return codes_.back();
+  } else if (v <= values_.front()) {
+    return codes_.front();
+  }
+
+  size_t k = lowerIndex(v);
+  if (values_[k] == v) {
+    return codes_[k];
+  }
+
+  double lo = values_[k];
+  double hi = values_[k + 1];
+
+  // Rounding is of the magnitude; zero is always in the table, so lo and
+  // hi have the same sign
+  size_t towardZero = v > 0 ? k : k + 1;
+  size_t awayFromZero = v > 0 ? k + 1 : k;
+  double frac = v > 0 ? ((double) v - lo) / (hi - lo) :
+    (hi - (double) v) / (hi - lo);
+
+  // The trailing bits and the sticky bit of the fraction, which is added to
+  // the random bits; a carry rounds up
+  double scaled = std::ldexp(frac, randomBits_ - 1);
+  uint64_t trailing = (uint64_t) std::floor(scaled);
+  uint64_t sticky = (double) trailing < scaled ? 1 : 0;
+
+  uint64_t mask = ((uint64_t) 1 << randomBits_) - 1;
+  uint64_t check = ((trailing << 1) | sticky) + ((uint64_t) random & mask);
+
+  return (check > mask) ? codes_[awayFromZero] : codes_[towardZero];
+}
+
+void
+HostRounder::roundRange(const float* in,
+                        FloatType<kWidth>::T* out,
+                        size_t begin,
+                        size_t end,
+                        uint64_t seed,
+                        RandomMode mode) const {
+  if (mode == RandomMode::LFSR) {
+    // advance() jumps ahead in O(log) time, so each worker finds its own
+    // starting state cheaply
+    LFSR lfsr(randomBits_);
+    lfsr.advance(seed % lfsr.period() + begin % lfsr.period());
+
+    for (size_t i = begin; i < end; ++i) {
+      out[i] = roundStochastic(in[i], lfsr.out());
+      lfsr.step();
+    }
+
+    return;
+  }
+
+  uint32_t key[2] = {(uint32_t) seed, (uint32_t) (seed >> 32)};
+  uint32_t random[4];
+
+  // Each Philox call gives the random values for 4 consecutive elements
+  for (size_t i = begin; i < end; ++i) {
+    if (i == begin || (i & 3) == 0) {
+      uint64_t c = (uint64_t) i >> 2;
+      uint32_t ctr[4] = {(uint32_t) c, (uint32_t) (c >> 32), 0, 0};
+
+      philox4x32(ctr, key, random);
+    }
+
+    out[i] = roundStochastic(in[i], random[i & 3]);
+  }
+}
+
+void
+HostRounder::roundStochastic(const float* in,
+                             FloatType<kWidth>::T* out,
+                             size_t n,
+                             uint64_t seed,
+                             RandomMode mode,
+                             int numThreads) const {
+  size_t threads = numThreads > 0 ?
+    (size_t) numThreads : (size_t) std::thread::hardware_concurrency();
+  threads = std::max(std::min(threads,
+                              (n + kMinElementsPerThread - 1) /
+                              kMinElementsPerThread),
+                     (size_t) 1);
+
+  if (threads == 1) {
+    roundRange(in, out, 0, n, seed, mode);
+    return;
+  }
+
+  // Every element draws from its own position in the stream, so the split
+  // doesn't affect the result
+  size_t perThread = (n + threads - 1) / threads;
+
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+    size_t begin = t * perThread;
+    size_t end = std::min(begin + perThread, n);
+    if (begin >= end) {
+      break;
+    }
+
+    workers.emplace_back([this, in, out, begin, end, seed, mode]() {
+        roundRange(in, out, begin, end, seed, mode);
+      });
+  }
+
+  for (auto& w : workers) {
+    w.join();
+  }
+}
+
+const HostRounder&
+getHostRounder(Context& context, Program& program, Queue& queue) {
+  return program.getCached<HostRounder>("HostRounder", [&]() {
+      return new HostRounder(getHostDecoder(context, program, queue));
+    });
+}
+
+} }
@@ -0,0 +1,124 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "FloatDefs.h"
+
+/// Host (CPU) rounding of float to FloatType<kWidth>::T, including
+/// stochastic rounding that is reproducible for a given seed regardless of
+/// the number of threads used
+
+namespace facebook { namespace cl {
+
+class Context;
+class Program;
+class Queue;
+class HostDecoder;
+
+// Source of the random bits for host stochastic rounding
+enum class RandomMode {
+  // Counter-based Philox4x32-10, keyed by the seed; the counter is the
+  // element index
+  Philox,
+
+  // The sequence of rtl/utils/LFSR.sv as reset by PositRound.sv (init 1);
+  // element i sees the state seed + i steps after reset
+  LFSR,
+};
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+// 3", SC'11)
+void philox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]);
+
+// Host model of rtl/utils/LFSR.sv with N output bits
+class LFSR {
+ public:
+  LFSR(int bits, uint64_t init = 1);
+
+  // Advances by one clock
+  inline void step() {
+    uint64_t fb =
+      ~((state_ >> (stateBits_ - 1)) ^ (state_ >> tap_)) & 1;
+    state_ = ((state_ << 1) | fb) & stateMask_;
+  }
+
+  // Advances by `steps` clocks, in time logarithmic in `steps`
+  void advance(uint64_t steps);
+
+  inline uint32_t out() const {
+    return (uint32_t) (state_ & outMask_);
+  }
+
+  // Number of states visited before repeating
+  uint64_t period() const;
+
+ private:
+  int stateBits_;
+  int tap_;
+  uint64_t stateMask_;
+  uint64_t outMask_;
+  uint64_t state_;
+};
+
+// Rounds float to our encoding on the host, using the decode table of the
+// program (see HostDecoder) so that the set of values is exactly that of the
+// device. Values beyond the largest finite value saturate to it; NaN and inf
+// map to our inf.
+class HostRounder {
+ public:
+  // Stochastic rounding uses `randomBits` bits per value, as
+  // PositRoundStochastic.sv, which takes TRAILING_BITS + 1 (9) bits
+  explicit HostRounder(const HostDecoder& decoder, int randomBits = 9);
+
+  int getRandomBits() const;
+
+  // Round to nearest, ties to an even encoding
+  FloatType<kWidth>::T roundNearest(float v) const;
+
+  // Rounds away from zero with probability (|v| - |lo|) / (|hi| - |lo|) for
+  // the adjacent values lo and hi about v, quantized to `randomBits` bits
+  // (the lowest being a sticky bit) as PositRoundStochastic.sv; `random` is
+  // uniform in its low `randomBits` bits
+  FloatType<kWidth>::T roundStochastic(float v, uint32_t random) const;
+
+  // Rounds n values, with element i using random value i of the stream
+  // given by `seed`. Work is split over `numThreads` threads (0 for the
+  // number of cores), which does not change the result.
+  void roundStochastic(const float* in,
+                       FloatType<kWidth>::T* out,
+                       size_t n,
+                       uint64_t seed,
+                       RandomMode mode = RandomMode::Philox,
+                       int numThreads = 0) const;
+
+ private:
+  // Index of the largest value <= v; v must be within the finite range
+  size_t lowerIndex(float v) const;
+
+  void roundRange(const float* in,
+                  FloatType<kWidth>::T* out,
+                  size_t begin,
+                  size_t end,
+                  uint64_t seed,
+                  RandomMode mode) const;
+
+  int randomBits_;
+
+  // Finite values in increasing order and their encodings
+  std::vector<float> values_;
+  std::vector<FloatType<kWidth>::T> codes_;
+
+  FloatType<kWidth>::T infCode_;
+};
+
+// Returns the rounder for `program`, building it on first use
+const HostRounder&
+getHostRounder(Context& context, Program& program, Queue& queue);
+
+} } // namespace
@@ -0,0 +1,96 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <stddef.h>
+#include <sstream>
+#include <string>
+
+namespace facebook { namespace cl {
+
+template <typename T, typename U>
+constexpr T calcKernelOutputSize(T inSize, U padBefore, U padAfter,
+                                 U kernel, U stride) {
+  return ((inSize + (T) padBefore +
+           (T) padAfter - (T) kernel) / (T) stride) + (T) 1;
+}
+
+// Window of a 2-d convolution or pooling: kernel size, stride and padding
+// before / after in each dimension, and dilation (the distance between
+// adjacent kernel taps, 1 for a dense window)
+struct KernelGeometry {
+  int kH;
+  int kW;
+  int strideH;
+  int strideW;
+  int padT;
+  int padB;
+  int padL;
+  int padR;
+  int dilationH;
+  int dilationW;
+
+  // A square kernel, padded symmetrically in each dimension
+  static KernelGeometry square(int kHW, int strideHW, int padT, int padL) {
+    return KernelGeometry{kHW, kHW, strideHW, strideHW,
+        padT, padT, padL, padL, 1, 1};
+  }
+
+  // Span of the kernel over the input, including the dilation gaps
+  inline int extentH() const {
+    return dilationH * (kH - 1) + 1;
+  }
+
+  inline int extentW() const {
+    return dilationW * (kW - 1) + 1;
+  }
+
+  inline size_t outputH(size_t inputH) const {
+    return calcKernelOutputSize(inputH, padT, padB, extentH(), strideH);
+  }
+
+  inline size_t outputW(size_t inputW) const {
+    return calcKernelOutputSize(inputW, padL, padR, extentW(), strideW);
+  }
+
+  // Whether we are square(k, stride, padT, padL) for some values
+  inline bool isSquare() const {
+    return kH == kW && strideH == strideW &&
+      padT == padB && padL == padR &&
+      dilationH == 1 && dilationW == 1;
+  }
+
+  inline bool isValid() const {
+    return kH > 0 && kW > 0 && strideH > 0 && strideW > 0 &&
+      padT >= 0 && padB >= 0 && padL >= 0 && padR >= 0 &&
+      dilationH > 0 && dilationW > 0;
+  }
+
+  // In the form used by layer names, e.g., "ker (3, 3) st (1, 1) pad (1, 1)";
+  // padding is (top, left) if symmetric, else (top, bottom, left, right)
+  std::string str() const {
+    std::stringstream ss;
+    ss << "ker (" << kH << ", " << kW
+       << ") st (" << strideH << ", " << strideW
+       << ") pad (" << padT << ", ";
+
+    if (padT == padB && padL == padR) {
+      ss << padL;
+    } else {
+      ss << padB << ", " << padL << ", " << padR;
+    }
+
+    ss << ")";
+
+    if (dilationH != 1 || dilationW != 1) {
+      ss << " dil (" << dilationH << ", " << dilationW << ")";
+    }
+
+    return ss.str();
+  }
+};
+
+} }
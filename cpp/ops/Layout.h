@@ -0,0 +1,43 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+namespace facebook { namespace cl {
+
+// Memory layout of 4-d activations. Tensor sizes are always in memory order,
+// so an NHWC tensor has sizes (batch, height, width, channels).
+enum class Layout { NCHW, NHWC };
+
+// Position of each logical dimension within the sizes of a tensor
+struct LayoutDims {
+  int n;
+  int c;
+  int h;
+  int w;
+};
+
+inline LayoutDims
+getLayoutDims(Layout layout) {
+  return layout == Layout::NCHW ?
+    LayoutDims{0, 1, 2, 3} : LayoutDims{0, 3, 1, 2};
+}
+
+// Sizes of a (n, c, h, w) activation in `layout`
+inline std::vector<size_t>
+getLayoutSizes(Layout layout, size_t n, size_t c, size_t h, size_t w) {
+  return layout == Layout::NCHW ?
+    std::vector<size_t>{n, c, h, w} : std::vector<size_t>{n, h, w, c};
+}
+
+inline const char*
+getLayoutName(Layout layout) {
+  return layout == Layout::NCHW ? "NCHW" : "NHWC";
+}
+
+} }
@@ -10,31 +10,39 @@
 
 namespace facebook { namespace cl {
 
+namespace {
+
+// Largest output row width that the specialized max pool kernels run as a
+// single work group
+constexpr size_t kMaxPoolGroupWidth = 256;
+
+// Channels handled by a work group of the channels-last kernels, if the
+// channel count allows
+constexpr size_t kChannelGroupSize = 32;
+
+}
+
 Event
 runIm2ColNCHW(Context& context,
               Program& program,
               Queue& queue,
               const CLTensor<FloatType<kWidth>::T>& in,
-              unsigned int kHW,
-              unsigned int padT,
-              unsigned int padL,
-              unsigned int strideHW,
+              const KernelGeometry& geom,
               CLTensor<FloatType<kWidth>::T>& out) {
   auto ker = program.getKernel("im2col_8");
 
   CL_ASSERT(in.dims() == 4);
   CL_ASSERT(out.dims() == 3);
+  CL_ASSERT(geom.isValid());
 
   // in = (batch) x (cin) x (h) x (w)
   // ker = (cout) x (cin x kh x kw)
   // out = (batch) x (cin x kh x kw) x (outputH x outputW)
-  size_t outputH =
-    calcKernelOutputSize(in.getSize(2), padT, padT, kHW, strideHW);
-  size_t outputW =
-    calcKernelOutputSize(in.getSize(3), padL, padL, kHW, strideHW);
+  size_t outputH = geom.outputH(in.getSize(2));
+  size_t outputW = geom.outputW(in.getSize(3));
 
   CL_ASSERT(out.getSize(0) == in.getSize(0));
-  CL_ASSERT(out.getSize(1) == in.getSize(1) * kHW * kHW);
+  CL_ASSERT(out.getSize(1) == in.getSize(1) * geom.kH * geom.kW);
   CL_ASSERT(out.getSize(2) == outputH * outputW);
 
   return ker.callTask(queue,
@@ -45,10 +53,59 @@ runIm2ColNCHW(Context& context,
                       (unsigned int) in.getSize(3), // inputW
                       (unsigned int) outputH,
                       (unsigned int) outputW,
-                      kHW,
-                      strideHW,
-                      padT,
-                      padL,
+                      geom.kH,
+                      geom.kW,
+                      geom.strideH,
+                      geom.strideW,
+                      geom.padT,
+                      geom.padL,
+                      geom.dilationH,
+                      geom.dilationW,
+                      out);
+}
+
+Event
+runCol2ImNCHW(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              const KernelGeometry& geom,
+              RoundOp rounding,
+              char outScale,
+              CLTensor<FloatType<kWidth>::T>& out) {
+  auto ker = program.getKernel("col2im_8_1");
+
+  CL_ASSERT(in.dims() == 3);
+  CL_ASSERT(out.dims() == 4);
+  CL_ASSERT(geom.isValid());
+
+  // in = (batch) x (cin x kh x kw) x (outputH x outputW)
+  // out = (batch) x (cin) x (h) x (w)
+  size_t outputH = geom.outputH(out.getSize(2));
+  size_t outputW = geom.outputW(out.getSize(3));
+
+  CL_ASSERT(in.getSize(0) == out.getSize(0));
+  CL_ASSERT(in.getSize(1) == out.getSize(1) * geom.kH * geom.kW);
+  CL_ASSERT(in.getSize(2) == outputH * outputW);
+
+  return ker.callTask(queue,
+                      in,
+                      (int) out.getSize(0), // batch
+                      (int) out.getSize(1), // channels
+                      (int) out.getSize(2), // inputH
+                      (int) out.getSize(3), // inputW
+                      (int) outputH,
+                      (int) outputW,
+                      geom.kH,
+                      geom.kW,
+                      geom.strideH,
+                      geom.strideW,
+                      geom.padT,
+                      geom.padL,
+                      geom.dilationH,
+                      geom.dilationW,
+                      outScale,
+                      toDeviceBool(rounding == RoundOp::Stochastic),
                       out);
 }
 
@@ -58,29 +115,72 @@ runForwardPool2dNCHW(Context& context,
                      Queue& queue,
                      const CLTensor<FloatType<kWidth>::T>& in,
                      PoolOp poolType,
-                     int kHW,
-                     int padT,
-                     int padL,
-                     int strideHW,
+                     const KernelGeometry& geom,
                      RoundOp rounding,
                      char inScale,
                      char outScale,
                      CLTensor<FloatType<kWidth>::T>& out) {
-  auto ker = program.getKernel("positPool2d_8_1");
-
   CL_ASSERT(in.dims() == 4);
   CL_ASSERT(out.dims() == 4);
+  CL_ASSERT(geom.isValid());
 
-  size_t outputH =
-    calcKernelOutputSize(in.getSize(2), padT, padT, kHW, strideHW);
-  size_t outputW =
-    calcKernelOutputSize(in.getSize(3), padL, padL, kHW, strideHW);
+  size_t outputH = geom.outputH(in.getSize(2));
+  size_t outputW = geom.outputW(in.getSize(3));
 
   CL_ASSERT(out.getSize(0) == in.getSize(0));
   CL_ASSERT(out.getSize(1) == in.getSize(1));
   CL_ASSERT(out.getSize(2) == outputH);
   CL_ASSERT(out.getSize(3) == outputW);
 
+  // The specialized kernels run one work item per output point, over all
+  // (batch, channel) planes in parallel
+  size_t planes = in.getSize(0) * in.getSize(1);
+  bool contig = in.isContiguous() && out.isContiguous();
+
+  // The specialized windows are square and undilated; the max pool kernels
+  // take any padding, as they are given the output size
+  bool square = geom.kH == geom.kW && geom.strideH == geom.strideW &&
+    geom.dilationH == 1 && geom.dilationW == 1;
+
+  // Global average pool, e.g., the end of ResNet
+  if (poolType == PoolOp::Avg && contig && square &&
+      geom.kH == 7 && in.getSize(2) == 7 && in.getSize(3) == 7 &&
+      geom.padT == 0 && geom.padB == 0 && geom.padL == 0 && geom.padR == 0) {
+    auto ker = program.getKernel("positGlobalAvgPool7x7_8_1");
+
+    return ker.call(queue,
+                    Array3(planes),
+                    Array3(1),
+                    in,
+                    inScale,
+                    outScale,
+                    toDeviceBool(rounding == RoundOp::Stochastic),
+                    out);
+  }
+
+  // Each work group is one output row
+  if (poolType == PoolOp::Max && contig && square &&
+      geom.strideH == 2 && (geom.kH == 2 || geom.kH == 3) &&
+      outputW <= kMaxPoolGroupWidth) {
+    auto ker = program.getKernel(geom.kH == 2 ?
+                                 "positMaxPool2d_k2s2_8_1" :
+                                 "positMaxPool2d_k3s2_8_1");
+
+    return ker.call(queue,
+                    Array3(outputW, outputH, planes),
+                    Array3(outputW),
+                    in,
+                    (int) in.getSize(2), // inputH
+                    (int) in.getSize(3), // inputW
+                    (int) outputH,
+                    (int) outputW,
+                    geom.padT,
+                    geom.padL,
+                    out);
+  }
+
+  auto ker = program.getKernel("positPool2d_8_1");
+
   return ker.callTask(queue,
                       in,
                       (int) in.getSize(0), // batch
@@ -89,10 +189,14 @@ runForwardPool2dNCHW(Context& context,
                       (int) in.getSize(3), // inputW
                       (int) outputH,
                       (int) outputW,
-                      kHW,
-                      strideHW,
-                      padT,
-                      padL,
+                      geom.kH,
+                      geom.kW,
+                      geom.strideH,
+                      geom.strideW,
+                      geom.padT,
+                      geom.padL,
+                      geom.dilationH,
+                      geom.dilationW,
                       inScale,
                       outScale,
                       toDeviceBool(poolType == PoolOp::Avg),
@@ -108,21 +212,18 @@ runForwardConv2dNCHW(Context& context,
                      CLTensor<FloatType<kWidth>::T>& workspace,
                      const CLTensor<FloatType<kWidth>::T>& ker,
                      const CLTensor<FloatType<kWidth>::T>* bias,
-                     int padT,
-                     int padL,
-                     int strideHW,
+                     const KernelGeometry& geom,
                      RoundOp rounding,
                      char inScale,
                      char outScale,
-                     CLTensor<FloatType<kWidth>::T>& out) {
-  // Only square kernels supported at the moment
-  int kernelHW = ker.getSize(2);
-  CL_ASSERT(kernelHW == ker.getSize(3));
+                     CLTensor<FloatType<kWidth>::T>& out,
+                     bool relu) {
+  CL_ASSERT(ker.dims() == 4);
+  CL_ASSERT(ker.getSize(2) == geom.kH && ker.getSize(3) == geom.kW);
 
-  size_t outputH =
-    calcKernelOutputSize(in.getSize(2), padT, padT, kernelHW, strideHW);
-  size_t outputW =
-    calcKernelOutputSize(in.getSize(3), padL, padL, kernelHW, strideHW);
+  size_t kerSize = (size_t) geom.kH * geom.kW;
+  size_t outputH = geom.outputH(in.getSize(2));
+  size_t outputW = geom.outputW(in.getSize(3));
 
   CL_ASSERT(in.getSize(0) == out.getSize(0));
   CL_ASSERT(ker.getSize(0) == out.getSize(1));
@@ -130,7 +231,7 @@ runForwardConv2dNCHW(Context& context,
   CL_ASSERT(out.getSize(2) == outputH);
   CL_ASSERT(out.getSize(3) == outputW);
 
-  size_t workspace1 = in.getSize(1) * kernelHW * kernelHW;
+  size_t workspace1 = in.getSize(1) * kerSize;
   size_t workspace2 = outputH * outputW;
 
   if (workspace.dims() != 3 ||
@@ -139,62 +240,636 @@ runForwardConv2dNCHW(Context& context,
       workspace.getSize(2) != workspace2) {
     workspace = CLTensor<FloatType<kWidth>::T>(context,
                                  {in.getSize(0),
-                                     in.getSize(1) * kernelHW * kernelHW,
-                                     outputH * outputW});
+                                     workspace1,
+                                     workspace2});
   }
 
-  runIm2ColNCHW(context, program, queue,
-                in,
-                kernelHW,
-                padT,
-                padL,
-                strideHW,
-                workspace);
+  runIm2ColNCHW(context, program, queue, in, geom, workspace);
 
   // in = (batch) x (cin) x (h) x (w)
   // ker = (cout) x (cin x kh x kw)
   // out = (batch) x (cin x kh x kw) x (outputH x outputW)
 
   if (bias) {
-    for (int b = 0; b < out.getSize(0); ++b) {
-      CL_ASSERT(bias->getSize(0) == out.getSize(1));
-
-      runBroadcast(context, program, queue,
-                   // src
-                   *bias,
-                   // src offset
-                   0,
-                   // src batch stride
-                   1,
-                   // dst
-                   out,
-                   // dst offset
-                   b * out.getSize(1) * out.getSize(2) * out.getSize(3),
-                   // dst batch stride,
-                   out.getSize(2) * out.getSize(3),
-                   // num broadcast
-                   out.getSize(2) * out.getSize(3),
-                   // num batches
-                   out.getSize(1));
-    }
+    CL_ASSERT(bias->getSize(0) == out.getSize(1));
   }
 
   auto outView = out.view({out.getSize(0),
         out.getSize(1),
         out.getSize(2) * out.getSize(3)});
 
-  return runMM(context, program, queue,
-               // a matrix (kernels) is not batched
-               ker.view({ker.getSize(0),
-                     ker.getSize(1) * kernelHW * kernelHW}),
-               // b matrix is batched
-               workspace,
-               (bool) bias,
+  // The bias (one per output plane, i.e., per row of each output matrix) and
+  // ReLU are applied within the matrix multiply
+  return runMMBias(context, program, queue,
+                   // a matrix (kernels) is not batched
+                   ker.view({ker.getSize(0), workspace1}),
+                   // b matrix is batched
+                   workspace,
+                   bias,
+                   BiasMode::Row,
+                   relu,
+                   rounding,
+                   inScale,
+                   outScale,
+                   // c matrix is batched
+                   outView);
+}
+
+Event
+runWinogradFilterNCHW(Context& context,
+                      Program& program,
+                      Queue& queue,
+                      const CLTensor<FloatType<kWidth>::T>& ker,
+                      CLTensor<FloatType<kWidth>::T>& out) {
+  auto kerU = program.getKernel("positWinogradFilter8_1");
+
+  CL_ASSERT(ker.dims() == 4);
+  CL_ASSERT(ker.getSize(2) == 3 && ker.getSize(3) == 3);
+  CL_ASSERT(ker.isContiguous());
+
+  size_t outPlane = ker.getSize(0);
+  size_t inPlane = ker.getSize(1);
+
+  CL_ASSERT(out.isSize({kWinogradTilePoints, outPlane, inPlane}));
+
+  return kerU.call(queue,
+                   Array3(inPlane, outPlane),
+                   Array3(1),
+                   ker,
+                   (int) inPlane,
+                   (int) outPlane,
+                   out);
+}
+
+Event
+runForwardConv2dWinogradNCHW(Context& context,
+                             Program& program,
+                             Queue& queue,
+                             const CLTensor<FloatType<kWidth>::T>& in,
+                             CLTensor<FloatType<kWidth>::T>& workspace,
+                             CLTensor<FloatType<kWidth>::T>& workspaceProd,
+                             const CLTensor<FloatType<kWidth>::T>& kerU,
+                             const CLTensor<FloatType<kWidth>::T>* bias,
+                             const KernelGeometry& geom,
+                             RoundOp rounding,
+                             char inScale,
+                             char outScale,
+                             CLTensor<FloatType<kWidth>::T>& out,
+                             bool relu) {
+  auto kerIn = program.getKernel("positWinogradInput8_1");
+  auto kerOut = program.getKernel("positWinogradOutput8_1");
+
+  CL_ASSERT(in.dims() == 4);
+  CL_ASSERT(kerU.dims() == 3);
+  CL_ASSERT(out.dims() == 4);
+  CL_ASSERT(in.isContiguous());
+  CL_ASSERT(out.isContiguous());
+  CL_ASSERT(geom.kH == 3 && geom.kW == 3);
+  CL_ASSERT(geom.strideH == 1 && geom.strideW == 1);
+  CL_ASSERT(geom.dilationH == 1 && geom.dilationW == 1);
+
+  size_t batch = in.getSize(0);
+  size_t inPlane = in.getSize(1);
+  size_t outPlane = kerU.getSize(1);
+
+  size_t outputH = geom.outputH(in.getSize(2));
+  size_t outputW = geom.outputW(in.getSize(3));
+
+  CL_ASSERT(kerU.isSize({kWinogradTilePoints, outPlane, inPlane}));
+  CL_ASSERT(out.isSize({batch, outPlane, outputH, outputW}));
+
+  if (bias) {
+    CL_ASSERT(bias->getSize(0) == outPlane);
+  }
+
+  // Each tile gives a 2x2 block of output
+  size_t tilesH = divUp(outputH, (size_t) 2);
+  size_t tilesW = divUp(outputW, (size_t) 2);
+  size_t numTiles = batch * tilesH * tilesW;
+
+  if (!workspace.isSize({kWinogradTilePoints, inPlane, numTiles})) {
+    workspace = CLTensor<FloatType<kWidth>::T>(
+      context, {kWinogradTilePoints, inPlane, numTiles});
+  }
+
+  if (!workspaceProd.isSize({kWinogradTilePoints, outPlane, numTiles})) {
+    workspaceProd = CLTensor<FloatType<kWidth>::T>(
+      context, {kWinogradTilePoints, outPlane, numTiles});
+  }
+
+  // V = B^t d B
+  kerIn.call(queue,
+             Array3(tilesW, tilesH, batch * inPlane),
+             Array3(1),
+             in,
+             (int) inPlane,
+             (int) in.getSize(2), // inputH
+             (int) in.getSize(3), // inputW
+             (int) tilesH,
+             (int) tilesW,
+             (int) numTiles,
+             geom.padT,
+             geom.padL,
+             toDeviceBool(rounding == RoundOp::Stochastic),
+             workspace);
+
+  // M[p] = U[p] x V[p] for each of the 16 points p, summing the products over
+  // the input channels
+  runMM(context, program, queue,
+        kerU,
+        workspace,
+        false, // beta
+        rounding,
+        inScale,
+        0,
+        workspaceProd);
+
+  // Y = A^t M A
+  return kerOut.call(queue,
+                     Array3(tilesW, tilesH, batch * outPlane),
+                     Array3(1),
+                     workspaceProd,
+                     // unused if there is no bias
+                     bias ? *bias : out,
+                     toDeviceBool(bias != nullptr),
+                     toDeviceBool(relu),
+                     (int) outPlane,
+                     (int) outputH,
+                     (int) outputW,
+                     (int) tilesH,
+                     (int) tilesW,
+                     (int) numTiles,
+                     outScale,
+                     toDeviceBool(rounding == RoundOp::Stochastic),
+                     out);
+}
+
+Event
+runForwardGroupConv2dNCHW(Context& context,
+                          Program& program,
+                          Queue& queue,
+                          const CLTensor<FloatType<kWidth>::T>& in,
+                          const CLTensor<FloatType<kWidth>::T>& ker,
+                          const CLTensor<FloatType<kWidth>::T>* bias,
+                          int groups,
+                          const KernelGeometry& geom,
+                          RoundOp rounding,
+                          char inScale,
+                          char outScale,
+                          CLTensor<FloatType<kWidth>::T>& out,
+                          bool relu) {
+  auto kerConv = program.getKernel("positGroupConv2d_8_1");
+
+  CL_ASSERT(in.dims() == 4);
+  CL_ASSERT(ker.dims() == 4);
+  CL_ASSERT(out.dims() == 4);
+  CL_ASSERT(in.isContiguous());
+  CL_ASSERT(ker.isContiguous());
+  CL_ASSERT(out.isContiguous());
+  CL_ASSERT(ker.getSize(2) == geom.kH && ker.getSize(3) == geom.kW);
+
+  size_t batch = in.getSize(0);
+  size_t inPlane = in.getSize(1);
+  size_t outPlane = ker.getSize(0);
+
+  CL_ASSERT(groups > 0);
+  CL_ASSERT(inPlane % groups == 0);
+  CL_ASSERT(outPlane % groups == 0);
+  CL_ASSERT(ker.getSize(1) == inPlane / groups);
+
+  size_t outputH = geom.outputH(in.getSize(2));
+  size_t outputW = geom.outputW(in.getSize(3));
+
+  CL_ASSERT(out.isSize({batch, outPlane, outputH, outputW}));
+
+  if (bias) {
+    CL_ASSERT(bias->getSize(0) == outPlane);
+  }
+
+  return kerConv.call(queue,
+                      Array3(outputW, outputH, batch * outPlane),
+                      Array3(1),
+                      in,
+                      ker,
+                      // unused if there is no bias
+                      bias ? *bias : out,
+                      toDeviceBool(bias != nullptr),
+                      toDeviceBool(relu),
+                      (int) inPlane,
+                      (int) outPlane,
+                      groups,
+                      (int) in.getSize(2), // inputH
+                      (int) in.getSize(3), // inputW
+                      (int) outputH,
+                      (int) outputW,
+                      geom.kH,
+                      geom.kW,
+                      geom.strideH,
+                      geom.strideW,
+                      geom.padT,
+                      geom.padL,
+                      geom.dilationH,
+                      geom.dilationW,
+                      inScale,
+                      outScale,
+                      toDeviceBool(rounding == RoundOp::Stochastic),
+                      out);
+}
+
+Event
+runBackwardInputConv2dNCHW(Context& context,
+                           Program& program,
+                           Queue& queue,
+                           const CLTensor<FloatType<kWidth>::T>& gradOut,
+                           CLTensor<FloatType<kWidth>::T>& workspace,
+                           CLTensor<FloatType<kWidth>::T>& kerTranspose,
+                           const CLTensor<FloatType<kWidth>::T>& ker,
+                           const KernelGeometry& geom,
+                           RoundOp rounding,
+                           CLTensor<FloatType<kWidth>::T>& gradIn) {
+  CL_ASSERT(ker.dims() == 4);
+  CL_ASSERT(ker.getSize(2) == geom.kH && ker.getSize(3) == geom.kW);
+
+  size_t outputH = geom.outputH(gradIn.getSize(2));
+  size_t outputW = geom.outputW(gradIn.getSize(3));
+
+  CL_ASSERT(gradOut.getSize(0) == gradIn.getSize(0));
+  CL_ASSERT(ker.getSize(0) == gradOut.getSize(1));
+  CL_ASSERT(gradIn.getSize(1) == ker.getSize(1));
+  CL_ASSERT(gradOut.getSize(2) == outputH);
+  CL_ASSERT(gradOut.getSize(3) == outputW);
+
+  size_t batch = gradIn.getSize(0);
+  size_t cols = gradIn.getSize(1) * geom.kH * geom.kW;
+  size_t points = outputH * outputW;
+
+  if (workspace.dims() != 3 ||
+      workspace.getSize(0) != batch ||
+      workspace.getSize(1) != cols ||
+      workspace.getSize(2) != points) {
+    workspace = CLTensor<FloatType<kWidth>::T>(context,
+                                               {batch, cols, points});
+  }
+
+  // runMM has no transposed operand, so ker^t is materialized; the weight
+  // may have changed since the last call, so this is redone every time
+  if (!kerTranspose.isSize({cols, ker.getSize(0)})) {
+    kerTranspose =
+      CLTensor<FloatType<kWidth>::T>(context, {cols, ker.getSize(0)});
+  }
+
+  runTranspose(context, program, queue,
+               ker.view({ker.getSize(0), cols}),
+               kerTranspose);
+
+  // ker^t = (cin x kh x kw) x (cout)
+  // gradOut = (batch) x (cout) x (outputH x outputW)
+  // workspace = (batch) x (cin x kh x kw) x (outputH x outputW)
+  runMM(context, program, queue,
+        // a matrix (kernels) is not batched
+        kerTranspose,
+        // b matrix is batched
+        gradOut.view({batch, gradOut.getSize(1), points}),
+        false, // beta
+        rounding,
+        (char) 0,
+        (char) 0,
+        workspace);
+
+  // Each column entry, already rounded above, is summed back into the input
+  // point it came from and rounded again
+  return runCol2ImNCHW(context, program, queue,
+                       workspace,
+                       geom,
+                       rounding,
+                       (char) 0,
+                       gradIn);
+}
+
+Event
+runBackwardWeightConv2dNCHW(Context& context,
+                            Program& program,
+                            Queue& queue,
+                            const CLTensor<FloatType<kWidth>::T>& in,
+                            const CLTensor<FloatType<kWidth>::T>& gradOut,
+                            CLTensor<FloatType<kWidth>::T>& workspace,
+                            CLTensor<FloatType<kWidth>::T>& colTranspose,
+                            CLTensor<FloatType<kWidth>::T>& gradOutRows,
+                            CLTensor<FloatType<kWidth>::T>& ones,
+                            const KernelGeometry& geom,
+                            RoundOp rounding,
+                            CLTensor<FloatType<kWidth>::T>& gradKer,
+                            CLTensor<FloatType<kWidth>::T>* gradBias) {
+  CL_ASSERT(gradKer.dims() == 4);
+  CL_ASSERT(gradKer.getSize(2) == geom.kH && gradKer.getSize(3) == geom.kW);
+
+  size_t outputH = geom.outputH(in.getSize(2));
+  size_t outputW = geom.outputW(in.getSize(3));
+
+  CL_ASSERT(in.getSize(0) == gradOut.getSize(0));
+  CL_ASSERT(gradKer.getSize(0) == gradOut.getSize(1));
+  CL_ASSERT(in.getSize(1) == gradKer.getSize(1));
+  CL_ASSERT(gradOut.getSize(2) == outputH);
+  CL_ASSERT(gradOut.getSize(3) == outputW);
+
+  size_t batch = in.getSize(0);
+  size_t outPlane = gradOut.getSize(1);
+  size_t cols = in.getSize(1) * geom.kH * geom.kW;
+  size_t points = outputH * outputW;
+
+  if (workspace.dims() != 3 ||
+      workspace.getSize(0) != batch ||
+      workspace.getSize(1) != cols ||
+      workspace.getSize(2) != points) {
+    workspace = CLTensor<FloatType<kWidth>::T>(context,
+                                               {batch, cols, points});
+  }
+
+  runIm2ColNCHW(context, program, queue, in, geom, workspace);
+
+  // The sum over both the batch and the output points is a single matrix
+  // multiply, so each gradient is accumulated with one rounding:
+  // gradKer += (cout) x (batch x outputH x outputW) *
+  //            (batch x outputH x outputW) x (cin x kh x kw)
+  // runMM has no transposed operand, so the columns are transposed here
+  if (!colTranspose.isSize({batch, points, cols})) {
+    colTranspose =
+      CLTensor<FloatType<kWidth>::T>(context, {batch, points, cols});
+  }
+
+  runTranspose(context, program, queue, workspace, colTranspose);
+
+  // gradOut (batch) x (cout) x (points) -> (cout) x (batch x points)
+  if (!gradOutRows.isSize({outPlane, batch * points})) {
+    gradOutRows =
+      CLTensor<FloatType<kWidth>::T>(context, {outPlane, batch * points});
+  }
+
+  auto gradOutRowsView = gradOutRows.view({outPlane, batch, points});
+  runPermute(context, program, queue,
+             gradOut.view({batch, outPlane, points}),
+             {1, 0, 2},
+             gradOutRowsView);
+
+  auto gradKerView = gradKer.view({outPlane, cols});
+
+  auto ev = runMM(context, program, queue,
+                  gradOutRows,
+                  colTranspose.view({batch * points, cols}),
+                  true, // beta
+                  rounding,
+                  (char) 0,
+                  (char) 0,
+                  gradKerView);
+
+  if (gradBias) {
+    CL_ASSERT(gradBias->getSize(0) == outPlane);
+
+    if (!ones.isSize({batch * points})) {
+      ones = CLTensor<FloatType<kWidth>::T>(context, {batch * points});
+
+      runMemset(context, program, queue,
+                FloatType<kWidth>::kOne,
+                ones);
+    }
+
+    ev = runMV(context, program, queue,
+               gradOutRows, ones,
+               true, // beta
                rounding,
-               inScale,
-               outScale,
-               // c matrix is batched
-               outView);
+               (char) 0,
+               (char) 0,
+               *gradBias);
+  }
+
+  return ev;
+}
+
+
+Event
+runNCHWToNHWC(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              CLTensor<FloatType<kWidth>::T>& out) {
+  CL_ASSERT(in.dims() == 4);
+  CL_ASSERT(out.dims() == 4);
+
+  size_t batch = in.getSize(0);
+  size_t channels = in.getSize(1);
+
+  CL_ASSERT(out.isSize({batch, in.getSize(2), in.getSize(3), channels}));
+
+  // Each image is a (c) x (h x w) matrix to transpose; `in` may be strided
+  return runPermute(context, program, queue, in, {0, 2, 3, 1}, out);
+}
+
+Event
+runNHWCToNCHW(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              CLTensor<FloatType<kWidth>::T>& out) {
+  CL_ASSERT(in.dims() == 4);
+  CL_ASSERT(out.dims() == 4);
+
+  size_t batch = in.getSize(0);
+  size_t channels = in.getSize(3);
+
+  CL_ASSERT(out.isSize({batch, channels, in.getSize(1), in.getSize(2)}));
+
+  return runPermute(context, program, queue, in, {0, 3, 1, 2}, out);
+}
+
+Event
+runConvWeightToNHWC(Context& context,
+                    Program& program,
+                    Queue& queue,
+                    const CLTensor<FloatType<kWidth>::T>& ker,
+                    CLTensor<FloatType<kWidth>::T>& out) {
+  CL_ASSERT(ker.dims() == 4);
+
+  size_t outPlane = ker.getSize(0);
+  size_t inPlane = ker.getSize(1);
+  size_t kerSize = ker.getSize(2) * ker.getSize(3);
+
+  CL_ASSERT(out.isSize({kerSize * inPlane, outPlane}));
+
+  // (cout) x (cin) x (kh x kw) -> (kh x kw) x (cin) x (cout)
+  auto outView = out.view({kerSize, inPlane, outPlane});
+  return runPermute(context, program, queue,
+                    ker.view({outPlane, inPlane, kerSize}),
+                    {2, 1, 0},
+                    outView);
+}
+
+Event
+runIm2ColNHWC(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              const KernelGeometry& geom,
+              CLTensor<FloatType<kWidth>::T>& out) {
+  auto ker = program.getKernel("im2col_nhwc_8");
+
+  CL_ASSERT(in.dims() == 4);
+  CL_ASSERT(out.dims() == 2);
+  CL_ASSERT(in.isContiguous());
+  CL_ASSERT(out.isContiguous());
+  CL_ASSERT(geom.isValid());
+
+  // in = (batch) x (h) x (w) x (cin)
+  // out = (batch x outputH x outputW) x (kh x kw x cin)
+  size_t batch = in.getSize(0);
+  size_t channels = in.getSize(3);
+  size_t outputH = geom.outputH(in.getSize(1));
+  size_t outputW = geom.outputW(in.getSize(2));
+
+  CL_ASSERT(out.getSize(0) == batch * outputH * outputW);
+  CL_ASSERT(out.getSize(1) == geom.kH * geom.kW * channels);
+
+  return ker.call(queue,
+                  Array3(outputW, outputH, batch),
+                  Array3(1),
+                  in,
+                  (int) channels,
+                  (int) in.getSize(1), // inputH
+                  (int) in.getSize(2), // inputW
+                  (int) outputH,
+                  (int) outputW,
+                  geom.kH,
+                  geom.kW,
+                  geom.strideH,
+                  geom.strideW,
+                  geom.padT,
+                  geom.padL,
+                  geom.dilationH,
+                  geom.dilationW,
+                  out);
+}
+
+Event
+runForwardPool2dNHWC(Context& context,
+                     Program& program,
+                     Queue& queue,
+                     const CLTensor<FloatType<kWidth>::T>& in,
+                     PoolOp poolType,
+                     const KernelGeometry& geom,
+                     RoundOp rounding,
+                     char inScale,
+                     char outScale,
+                     CLTensor<FloatType<kWidth>::T>& out) {
+  auto ker = program.getKernel("positPool2d_nhwc_8_1");
+
+  CL_ASSERT(in.dims() == 4);
+  CL_ASSERT(out.dims() == 4);
+  CL_ASSERT(in.isContiguous());
+  CL_ASSERT(out.isContiguous());
+  CL_ASSERT(geom.isValid());
+
+  size_t batch = in.getSize(0);
+  size_t channels = in.getSize(3);
+  size_t outputH = geom.outputH(in.getSize(1));
+  size_t outputW = geom.outputW(in.getSize(2));
+
+  CL_ASSERT(out.isSize({batch, outputH, outputW, channels}));
+
+  size_t groupC = (channels % kChannelGroupSize == 0) ? kChannelGroupSize : 1;
+
+  return ker.call(queue,
+                  Array3(channels, outputH * outputW, batch),
+                  Array3(groupC),
+                  in,
+                  (int) channels,
+                  (int) in.getSize(1), // inputH
+                  (int) in.getSize(2), // inputW
+                  (int) outputH,
+                  (int) outputW,
+                  geom.kH,
+                  geom.kW,
+                  geom.strideH,
+                  geom.strideW,
+                  geom.padT,
+                  geom.padL,
+                  geom.dilationH,
+                  geom.dilationW,
+                  inScale,
+                  outScale,
+                  toDeviceBool(poolType == PoolOp::Avg),
+                  toDeviceBool(rounding == RoundOp::Stochastic),
+                  out);
+}
+
+Event
+runForwardConv2dNHWC(Context& context,
+                     Program& program,
+                     Queue& queue,
+                     const CLTensor<FloatType<kWidth>::T>& in,
+                     CLTensor<FloatType<kWidth>::T>& workspace,
+                     const CLTensor<FloatType<kWidth>::T>& ker,
+                     const CLTensor<FloatType<kWidth>::T>* bias,
+                     const KernelGeometry& geom,
+                     RoundOp rounding,
+                     char inScale,
+                     char outScale,
+                     CLTensor<FloatType<kWidth>::T>& out,
+                     bool relu) {
+  CL_ASSERT(in.dims() == 4);
+  CL_ASSERT(ker.dims() == 2);
+  CL_ASSERT(out.dims() == 4);
+
+  size_t batch = in.getSize(0);
+  size_t inPlane = in.getSize(3);
+  size_t outPlane = ker.getSize(1);
+  size_t outputH = geom.outputH(in.getSize(1));
+  size_t outputW = geom.outputW(in.getSize(2));
+
+  size_t rows = batch * outputH * outputW;
+  size_t cols = inPlane * geom.kH * geom.kW;
+
+  CL_ASSERT(ker.getSize(0) == cols);
+  CL_ASSERT(out.isSize({batch, outputH, outputW, outPlane}));
+
+  if (bias) {
+    CL_ASSERT(bias->getSize(0) == outPlane);
+  }
+
+  // out = (batch x outputH x outputW) x (cout), with the bias (one per output
+  // channel, i.e., per column) and ReLU applied within the matrix multiply
+  auto outView = out.view({rows, outPlane});
+
+  // Every input point is already a row of the (batch x h x w) x (cin) matrix
+  if (geom.kH == 1 && geom.kW == 1 &&
+      geom.strideH == 1 && geom.strideW == 1 &&
+      geom.padT == 0 && geom.padB == 0 && geom.padL == 0 && geom.padR == 0) {
+    return runMMBias(context, program, queue,
+                     in.view({rows, inPlane}),
+                     ker,
+                     bias,
+                     BiasMode::Col,
+                     relu,
+                     rounding,
+                     inScale,
+                     outScale,
+                     outView);
+  }
+
+  if (!workspace.isSize({rows, cols})) {
+    workspace = CLTensor<FloatType<kWidth>::T>(context, {rows, cols});
+  }
+
+  runIm2ColNHWC(context, program, queue, in, geom, workspace);
+
+  return runMMBias(context, program, queue,
+                   workspace,
+                   ker,
+                   bias,
+                   BiasMode::Col,
+                   relu,
+                   rounding,
+                   inScale,
+                   outScale,
+                   outView);
 }
 
 } } // namespace
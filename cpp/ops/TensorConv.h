@@ -8,10 +8,14 @@
 #include "FloatDefs.h"
 #include "utils/Event.h"
 #include "utils/Tensor.h"
+#include "ops/KernelGeometry.h"
+#include "ops/Layout.h"
 #include "ops/PoolOp.h"
 #include "ops/RoundOp.h"
 
-/// Collection of convnet routines
+/// Collection of convnet routines. Windows are given by a KernelGeometry, so
+/// kernels may be rectangular, with separate strides, padding on each side
+/// and dilation.
 
 namespace facebook { namespace cl {
 
@@ -19,38 +23,42 @@ class Context;
 class Program;
 class Queue;
 
-template <typename T, typename U>
-constexpr T calcKernelOutputSize(T inSize, U padBefore, U padAfter,
-                                 U kernel, U stride) {
-  return ((inSize + (T) padBefore +
-           (T) padAfter - (T) kernel) / (T) stride) + (T) 1;
-}
-
 // Input is [batch][channel][height][width]
-// Output is [batch][channel x kHW x kHW][output height x output width]
+// Output is [batch][channel x kH x kW][output height x output width]
 Event
 runIm2ColNCHW(Context& context,
               Program& program,
               Queue& queue,
               const CLTensor<FloatType<kWidth>::T>& in,
-              unsigned int kHW,
-              unsigned int padT,
-              unsigned int padL,
-              unsigned int strideHW,
+              const KernelGeometry& geom,
+              CLTensor<FloatType<kWidth>::T>& out);
+
+// Inverse of runIm2ColNCHW; `out` gives the image size
+// Input is [batch][channel x kH x kW][output height x output width]
+// Output is [batch][channel][height][width]
+// Entries of overlapping windows are summed exactly, with a single rounding
+// per output
+Event
+runCol2ImNCHW(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              const KernelGeometry& geom,
+              RoundOp rounding,
+              char outScale,
               CLTensor<FloatType<kWidth>::T>& out);
 
 // Input is [batch][channel][height][width]
 // Output is [batch][channel][output height][output width]
+// 2x2 and 3x3 stride 2 max pooling and 7x7 global average pooling use kernels
+// specialized to the window; other windows use a generic serial kernel.
 Event
 runForwardPool2dNCHW(Context& context,
                      Program& program,
                      Queue& queue,
                      const CLTensor<FloatType<kWidth>::T>& in,
                      PoolOp poolType,
-                     int kHW,
-                     int padT,
-                     int padL,
-                     int strideHW,
+                     const KernelGeometry& geom,
                      RoundOp rounding,
                      char inScale,
                      char outScale,
@@ -59,7 +67,7 @@ runForwardPool2dNCHW(Context& context,
 // Performs 2-d forward convolution
 // Input is [batch][input channel][height][width]
 // Output is [batch][output channel][height][width]
-// Weight is [output channel][input channel][kh][kw]
+// Weight is [output channel][input channel][kH][kW], as given by `geom`
 // Bias (optional) is [output channel]
 Event
 runForwardConv2dNCHW(Context& context,
@@ -69,12 +77,195 @@ runForwardConv2dNCHW(Context& context,
                      CLTensor<FloatType<kWidth>::T>& workspace,
                      const CLTensor<FloatType<kWidth>::T>& ker,
                      const CLTensor<FloatType<kWidth>::T>* bias,
-                     int padT,
-                     int padL,
-                     int strideHW,
+                     const KernelGeometry& geom,
+                     RoundOp rounding,
+                     char inScale,
+                     char outScale,
+                     CLTensor<FloatType<kWidth>::T>& out,
+                     // if set, max(out, 0) is written instead
+                     bool relu = false);
+
+// Number of points of a Winograd F(2x2, 3x3) tile
+constexpr size_t kWinogradTilePoints = 16;
+
+// Winograd F(2x2, 3x3) filter transform, G g G^t, of each 3x3 filter
+// Weight is [output channel][input channel][3][3]
+// Output is [16][output channel][input channel]
+Event
+runWinogradFilterNCHW(Context& context,
+                      Program& program,
+                      Queue& queue,
+                      const CLTensor<FloatType<kWidth>::T>& ker,
+                      CLTensor<FloatType<kWidth>::T>& out);
+
+// 2-d forward convolution by Winograd F(2x2, 3x3), for undilated 3x3 stride 1
+// kernels (with any padding), taking the weight as transformed by
+// runWinogradFilterNCHW. The transforms are exact sums rounded once per
+// value, but the transformed input and the products are rounded as well, so
+// results may differ from runForwardConv2dNCHW.
+// Input is [batch][input channel][height][width]
+// Output is [batch][output channel][height][width]
+// Bias (optional) is [output channel]
+Event
+runForwardConv2dWinogradNCHW(Context& context,
+                             Program& program,
+                             Queue& queue,
+                             const CLTensor<FloatType<kWidth>::T>& in,
+                             // transformed input and products
+                             CLTensor<FloatType<kWidth>::T>& workspace,
+                             CLTensor<FloatType<kWidth>::T>& workspaceProd,
+                             const CLTensor<FloatType<kWidth>::T>& kerU,
+                             const CLTensor<FloatType<kWidth>::T>* bias,
+                             const KernelGeometry& geom,
+                             RoundOp rounding,
+                             char inScale,
+                             char outScale,
+                             CLTensor<FloatType<kWidth>::T>& out,
+                             bool relu = false);
+
+// Grouped 2-d forward convolution (including depthwise, with groups equal to
+// the number of input channels), computed directly rather than by im2col +
+// matrix multiply
+// Input is [batch][input channel][height][width]
+// Weight is [output channel][input channel / groups][kH][kW]
+// Output is [batch][output channel][height][width]
+// Bias (optional) is [output channel]
+Event
+runForwardGroupConv2dNCHW(Context& context,
+                          Program& program,
+                          Queue& queue,
+                          const CLTensor<FloatType<kWidth>::T>& in,
+                          const CLTensor<FloatType<kWidth>::T>& ker,
+                          const CLTensor<FloatType<kWidth>::T>* bias,
+                          int groups,
+                          const KernelGeometry& geom,
+                          RoundOp rounding,
+                          char inScale,
+                          char outScale,
+                          CLTensor<FloatType<kWidth>::T>& out,
+                          bool relu = false);
+
+// Gradient of 2-d convolution with respect to its input
+// gradOut is [batch][output channel][output height][output width]
+// gradIn is [batch][input channel][height][width]
+// Weight is [output channel][input channel][kH][kW]
+// This rounds twice: the sums over output channels (weight^t x gradOut) are
+// rounded into the workspace columns, and col2im then rounds again when it
+// sums the overlapping windows into each input point
+// kerTranspose receives weight^t, as [input channel x kH x kW][output channel];
+// like the workspace, it is reallocated only if its size is wrong
+Event
+runBackwardInputConv2dNCHW(Context& context,
+                           Program& program,
+                           Queue& queue,
+                           const CLTensor<FloatType<kWidth>::T>& gradOut,
+                           CLTensor<FloatType<kWidth>::T>& workspace,
+                           CLTensor<FloatType<kWidth>::T>& kerTranspose,
+                           const CLTensor<FloatType<kWidth>::T>& ker,
+                           const KernelGeometry& geom,
+                           RoundOp rounding,
+                           CLTensor<FloatType<kWidth>::T>& gradIn);
+
+// Gradient of 2-d convolution with respect to its weight and bias, which
+// is accumulated into gradKer (and gradBias, if given)
+// Input is [batch][input channel][height][width]
+// gradOut is [batch][output channel][output height][output width]
+// gradKer is [output channel][input channel][kH][kW]
+// gradBias (optional) is [output channel]
+// colTranspose and gradOutRows receive the transposed im2col columns and
+// gradOut as [output channel][batch x output points]; ones holds 1s for the
+// bias reduction, and is only filled when (re)allocated, so callers must
+// not otherwise write to it. All are reallocated only if their size is wrong
+Event
+runBackwardWeightConv2dNCHW(Context& context,
+                            Program& program,
+                            Queue& queue,
+                            const CLTensor<FloatType<kWidth>::T>& in,
+                            const CLTensor<FloatType<kWidth>::T>& gradOut,
+                            CLTensor<FloatType<kWidth>::T>& workspace,
+                            CLTensor<FloatType<kWidth>::T>& colTranspose,
+                            CLTensor<FloatType<kWidth>::T>& gradOutRows,
+                            CLTensor<FloatType<kWidth>::T>& ones,
+                            const KernelGeometry& geom,
+                            RoundOp rounding,
+                            CLTensor<FloatType<kWidth>::T>& gradKer,
+                            CLTensor<FloatType<kWidth>::T>* gradBias);
+
+
+//
+// Channels-last (NHWC) variants, for inference
+//
+
+// out[b][h][w][c] = in[b][c][h][w]
+Event
+runNCHWToNHWC(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              CLTensor<FloatType<kWidth>::T>& out);
+
+// out[b][c][h][w] = in[b][h][w][c]
+Event
+runNHWCToNCHW(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              CLTensor<FloatType<kWidth>::T>& out);
+
+// Reorders a weight for runForwardConv2dNHWC
+// Weight is [output channel][input channel][kH][kW]
+// Output is [kH x kW x input channel][output channel]
+Event
+runConvWeightToNHWC(Context& context,
+                    Program& program,
+                    Queue& queue,
+                    const CLTensor<FloatType<kWidth>::T>& ker,
+                    CLTensor<FloatType<kWidth>::T>& out);
+
+// Input is [batch][height][width][channel]
+// Output is [batch x output height x output width][kH x kW x channel]
+Event
+runIm2ColNHWC(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              const KernelGeometry& geom,
+              CLTensor<FloatType<kWidth>::T>& out);
+
+// Input is [batch][height][width][channel]
+// Output is [batch][output height][output width][channel]
+Event
+runForwardPool2dNHWC(Context& context,
+                     Program& program,
+                     Queue& queue,
+                     const CLTensor<FloatType<kWidth>::T>& in,
+                     PoolOp poolType,
+                     const KernelGeometry& geom,
                      RoundOp rounding,
                      char inScale,
                      char outScale,
                      CLTensor<FloatType<kWidth>::T>& out);
 
+// Performs 2-d forward convolution as a single matrix multiply of the im2col
+// rows by the weight; an unpadded 1x1 stride 1 convolution needs no im2col
+// Input is [batch][height][width][input channel]
+// Output is [batch][height][width][output channel]
+// Weight is [kH x kW x input channel][output channel] (see
+// runConvWeightToNHWC)
+// Bias (optional) is [output channel]
+Event
+runForwardConv2dNHWC(Context& context,
+                     Program& program,
+                     Queue& queue,
+                     const CLTensor<FloatType<kWidth>::T>& in,
+                     CLTensor<FloatType<kWidth>::T>& workspace,
+                     const CLTensor<FloatType<kWidth>::T>& ker,
+                     const CLTensor<FloatType<kWidth>::T>* bias,
+                     const KernelGeometry& geom,
+                     RoundOp rounding,
+                     char inScale,
+                     char outScale,
+                     CLTensor<FloatType<kWidth>::T>& out,
+                     bool relu = false);
+
 } }
@@ -7,6 +7,8 @@
 
 #include "utils/CLTensor.h"
 #include "utils/HostTensor.h"
+#include "ops/HostCodec.h"
+#include "ops/HostRound.h"
 #include "ops/TensorMath.h"
 
 namespace facebook { namespace cl {
@@ -36,12 +38,44 @@ toDevicePosit(Context& context,
   return p;
 }
 
+// Rounds stochastically on the host (see HostRounder), so that the result
+// only depends on `seed`
+template <int Dim>
+CLTensor<FloatType<kWidth>::T>
+toDevicePositStochastic(Context& context,
+                        Program& program,
+                        Queue& queue,
+                        const HostTensor<float, Dim>& t,
+                        uint64_t seed,
+                        RandomMode mode = RandomMode::Philox) {
+  CL_ASSERT(t.isContiguous());
+
+  auto& rounder = getHostRounder(context, program, queue);
+
+  HostTensor<FloatType<kWidth>::T, Dim> p(t.sizes());
+  rounder.roundStochastic(t.data(), p.data(), t.numElements(), seed, mode);
+
+  return CLTensor<FloatType<kWidth>::T>(context, queue, p);
+}
+
 template <int Dim>
 HostTensor<float, Dim> fromDevicePosit(Context& context,
                                        Program& program,
                                        Queue& queue,
                                        const CLTensor<FloatType<kWidth>::T>& t) {
   CL_ASSERT(t.dims() == Dim);
+
+  if (getConvertPath() == ConvertPath::HostTable) {
+    // Transfers a quarter of the bytes of a float download
+    auto& decoder = getHostDecoder(context, program, queue);
+    auto p = t.toHost<Dim>(queue);
+
+    HostTensor<float, Dim> out(t.sizes());
+    decoder.decode(p.data(), out.data(), out.numElements());
+
+    return out;
+  }
+
   CLTensor<float> outF(context, t.sizes());
 
   runToFloat(context, program, queue, t, outF);
@@ -0,0 +1,262 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "ops/TensorInspect.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include "ops/HostCodec.h"
+#include "ops/TensorMemory.h"
+#include "ops/TensorPrint.h"
+#include "utils/OpenCLUtils.h"
+
+namespace facebook { namespace cl {
+
+namespace {
+
+// Stats of n encoded values
+TensorStats
+computeStats(const HostDecoder& decoder,
+             const FloatType<kWidth>::T* v,
+             size_t n) {
+  auto& table = decoder.getTable();
+
+  // The exponent range and saturation magnitude of the encoding
+  float largest = 0;
+  int minExp = 0;
+  int maxExp = 0;
+  bool first = true;
+
+  for (auto f : table) {
+    if (!std::isfinite(f) || f == 0) {
+      continue;
+    }
+
+    largest = std::max(largest, std::abs(f));
+
+    int e = std::ilogb(f);
+    minExp = first ? e : std::min(minExp, e);
+    maxExp = first ? e : std::max(maxExp, e);
+    first = false;
+  }
+
+  TensorStats s;
+  s.numElements = n;
+  s.min = 0;
+  s.max = 0;
+  s.mean = 0;
+  s.zeros = 0;
+  s.saturated = 0;
+  s.infs = 0;
+  s.minExponent = minExp;
+  s.exponentHistogram.assign(first ? 0 : (size_t) (maxExp - minExp + 1), 0);
+
+  double sum = 0;
+  size_t finite = 0;
+
+  for (size_t i = 0; i < n; ++i) {
+    float f = decoder.decode(v[i]);
+
+    if (!std::isfinite(f)) {
+      ++s.infs;
+      continue;
+    }
+
+    s.min = finite == 0 ? f : std::min(s.min, f);
+    s.max = finite == 0 ? f : std::max(s.max, f);
+    sum += (double) f;
+    ++finite;
+
+    if (f == 0) {
+      ++s.zeros;
+      continue;
+    }
+
+    if (std::abs(f) == largest) {
+      ++s.saturated;
+    }
+
+    ++s.exponentHistogram[std::ilogb(f) - minExp];
+  }
+
+  s.mean = finite > 0 ? (float) (sum / (double) finite) : 0;
+
+  return s;
+}
+
+}
+
+bool Inspector::enabled_ = false;
+
+Inspector&
+Inspector::get() {
+  static Inspector inspector;
+  return inspector;
+}
+
+Inspector::Inspector()
+    : record_(true),
+      nextHookId_(0),
+      collected_(0) {
+}
+
+void
+Inspector::enable(bool enable) {
+  enabled_ = enable;
+}
+
+void
+Inspector::setFilter(const std::string& filter) {
+  filter_ = filter;
+}
+
+void
+Inspector::setRecord(bool record) {
+  record_ = record;
+}
+
+int
+Inspector::addHook(InspectHook hook) {
+  int id = nextHookId_++;
+  hooks_.emplace_back(id, std::move(hook));
+
+  return id;
+}
+
+void
+Inspector::removeHook(int id) {
+  hooks_.erase(std::remove_if(hooks_.begin(), hooks_.end(),
+                              [id](const std::pair<int, InspectHook>& h) {
+                                return h.first == id;
+                              }),
+               hooks_.end());
+}
+
+void
+Inspector::inspect(Context& context,
+                   Program& program,
+                   Queue& queue,
+                   const std::string& layer,
+                   const std::string& tag,
+                   const CLTensor<FloatType<kWidth>::T>& t) {
+  if (!filter_.empty() && layer.find(filter_) == std::string::npos) {
+    return;
+  }
+
+  for (auto& h : hooks_) {
+    h.second(context, program, queue, layer, tag, t);
+  }
+
+  if (!record_) {
+    return;
+  }
+
+  InspectRecord r;
+  r.layer = layer;
+  r.tag = tag;
+  r.sizes = t.sizes();
+
+  CLTensor<FloatType<kWidth>::T> snapshot;
+
+  if (t.numElements() > 0) {
+    snapshot = CLTensor<FloatType<kWidth>::T>(
+      context, std::vector<size_t>{t.numElements()});
+    auto snapshotView = snapshot.view(t.sizes());
+    runCopy(context, program, queue, t, snapshotView);
+  }
+
+  records_.emplace_back(std::move(r));
+  snapshots_.emplace_back(std::move(snapshot));
+}
+
+void
+Inspector::collect(Context& context, Program& program, Queue& queue) {
+  auto& decoder = getHostDecoder(context, program, queue);
+
+  for (; collected_ < records_.size(); ++collected_) {
+    auto& r = records_[collected_];
+    auto& snapshot = snapshots_[collected_];
+
+    if (snapshot.dims() == 0) {
+      r.stats = computeStats(decoder, nullptr, 0);
+      continue;
+    }
+
+    auto host = snapshot.toHost<1>(queue);
+    r.stats = computeStats(decoder, host.data(), host.getSize(0));
+
+    snapshot = CLTensor<FloatType<kWidth>::T>();
+  }
+}
+
+const std::vector<InspectRecord>&
+Inspector::getRecords(Context& context, Program& program, Queue& queue) {
+  collect(context, program, queue);
+  return records_;
+}
+
+void
+Inspector::clear(size_t first) {
+  if (first >= records_.size()) {
+    return;
+  }
+
+  records_.erase(records_.begin() + first, records_.end());
+  snapshots_.erase(snapshots_.begin() + first, snapshots_.end());
+  collected_ = std::min(collected_, first);
+}
+
+TensorStats
+getTensorStats(Context& context,
+               Program& program,
+               Queue& queue,
+               const CLTensor<FloatType<kWidth>::T>& t) {
+  auto& decoder = getHostDecoder(context, program, queue);
+
+  if (t.numElements() == 0) {
+    return computeStats(decoder, nullptr, 0);
+  }
+
+  CLTensor<FloatType<kWidth>::T> flat(
+    context, std::vector<size_t>{t.numElements()});
+  auto flatView = flat.view(t.sizes());
+  runCopy(context, program, queue, t, flatView);
+
+  auto host = flat.toHost<1>(queue);
+  return computeStats(decoder, host.data(), host.getSize(0));
+}
+
+std::string
+inspectRecordsToString(const std::vector<InspectRecord>& records) {
+  std::stringstream ss;
+
+  for (auto& r : records) {
+    auto& s = r.stats;
+
+    ss << r.layer << " " << r.tag << " " << r.sizes
+       << ": min " << s.min << " max " << s.max << " mean " << s.mean
+       << " zeros " << s.zeros << " saturated " << s.saturated
+       << " inf " << s.infs << "\n";
+  }
+
+  return ss.str();
+}
+
+InspectHook
+printInspectHook() {
+  return [](Context& context,
+            Program& program,
+            Queue& queue,
+            const std::string& layer,
+            const std::string& tag,
+            const CLTensor<FloatType<kWidth>::T>& t) {
+    std::cout << layer << " " << tag << ":" << std::endl;
+    printPositTensor(context, program, queue, t);
+  };
+}
+
+} }
@@ -0,0 +1,157 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "FloatDefs.h"
+#include "utils/Tensor.h"
+
+/// Opt-in inspection of the tensors passed between layers (and of layer
+/// intermediates), replacing ad-hoc printing. Tensors are snapshotted with a
+/// device to device copy; their statistics are only computed on the host when
+/// asked for.
+
+namespace facebook { namespace cl {
+
+class Context;
+class Program;
+class Queue;
+
+struct TensorStats {
+  size_t numElements;
+
+  // Over finite values; 0 if there are none
+  float min;
+  float max;
+  float mean;
+
+  size_t zeros;
+
+  // Values at the largest finite magnitude, where rounding saturates
+  size_t saturated;
+
+  // Values that are inf (NaR)
+  size_t infs;
+
+  // exponentHistogram[i] counts the finite non-zero values v with
+  // ilogb(v) == minExponent + i; the range covers every encoding
+  int minExponent;
+  std::vector<size_t> exponentHistogram;
+};
+
+struct InspectRecord {
+  // Layer (e.g., "ResNet / 12: Conv2d (...)") and tensor (e.g., "output")
+  std::string layer;
+  std::string tag;
+
+  std::vector<size_t> sizes;
+
+  // Valid once collected
+  TensorStats stats;
+};
+
+// Called synchronously with the live tensor for every inspection point
+using InspectHook =
+  std::function<void(Context& context,
+                     Program& program,
+                     Queue& queue,
+                     const std::string& layer,
+                     const std::string& tag,
+                     const CLTensor<FloatType<kWidth>::T>& t)>;
+
+// Process-wide; while disabled, the only cost at an inspection point is a
+// test of a global flag.
+class Inspector {
+ public:
+  static Inspector& get();
+
+  static inline bool isEnabled() {
+    return enabled_;
+  }
+
+  void enable(bool enable);
+
+  // Only layers whose name contains `filter` are inspected; empty for all
+  void setFilter(const std::string& filter);
+
+  // Whether inspection points record snapshots (the default) in addition to
+  // calling the hooks
+  void setRecord(bool record);
+
+  // Returns an id for removeHook
+  int addHook(InspectHook hook);
+  void removeHook(int id);
+
+  void inspect(Context& context,
+               Program& program,
+               Queue& queue,
+               const std::string& layer,
+               const std::string& tag,
+               const CLTensor<FloatType<kWidth>::T>& t);
+
+  // Computes the statistics of all outstanding records
+  void collect(Context& context, Program& program, Queue& queue);
+
+  // Returns all records, collected
+  const std::vector<InspectRecord>& getRecords(Context& context,
+                                               Program& program,
+                                               Queue& queue);
+
+  // Drops all records from index `first` on
+  void clear(size_t first = 0);
+
+ private:
+  Inspector();
+
+  static bool enabled_;
+
+  std::string filter_;
+  bool record_;
+
+  std::vector<std::pair<int, InspectHook>> hooks_;
+  int nextHookId_;
+
+  std::vector<InspectRecord> records_;
+
+  // Device copy of the tensor of each record, released once collected
+  std::vector<CLTensor<FloatType<kWidth>::T>> snapshots_;
+
+  // Records before this index have been collected
+  size_t collected_;
+};
+
+// Statistics of `t`, computed on the host from its encodings
+TensorStats
+getTensorStats(Context& context,
+               Program& program,
+               Queue& queue,
+               const CLTensor<FloatType<kWidth>::T>& t);
+
+// One line per record
+std::string
+inspectRecordsToString(const std::vector<InspectRecord>& records);
+
+// A hook that prints the tensor, as the former Sequential logging did
+InspectHook printInspectHook();
+
+// Inspects `t` if the inspector is enabled. `layerFn` returns the layer name,
+// and is only called if enabled.
+template <typename F>
+inline void
+inspectTensor(Context& context,
+              Program& program,
+              Queue& queue,
+              const F& layerFn,
+              const char* tag,
+              const CLTensor<FloatType<kWidth>::T>& t) {
+  if (Inspector::isEnabled()) {
+    Inspector::get().inspect(context, program, queue, layerFn(), tag, t);
+  }
+}
+
+} } // namespace
@@ -4,7 +4,11 @@
 // This source code is licensed under the license found in the
 // LICENSE file in the root directory of this source tree.
 #include "ops/TensorMath.h"
+#include "ops/TensorMemory.h"
 #include "utils/MathUtils.h"
+#include "utils/Program.h"
+#include <algorithm>
+#include <memory>
 #include <random>
 
 namespace facebook { namespace cl {
@@ -90,21 +94,54 @@ runEye(Context& context,
        Queue& queue,
        CLTensor<FloatType<kWidth>::T>& inOut) {
   CL_ASSERT(inOut.dims() == 2);
+  CL_ASSERT(inOut.isContiguous());
 
-  // FIXME: implement on the FPGA
-  HostTensor<FloatType<kWidth>::T, 2> t(inOut.sizes());
+  runMemset(context, program, queue, FloatType<kWidth>::kZero, inOut);
 
-  for (int i = 0; i < t.getSize(0); ++i) {
-    for (int j = 0; j < t.getSize(0); ++j) {
-      if (i == j) {
-        t[i][i] = FloatType<kWidth>::kOne;
-      } else {
-        t[i][j] = FloatType<kWidth>::kZero;
-      }
-    }
-  }
+  // The diagonal is a batch of single elements strided by a row plus one
+  auto ker = program.getKernel("mem_8");
+  auto& mem = inOut.getDeviceMem();
+
+  return ker.callTask(queue,
+                      baseMem(mem), // dummy
+                      (unsigned int) 0,
+                      FloatType<kWidth>::T(FloatType<kWidth>::kOne),
+                      kHostScalarOp,
+                      baseMem(mem), // dst
+                      (unsigned int) mem.getOffset(),
+                      (unsigned int) std::min(inOut.getSize(0),
+                                              inOut.getSize(1)),
+                      1,
+                      0,
+                      (unsigned int) inOut.getSize(1) + 1);
+}
+
+namespace {
+
+Event
+runRandom(Context& context,
+          Program& program,
+          Queue& queue,
+          bool gaussian,
+          float a, float b,
+          CLTensor<FloatType<kWidth>::T>& inOut) {
+  auto ker = program.getKernel("random8_1");
+  CL_ASSERT(inOut.isContiguous());
+
+  std::random_device rd;
+  uint32_t seedLo = rd();
+  uint32_t seedHi = rd();
+
+  return ker.callTask(queue,
+                      (unsigned int) inOut.numElements(),
+                      seedLo,
+                      seedHi,
+                      toDeviceBool(gaussian),
+                      a,
+                      b,
+                      inOut);
+}
 
-  return inOut.copyFrom(queue, t);
 }
 
 Event
@@ -113,18 +150,7 @@ runUniform(Context& context,
            Queue& queue,
            float a, float b,
            CLTensor<FloatType<kWidth>::T>& inOut) {
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::uniform_real_distribution<float> d(a, b);
-
-  HostTensor<float, 1> rand({inOut.numElements()});
-
-  for (size_t i = 0; i < rand.getSize(0); ++i) {
-    rand[i] = d(gen);
-  }
-
-  auto device = CLTensor<float>(context, queue, rand).view(inOut.sizes());
-  return runToPosit8(context, program, queue, device, inOut);
+  return runRandom(context, program, queue, false, a, b, inOut);
 }
 
 Event
@@ -133,18 +159,7 @@ runGaussian(Context& context,
             Queue& queue,
             float mean, float stddev,
             CLTensor<FloatType<kWidth>::T>& inOut) {
-  std::random_device rd;
-  std::mt19937 gen(rd());
-  std::normal_distribution<float> d(mean, stddev);
-
-  HostTensor<float, 1> rand({inOut.numElements()});
-
-  for (size_t i = 0; i < rand.getSize(0); ++i) {
-    rand[i] = d(gen);
-  }
-
-  auto device = CLTensor<float>(context, queue, rand).view(inOut.sizes());
-  return runToPosit8(context, program, queue, device, inOut);
+  return runRandom(context, program, queue, true, mean, stddev, inOut);
 }
 
 Event
@@ -186,18 +201,37 @@ runToFloat(Context& context,
                       out);
 }
 
-// out = AB
+namespace {
+
+OpType biasModeToDeviceOp(BiasMode mode) {
+  switch (mode) {
+    case BiasMode::None:
+      return kBiasNone;
+    case BiasMode::Row:
+      return kBiasRow;
+    case BiasMode::Col:
+      return kBiasCol;
+    default:
+      CL_ASSERT_MSG(false, "undefined bias mode");
+      return kBiasNone;
+  }
+}
+
+// out = AB (+ beta * out | + bias), optionally followed by ReLU
 Event
-runMM(Context& context,
-      Program& program,
-      Queue& queue,
-      const CLTensor<FloatType<kWidth>::T>& a,
-      const CLTensor<FloatType<kWidth>::T>& b,
-      bool beta,
-      RoundOp rounding,
-      int inScale,
-      int outScale,
-      CLTensor<FloatType<kWidth>::T>& c) {
+runBatchMM(Context& context,
+           Program& program,
+           Queue& queue,
+           const CLTensor<FloatType<kWidth>::T>& a,
+           const CLTensor<FloatType<kWidth>::T>& b,
+           bool beta,
+           const CLTensor<FloatType<kWidth>::T>* bias,
+           BiasMode biasMode,
+           bool relu,
+           RoundOp rounding,
+           int inScale,
+           int outScale,
+           CLTensor<FloatType<kWidth>::T>& c) {
   auto kerMM = program.getKernel("positBatchMM8_1");
 
   CL_ASSERT(c.dims() == 2 || c.dims() == 3);
@@ -230,7 +264,7 @@ runMM(Context& context,
     }
   }
 
-  // FIXME: handle transposed MM
+  // Strided (e.g., transposed) operands are made contiguous by our callers
   CL_ASSERT(a.isContiguous());
   CL_ASSERT(b.isContiguous());
   CL_ASSERT(c.isContiguous());
@@ -242,6 +276,15 @@ runMM(Context& context,
   unsigned int n = c.getSize(1 + cBatch);
   unsigned int k = a.getSize(1 + aBatch);
 
+  // The bias replaces the initial value of c
+  CL_ASSERT(!(beta && biasMode != BiasMode::None));
+
+  if (biasMode != BiasMode::None) {
+    CL_ASSERT(bias);
+    CL_ASSERT(bias->isContiguous());
+    CL_ASSERT(bias->numElements() == (biasMode == BiasMode::Row ? m : n));
+  }
+
   // std::cout << "MM size " << "(" << m << " x " << k << ")"
   //           << " x (" << k << " x " << n << ")\n";
 
@@ -261,32 +304,45 @@ runMM(Context& context,
                         (unsigned int) (bBatch ?
                                         b.getSize(1) * b.getSize(2) : 0),
                         (unsigned int) (cBatch ?
-                                        c.getSize(1) * c.getSize(2) : 0));
+                                        c.getSize(1) * c.getSize(2) : 0),
+                        // unused if there is no bias
+                        bias ? *bias : c,
+                        biasModeToDeviceOp(biasMode),
+                        toDeviceBool(relu));
 }
 
-// out = Ab
+// out = Ab (+ beta * out | + bias), optionally followed by ReLU, for one
+// vector b or a batch of vectors sharing a
 Event
-runMV(Context& context,
-      Program& program,
-      Queue& queue,
-      const CLTensor<FloatType<kWidth>::T>& a,
-      const CLTensor<FloatType<kWidth>::T>& b,
-      bool beta,
-      RoundOp rounding,
-      int inScale,
-      int outScale,
-      CLTensor<FloatType<kWidth>::T>& c) {
-  auto kerMM = program.getKernel("positBatchMM8_1");
+runBatchMV(Context& context,
+           Program& program,
+           Queue& queue,
+           const CLTensor<FloatType<kWidth>::T>& a,
+           const CLTensor<FloatType<kWidth>::T>& b,
+           bool beta,
+           const CLTensor<FloatType<kWidth>::T>* bias,
+           bool relu,
+           RoundOp rounding,
+           int inScale,
+           int outScale,
+           CLTensor<FloatType<kWidth>::T>& c) {
+  auto kerMV = program.getKernel("positBatchMV8_1");
 
-  // FIXME: implement batch
   CL_ASSERT(a.dims() == 2);
-  CL_ASSERT(b.dims() == 1);
-  CL_ASSERT(c.dims() == 1);
+  CL_ASSERT(b.dims() == 1 || b.dims() == 2);
+  CL_ASSERT(c.dims() == b.dims());
+
+  // If b is 2 dimensional, each row is a vector
+  int batch = b.dims() == 2;
 
-  CL_ASSERT(a.getSize(0) == c.getSize(0));
-  CL_ASSERT(a.getSize(1) == b.getSize(0));
+  CL_ASSERT(a.getSize(0) == c.getSize(0 + batch));
+  CL_ASSERT(a.getSize(1) == b.getSize(0 + batch));
+
+  if (batch) {
+    CL_ASSERT(b.getSize(0) == c.getSize(0));
+  }
 
-  // FIXME: handle transposed MM
+  // Strided (e.g., transposed) operands are made contiguous by our callers
   CL_ASSERT(a.isContiguous());
   CL_ASSERT(b.isContiguous());
   CL_ASSERT(c.isContiguous());
@@ -294,20 +350,114 @@ runMV(Context& context,
   CL_ASSERT(!c.isSameInstance(a));
   CL_ASSERT(!c.isSameInstance(b));
 
-  return kerMM.callTask(queue,
+  unsigned int m = a.getSize(0);
+  unsigned int k = a.getSize(1);
+
+  // The bias replaces the initial value of c
+  CL_ASSERT(!(beta && bias));
+
+  if (bias) {
+    CL_ASSERT(bias->isContiguous());
+    CL_ASSERT(bias->numElements() == m);
+  }
+
+  return kerMV.callTask(queue,
                         c, a, b,
                         toDeviceBool(beta),
                         (char) 0,
                         (char) inScale,
                         (char) outScale,
                         toDeviceBool(rounding == RoundOp::Stochastic),
-                        1, // batch size
-                        (unsigned int) c.getSize(0),
-                        (unsigned int) 1,
-                        (unsigned int) a.getSize(1),
-                        0,
-                        0,
-                        0);
+                        batch ? (unsigned int) b.getSize(0) : 1,
+                        m,
+                        k,
+                        k, // xBatchStride
+                        m, // cBatchStride
+                        // unused if there is no bias
+                        bias ? *bias : c,
+                        toDeviceBool(bias != nullptr),
+                        toDeviceBool(relu));
+}
+
+} // namespace
+
+// out = AB
+Event
+runMM(Context& context,
+      Program& program,
+      Queue& queue,
+      const CLTensor<FloatType<kWidth>::T>& a,
+      const CLTensor<FloatType<kWidth>::T>& b,
+      bool beta,
+      RoundOp rounding,
+      int inScale,
+      int outScale,
+      CLTensor<FloatType<kWidth>::T>& c) {
+  return runBatchMM(context, program, queue,
+                    toContiguous(context, program, queue, a),
+                    toContiguous(context, program, queue, b),
+                    beta, nullptr, BiasMode::None, false,
+                    rounding, inScale, outScale, c);
+}
+
+// out = AB + bias, optionally followed by ReLU
+Event
+runMMBias(Context& context,
+          Program& program,
+          Queue& queue,
+          const CLTensor<FloatType<kWidth>::T>& a,
+          const CLTensor<FloatType<kWidth>::T>& b,
+          const CLTensor<FloatType<kWidth>::T>* bias,
+          BiasMode biasMode,
+          bool relu,
+          RoundOp rounding,
+          int inScale,
+          int outScale,
+          CLTensor<FloatType<kWidth>::T>& c) {
+  return runBatchMM(context, program, queue,
+                    toContiguous(context, program, queue, a),
+                    toContiguous(context, program, queue, b),
+                    false, bias, bias ? biasMode : BiasMode::None, relu,
+                    rounding, inScale, outScale, c);
+}
+
+// out = Ab
+Event
+runMV(Context& context,
+      Program& program,
+      Queue& queue,
+      const CLTensor<FloatType<kWidth>::T>& a,
+      const CLTensor<FloatType<kWidth>::T>& b,
+      bool beta,
+      RoundOp rounding,
+      int inScale,
+      int outScale,
+      CLTensor<FloatType<kWidth>::T>& c) {
+  return runBatchMV(context, program, queue,
+                    toContiguous(context, program, queue, a),
+                    toContiguous(context, program, queue, b),
+                    beta, nullptr, false,
+                    rounding, inScale, outScale, c);
+}
+
+// out = Ab + bias, optionally followed by ReLU
+Event
+runMVBias(Context& context,
+          Program& program,
+          Queue& queue,
+          const CLTensor<FloatType<kWidth>::T>& a,
+          const CLTensor<FloatType<kWidth>::T>& b,
+          const CLTensor<FloatType<kWidth>::T>* bias,
+          bool relu,
+          RoundOp rounding,
+          int inScale,
+          int outScale,
+          CLTensor<FloatType<kWidth>::T>& c) {
+  return runBatchMV(context, program, queue,
+                    toContiguous(context, program, queue, a),
+                    toContiguous(context, program, queue, b),
+                    false, bias, relu,
+                    rounding, inScale, outScale, c);
 }
 
 // out = op(a, b)
@@ -341,6 +491,87 @@ runBinaryMath(Context& context,
                       0);
 }
 
+// out[i][j] = op(a[i][j], b[i])
+Event
+runBinaryMathPerRow(Context& context,
+                    Program& program,
+                    Queue& queue,
+                    const CLTensor<FloatType<kWidth>::T>& a,
+                    const CLTensor<FloatType<kWidth>::T>& b,
+                    MathOp mathOp,
+                    RoundOp rounding,
+                    CLTensor<FloatType<kWidth>::T>& out) {
+  auto ker = program.getKernel("positBinaryMath8_1");
+
+  CL_ASSERT(a.dims() == 2);
+  CL_ASSERT(a.isSameSize(out));
+  CL_ASSERT(b.numElements() == a.getSize(0));
+
+  CL_ASSERT(a.isContiguous());
+  CL_ASSERT(b.isContiguous());
+  CL_ASSERT(out.isContiguous());
+
+  unsigned int rows = a.getSize(0);
+  unsigned int cols = a.getSize(1);
+
+  // Each row is a batch; the device scalar b advances by one per batch
+  return ker.callTask(queue,
+                      a,
+                      cols,
+                      FloatType<kWidth>::kZero,
+                      kVectorOp,
+                      b,
+                      1,
+                      FloatType<kWidth>::kZero,
+                      kDeviceScalarOp,
+                      rows,
+                      cols,
+                      mathOpToDeviceOp(mathOp),
+                      toDeviceBool(rounding == RoundOp::Stochastic),
+                      out,
+                      cols);
+}
+
+Event
+runBinaryMathPerCol(Context& context,
+                    Program& program,
+                    Queue& queue,
+                    const CLTensor<FloatType<kWidth>::T>& a,
+                    const CLTensor<FloatType<kWidth>::T>& b,
+                    MathOp mathOp,
+                    RoundOp rounding,
+                    CLTensor<FloatType<kWidth>::T>& out) {
+  auto ker = program.getKernel("positBinaryMath8_1");
+
+  CL_ASSERT(a.dims() == 2);
+  CL_ASSERT(a.isSameSize(out));
+  CL_ASSERT(b.numElements() == a.getSize(1));
+
+  CL_ASSERT(a.isContiguous());
+  CL_ASSERT(b.isContiguous());
+  CL_ASSERT(out.isContiguous());
+
+  unsigned int rows = a.getSize(0);
+  unsigned int cols = a.getSize(1);
+
+  // Each row is a batch; the vector b does not advance between batches
+  return ker.callTask(queue,
+                      a,
+                      cols,
+                      FloatType<kWidth>::kZero,
+                      kVectorOp,
+                      b,
+                      0,
+                      FloatType<kWidth>::kZero,
+                      kVectorOp,
+                      rows,
+                      cols,
+                      mathOpToDeviceOp(mathOp),
+                      toDeviceBool(rounding == RoundOp::Stochastic),
+                      out,
+                      cols);
+}
+
 Event
 runReduce(Context& context,
           Program& program,
@@ -364,6 +595,142 @@ runReduce(Context& context,
                       out);
 }
 
+namespace {
+
+constexpr int kMaxReduceDims = 4;
+
+OpType reduceOpToDeviceOp(ReduceOp op) {
+  switch (op) {
+    case ReduceOp::Sum:
+      return kReduceSum;
+    case ReduceOp::Min:
+      return kReduceMin;
+    case ReduceOp::Max:
+      return kReduceMax;
+    case ReduceOp::ArgMin:
+      return kReduceArgMin;
+    case ReduceOp::ArgMax:
+      return kReduceArgMax;
+    case ReduceOp::SumSquares:
+      return kReduceSumSquares;
+    default:
+      CL_ASSERT_MSG(false, "undefined reduction");
+      return kReduceSum;
+  }
+}
+
+// Sizes and strides of the given dimensions, padded on the left with size 1
+void
+toDeviceShape(const std::vector<size_t>& sizes,
+              const std::vector<size_t>& strides,
+              cl_uint4& deviceSizes,
+              cl_uint4& deviceStrides) {
+  CL_ASSERT(sizes.size() <= kMaxReduceDims);
+  int pad = kMaxReduceDims - (int) sizes.size();
+
+  for (int i = 0; i < kMaxReduceDims; ++i) {
+    deviceSizes.s[i] = i < pad ? 1 : (cl_uint) sizes[i - pad];
+    deviceStrides.s[i] = i < pad ? 0 : (cl_uint) strides[i - pad];
+  }
+}
+
+}
+
+Event
+runReduceDim(Context& context,
+             Program& program,
+             Queue& queue,
+             const CLTensor<FloatType<kWidth>::T>& a,
+             const std::vector<int>& dims,
+             ReduceOp reduceOp,
+             RoundOp rounding,
+             CLTensor<FloatType<kWidth>::T>& out,
+             CLTensor<unsigned int>* index) {
+  auto ker = program.getKernel("positReduceDim8_1");
+
+  CL_ASSERT(a.dims() > 0 && a.dims() <= kMaxReduceDims);
+  CL_ASSERT(!dims.empty());
+  CL_ASSERT(out.isContiguous());
+
+  std::vector<bool> reduced(a.dims(), false);
+  for (auto d : dims) {
+    CL_ASSERT(d >= 0 && d < a.dims());
+    CL_ASSERT_MSG(!reduced[d], "dimension given twice");
+    reduced[d] = true;
+  }
+
+  std::vector<size_t> outSizes;
+  std::vector<size_t> outStrides;
+  std::vector<size_t> reduceSizes;
+  std::vector<size_t> reduceStrides;
+
+  for (int i = 0; i < a.dims(); ++i) {
+    auto& sizes = reduced[i] ? reduceSizes : outSizes;
+    auto& strides = reduced[i] ? reduceStrides : outStrides;
+
+    sizes.push_back(a.getSize(i));
+    strides.push_back(a.getStride(i));
+  }
+
+  size_t numOut = 1;
+  for (auto v : outSizes) {
+    numOut *= v;
+  }
+
+  size_t numReduce = 1;
+  for (auto v : reduceSizes) {
+    numReduce *= v;
+  }
+
+  CL_ASSERT(numReduce > 0);
+  CL_ASSERT(out.numElements() == numOut);
+
+  bool isArg = reduceOp == ReduceOp::ArgMin || reduceOp == ReduceOp::ArgMax;
+  CL_ASSERT_MSG(isArg == (index != nullptr),
+                "an index is given for and only for ArgMin / ArgMax");
+
+  if (index) {
+    CL_ASSERT(index->numElements() == numOut);
+    CL_ASSERT(index->isContiguous());
+  }
+
+  cl_uint4 outSize;
+  cl_uint4 outStride;
+  cl_uint4 reduceSize;
+  cl_uint4 reduceStride;
+
+  toDeviceShape(outSizes, outStrides, outSize, outStride);
+  toDeviceShape(reduceSizes, reduceStrides, reduceSize, reduceStride);
+
+  if (index) {
+    return ker.callTask(queue,
+                        a,
+                        outSize,
+                        outStride,
+                        reduceSize,
+                        reduceStride,
+                        (unsigned int) numOut,
+                        (unsigned int) numReduce,
+                        reduceOpToDeviceOp(reduceOp),
+                        toDeviceBool(rounding == RoundOp::Stochastic),
+                        out,
+                        *index);
+  }
+
+  return ker.callTask(queue,
+                      a,
+                      outSize,
+                      outStride,
+                      reduceSize,
+                      reduceStride,
+                      (unsigned int) numOut,
+                      (unsigned int) numReduce,
+                      reduceOpToDeviceOp(reduceOp),
+                      toDeviceBool(rounding == RoundOp::Stochastic),
+                      out,
+                      out); // index
+}
+
 Event
 runMulAdd(Context& context,
           Program& program,
@@ -376,7 +743,8 @@ runMulAdd(Context& context,
           bool subtract,
           RoundOp rounding,
           int scaleOut,
-          CLTensor<FloatType<kWidth>::T>& out) {
+          CLTensor<FloatType<kWidth>::T>& out,
+          bool relu) {
   auto ker = program.getKernel("positMulAdd8_1");
 
   if (c.t) {
@@ -420,10 +788,236 @@ runMulAdd(Context& context,
                       toDeviceBool(subtract),
                       toDeviceBool(rounding == RoundOp::Stochastic),
                       (char) scaleOut,
+                      toDeviceBool(relu),
                       (unsigned int) out.numElements(),
                       out);
 }
 
+Event
+runSGD(Context& context,
+       Program& program,
+       Queue& queue,
+       CLTensor<FloatType<kWidth>::T>& param,
+       const CLTensor<FloatType<kWidth>::T>& grad,
+       CLTensor<FloatType<kWidth>::T>* momentumBuf,
+       CLTensor<float>* wideMomentumBuf,
+       float lr,
+       float momentum,
+       RoundOp rounding) {
+  auto ker = program.getKernel("positSGD8_1");
+
+  CL_ASSERT(param.isSameSize(grad));
+  CL_ASSERT(param.isContiguous());
+  CL_ASSERT(grad.isContiguous());
+  CL_ASSERT_MSG(!(momentumBuf && wideMomentumBuf),
+                "only one momentum buffer may be given");
+
+  OpType momentumMode = kMomentumNone;
+
+  if (momentumBuf) {
+    CL_ASSERT(momentumBuf->isSameSize(param));
+    CL_ASSERT(momentumBuf->isContiguous());
+    momentumMode = kMomentumNarrow;
+  } else if (wideMomentumBuf) {
+    CL_ASSERT(wideMomentumBuf->numElements() == param.numElements());
+    CL_ASSERT(wideMomentumBuf->isContiguous());
+    momentumMode = kMomentumWide;
+  }
+
+  if (wideMomentumBuf) {
+    return ker.callTask(queue,
+                        param,
+                        grad,
+                        param, // momentumBuf
+                        *wideMomentumBuf,
+                        momentumMode,
+                        lr,
+                        momentum,
+                        toDeviceBool(rounding == RoundOp::Stochastic),
+                        (unsigned int) param.numElements());
+  }
+
+  return ker.callTask(queue,
+                      param,
+                      grad,
+                      // unused if there is no momentum
+                      momentumBuf ? *momentumBuf : param,
+                      param, // wideMomentumBuf
+                      momentumMode,
+                      lr,
+                      momentum,
+                      toDeviceBool(rounding == RoundOp::Stochastic),
+                      (unsigned int) param.numElements());
+}
+
+namespace {
+
+// exp, ln and 1/x of every encoding, in turn, as the device computes them,
+// for the table lookups of positLogSoftmax8_1
+CLTensor<FloatType<kWidth>::T>*
+makeFuncTable(Context& context, Program& program, Queue& queue) {
+  size_t num = (size_t) 1 << kWidth;
+
+  HostTensor<FloatType<kWidth>::T, 1> codes({num});
+  for (size_t i = 0; i < num; ++i) {
+    codes[i] = (FloatType<kWidth>::T) i;
+  }
+
+  CLTensor<FloatType<kWidth>::T> codesDev(context, queue, codes);
+  CLTensor<FloatType<kWidth>::T> expDev(context, {num});
+  CLTensor<FloatType<kWidth>::T> lnDev(context, {num});
+  CLTensor<FloatType<kWidth>::T> invDev(context, {num});
+
+  runExp(context, program, queue, codesDev, expDev);
+  runLn(context, program, queue, codesDev, lnDev);
+  runInv(context, program, queue, codesDev, invDev);
+
+  auto expHost = expDev.toHost<1>(queue);
+  auto lnHost = lnDev.toHost<1>(queue);
+  auto invHost = invDev.toHost<1>(queue);
+
+  HostTensor<FloatType<kWidth>::T, 1> funcs({3 * num});
+  auto funcsData = funcs.data();
+
+  for (size_t i = 0; i < num; ++i) {
+    funcsData[i] = expHost.data()[i];
+    funcsData[num + i] = lnHost.data()[i];
+    funcsData[2 * num + i] = invHost.data()[i];
+  }
+
+  return new CLTensor<FloatType<kWidth>::T>(context, queue, funcs);
+}
+
+// makeFuncTable(), built on first use for each program
+const CLTensor<FloatType<kWidth>::T>&
+getFuncTable(Context& context, Program& program, Queue& queue) {
+  return program.getCached<CLTensor<FloatType<kWidth>::T>>(
+    "LogSoftmaxFuncTable", [&]() {
+      return makeFuncTable(context, program, queue);
+    });
+}
+
+}
+
+Event
+runLogSoftmax(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              RoundOp rounding,
+              CLTensor<FloatType<kWidth>::T>& out,
+              const CLTensor<unsigned int>* target,
+              const CLTensor<FloatType<kWidth>::T>* weight,
+              bool sizeAverage,
+              CLTensor<FloatType<kWidth>::T>* loss,
+              CLTensor<FloatType<kWidth>::T>* gradInput) {
+  CL_ASSERT(in.dims() == 1 || in.dims() == 2);
+  CL_ASSERT(in.isSameSize(out));
+  CL_ASSERT(in.isContiguous());
+  CL_ASSERT(out.isContiguous());
+
+  auto rows = in.dims() == 1 ? (size_t) 1 : in.getSize(0);
+  auto cols = in.dims() == 1 ? in.getSize(0) : in.getSize(1);
+  CL_ASSERT(cols > 0);
+
+  if (target) {
+    CL_ASSERT(target->dims() == 1);
+    CL_ASSERT(target->getSize(0) == rows);
+    CL_ASSERT(target->isContiguous());
+
+    CL_ASSERT(loss);
+    CL_ASSERT(loss->dims() == 1);
+    CL_ASSERT(loss->getSize(0) == rows);
+    CL_ASSERT(loss->isContiguous());
+  } else {
+    CL_ASSERT_MSG(!weight && !loss && !gradInput,
+                  "the NLL loss needs a target");
+  }
+
+  if (weight) {
+    CL_ASSERT(weight->dims() == 1);
+    CL_ASSERT(weight->getSize(0) == cols);
+    CL_ASSERT(weight->isContiguous());
+  }
+
+  if (gradInput) {
+    CL_ASSERT(gradInput->isSameSize(in));
+    CL_ASSERT(gradInput->isContiguous());
+  }
+
+  auto& funcTable = getFuncTable(context, program, queue);
+  auto ker = program.getKernel("positLogSoftmax8_1");
+
+  if (target) {
+    return ker.callTask(queue,
+                        in,
+                        funcTable,
+                        *target,
+                        // unused if there is no weight
+                        weight ? *weight : out,
+                        toDeviceBool(true),
+                        toDeviceBool(weight != nullptr),
+                        toDeviceBool(sizeAverage),
+                        toDeviceBool(gradInput != nullptr),
+                        toDeviceBool(rounding == RoundOp::Stochastic),
+                        (unsigned int) rows,
+                        (unsigned int) cols,
+                        out,
+                        *loss,
+                        // unused if there is no gradInput
+                        gradInput ? *gradInput : out);
+  }
+
+  return ker.callTask(queue,
+                      in,
+                      funcTable,
+                      out, // target
+                      out, // weight
+                      toDeviceBool(false),
+                      toDeviceBool(false),
+                      toDeviceBool(false),
+                      toDeviceBool(false),
+                      toDeviceBool(rounding == RoundOp::Stochastic),
+                      (unsigned int) rows,
+                      (unsigned int) cols,
+                      out,
+                      out, // loss
+                      out); // gradInput
+}
+
+Event
+runTopK(Context& context,
+        Program& program,
+        Queue& queue,
+        const CLTensor<FloatType<kWidth>::T>& in,
+        size_t k,
+        CLTensor<FloatType<kWidth>::T>& values,
+        CLTensor<unsigned int>& indices) {
+  auto ker = program.getKernel("positTopK8_1");
+
+  CL_ASSERT(in.dims() == 1 || in.dims() == 2);
+  CL_ASSERT(in.isContiguous());
+
+  auto rows = in.dims() == 1 ? (size_t) 1 : in.getSize(0);
+  auto cols = in.dims() == 1 ? in.getSize(0) : in.getSize(1);
+
+  CL_ASSERT(k > 0 && k <= kMaxTopK);
+  CL_ASSERT_MSG(k <= cols, "k is larger than the row");
+
+  CL_ASSERT(values.numElements() == rows * k);
+  CL_ASSERT(indices.numElements() == rows * k);
+  CL_ASSERT(values.isContiguous());
+  CL_ASSERT(indices.isContiguous());
+
+  return ker.callTask(queue,
+                      in,
+                      (unsigned int) rows,
+                      (unsigned int) cols,
+                      (unsigned int) k,
+                      values,
+                      indices);
+}
+
 Event
 runThresholdScalarHost(Context& context,
                        Program& program,
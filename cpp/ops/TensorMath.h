@@ -18,6 +18,13 @@ enum class MathOp : unsigned char { Add, Sub, Mul, Div, Min, Max };
 
 enum class ScalarOp { Vector, Scalar };
 
+// How a bias vector is broadcast over the (m x n) output of a matrix multiply
+enum class BiasMode { None, Row, Col };
+
+// Reduction over a set of dimensions; the Arg ops also give the position of
+// the first extremum
+enum class ReduceOp { Sum, Min, Max, ArgMin, ArgMax, SumSquares };
+
 template <typename T>
 struct MathArg {
   inline MathArg(const CLTensor<T>& tensor, ScalarOp op = ScalarOp::Vector)
@@ -52,13 +59,19 @@ class Context;
 class Program;
 class Queue;
 
-// out = I_n
+// Largest k supported by runTopK
+constexpr size_t kMaxTopK = 16;
+
+// out = I_n; a non-square out has ones on its leading diagonal
 Event
 runEye(Context& context,
        Program& program,
        Queue& queue,
        CLTensor<FloatType<kWidth>::T>& inOut);
 
+// The random generators run on the device, from a Philox stream with a new
+// seed for every call
+
 // out = uniform(a, b)
 Event
 runUniform(Context& context,
@@ -94,6 +107,9 @@ runToFloat(Context& context,
            int expAdjust = 0);
 
 // C = beta * C + alpha * AB
+// A and B may be strided (e.g., transposed views), in which case they are
+// first copied to contiguous tensors; C must be contiguous. The same holds
+// for the other matrix products below.
 Event
 runMM(Context& context,
       Program& program,
@@ -106,7 +122,27 @@ runMM(Context& context,
       int outScale,
       CLTensor<FloatType<kWidth>::T>& c);
 
-// c = beta * c + alpha * Ab
+// c = ab + bias, where the bias is broadcast along the rows (size m) or
+// columns (size n) of each c matrix, optionally followed by ReLU. Both are
+// applied within the matrix multiply kernel.
+Event
+runMMBias(Context& context,
+          Program& program,
+          Queue& queue,
+          const CLTensor<FloatType<kWidth>::T>& a,
+          const CLTensor<FloatType<kWidth>::T>& b,
+          const CLTensor<FloatType<kWidth>::T>* bias,
+          BiasMode biasMode,
+          bool relu,
+          RoundOp rounding,
+          int inScale,
+          int outScale,
+          CLTensor<FloatType<kWidth>::T>& c);
+
+// c = beta * c + Ab
+// a is (m x k). Either b is (k) and c is (m), or b is a batch of vectors
+// (batch x k) sharing a, and c is (batch x m). Uses a dedicated GEMV kernel
+// rather than padding b to a matrix multiply tile.
 Event
 runMV(Context& context,
       Program& program,
@@ -119,6 +155,21 @@ runMV(Context& context,
       int outScale,
       CLTensor<FloatType<kWidth>::T>& c);
 
+// c = Ab + bias (size m, added to each output vector), optionally followed
+// by ReLU, with a, b and c as for runMV
+Event
+runMVBias(Context& context,
+          Program& program,
+          Queue& queue,
+          const CLTensor<FloatType<kWidth>::T>& a,
+          const CLTensor<FloatType<kWidth>::T>& b,
+          const CLTensor<FloatType<kWidth>::T>* bias,
+          bool relu,
+          RoundOp rounding,
+          int inScale,
+          int outScale,
+          CLTensor<FloatType<kWidth>::T>& c);
+
 // out = op(a, b)
 Event
 runBinaryMath(Context& context,
@@ -130,7 +181,31 @@ runBinaryMath(Context& context,
               RoundOp rounding,
               CLTensor<FloatType<kWidth>::T>& out);
 
-// sum or min/max reduction
+// out[i][j] = op(a[i][j], b[i]) for 2-d a and out and 1-d b, i.e., b is
+// a per-row scalar
+Event
+runBinaryMathPerRow(Context& context,
+                    Program& program,
+                    Queue& queue,
+                    const CLTensor<FloatType<kWidth>::T>& a,
+                    const CLTensor<FloatType<kWidth>::T>& b,
+                    MathOp mathOp,
+                    RoundOp rounding,
+                    CLTensor<FloatType<kWidth>::T>& out);
+
+// out[i][j] = op(a[i][j], b[j]) for 2-d a and out and 1-d b, i.e., b is
+// broadcast along the columns of every row
+Event
+runBinaryMathPerCol(Context& context,
+                    Program& program,
+                    Queue& queue,
+                    const CLTensor<FloatType<kWidth>::T>& a,
+                    const CLTensor<FloatType<kWidth>::T>& b,
+                    MathOp mathOp,
+                    RoundOp rounding,
+                    CLTensor<FloatType<kWidth>::T>& out);
+
+// Sum or min/max reduction of all of a to a single value
 Event
 runReduce(Context& context,
           Program& program,
@@ -140,6 +215,23 @@ runReduce(Context& context,
           RoundOp rounding,
           CLTensor<FloatType<kWidth>::T>& out);
 
+// Reduces a (at most 4-d, of any strides) over the dimensions `dims`, in one
+// launch. out is contiguous and holds the remaining dimensions in order
+// (reduced dimensions may be kept with size 1). Sums (and sums of squares)
+// are exact and rounded once. For ArgMin / ArgMax, `index` (of the size of
+// out) receives the row-major position within the reduced dimensions of the
+// first extremum, and out the extremum itself.
+Event
+runReduceDim(Context& context,
+             Program& program,
+             Queue& queue,
+             const CLTensor<FloatType<kWidth>::T>& a,
+             const std::vector<int>& dims,
+             ReduceOp reduceOp,
+             RoundOp rounding,
+             CLTensor<FloatType<kWidth>::T>& out,
+             CLTensor<unsigned int>* index = nullptr);
+
 // out = c (+|-) a * b
 Event
 runMulAdd(Context& context,
@@ -153,8 +245,61 @@ runMulAdd(Context& context,
           bool subtract,
           RoundOp rounding,
           int scaleOut,
-          CLTensor<FloatType<kWidth>::T>& out);
+          CLTensor<FloatType<kWidth>::T>& out,
+          // if set, max(out, 0) is written instead
+          bool relu = false);
+
+// One fused step of SGD with momentum:
+// v = momentum * v + grad
+// param = param - lr * v
+// with v kept in `momentumBuf`, in `wideMomentumBuf` (float, for more
+// precision), or not at all if both are null (param = param - lr * grad).
+// Each result is accumulated exactly and rounded once.
+Event
+runSGD(Context& context,
+       Program& program,
+       Queue& queue,
+       CLTensor<FloatType<kWidth>::T>& param,
+       const CLTensor<FloatType<kWidth>::T>& grad,
+       CLTensor<FloatType<kWidth>::T>* momentumBuf,
+       CLTensor<float>* wideMomentumBuf,
+       float lr,
+       float momentum,
+       RoundOp rounding);
 
+// Row-wise out = in - (max + ln(sum(exp(in - max)))) over in [rows][cols]
+// (or [cols]) in one launch, with the row max and sum found in a single
+// pass. If `target` is given ([rows] class indices), also writes the NLL loss
+// of each row to `loss` ([rows], as NLLLoss::forward) and, if `gradInput` is
+// given, the gradient of the loss with respect to `in`. `weight` optionally
+// weights each class; with sizeAverage the loss and gradient are divided by
+// the total weight of the targets.
+Event
+runLogSoftmax(Context& context,
+              Program& program,
+              Queue& queue,
+              const CLTensor<FloatType<kWidth>::T>& in,
+              RoundOp rounding,
+              CLTensor<FloatType<kWidth>::T>& out,
+              const CLTensor<unsigned int>* target = nullptr,
+              const CLTensor<FloatType<kWidth>::T>* weight = nullptr,
+              bool sizeAverage = true,
+              CLTensor<FloatType<kWidth>::T>* loss = nullptr,
+              CLTensor<FloatType<kWidth>::T>* gradInput = nullptr);
+
+// The k largest values of each row of in ([rows][cols] or [cols]), in
+// decreasing order, and their column indices, to values and indices
+// ([rows][k] or [k]); ties keep the lower index. Values are only compared, so
+// the result only depends on the ordering of the encoding. k <= kMaxTopK,
+// and k == 1 gives argmax.
+Event
+runTopK(Context& context,
+        Program& program,
+        Queue& queue,
+        const CLTensor<FloatType<kWidth>::T>& in,
+        size_t k,
+        CLTensor<FloatType<kWidth>::T>& values,
+        CLTensor<unsigned int>& indices);
 
 // out = a op b ? sel : 0
 Event
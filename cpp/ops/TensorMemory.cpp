@@ -4,10 +4,89 @@
 // This source code is licensed under the license found in the
 // LICENSE file in the root directory of this source tree.
 #include "ops/TensorMemory.h"
+
+#include <algorithm>
+#include <numeric>
 #include "utils/MathUtils.h"
 
 namespace facebook { namespace cl {
 
+namespace {
+
+constexpr int kMaxCopyDims = 4;
+
+// Must match kTileSize in Memory.cl
+constexpr size_t kCopyTileSize = 32;
+
+constexpr size_t kCopyGroupSize = 256;
+
+// A copy between two strided layouts of the same sizes
+struct CopyShape {
+  std::vector<size_t> sizes;
+  std::vector<size_t> inStrides;
+  std::vector<size_t> outStrides;
+};
+
+// Orders the dimensions of the copy by decreasing output stride, drops those
+// of size 1 and merges adjacent dimensions that are nested in both `in` and
+// `out`
+CopyShape
+collapseCopyShape(const CLTensor<FloatType<kWidth>::T>& in,
+                  const CLTensor<FloatType<kWidth>::T>& out) {
+  std::vector<int> order(in.dims());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&out](int a, int b) {
+                     return out.getStride(a) > out.getStride(b);
+                   });
+
+  CopyShape shape;
+
+  for (auto d : order) {
+    size_t size = in.getSize(d);
+    if (size == 1) {
+      continue;
+    }
+
+    if (!shape.sizes.empty() &&
+        shape.inStrides.back() == in.getStride(d) * size &&
+        shape.outStrides.back() == out.getStride(d) * size) {
+      shape.sizes.back() *= size;
+      shape.inStrides.back() = in.getStride(d);
+      shape.outStrides.back() = out.getStride(d);
+    } else {
+      shape.sizes.push_back(size);
+      shape.inStrides.push_back(in.getStride(d));
+      shape.outStrides.push_back(out.getStride(d));
+    }
+  }
+
+  if (shape.sizes.empty()) {
+    shape.sizes.push_back(1);
+    shape.inStrides.push_back(1);
+    shape.outStrides.push_back(1);
+  }
+
+  return shape;
+}
+
+// Sizes and strides of the copy, padded on the left with size 1
+void
+toDeviceCopyShape(const CopyShape& shape,
+                  cl_uint4& size,
+                  cl_uint4& inStride,
+                  cl_uint4& outStride) {
+  int pad = kMaxCopyDims - (int) shape.sizes.size();
+
+  for (int i = 0; i < kMaxCopyDims; ++i) {
+    size.s[i] = i < pad ? 1 : (cl_uint) shape.sizes[i - pad];
+    inStride.s[i] = i < pad ? 0 : (cl_uint) shape.inStrides[i - pad];
+    outStride.s[i] = i < pad ? 0 : (cl_uint) shape.outStrides[i - pad];
+  }
+}
+
+}
+
 Event
 runMemset(Context& context,
           Program& program,
@@ -16,13 +95,17 @@ runMemset(Context& context,
           CLTensor<FloatType<kWidth>::T>& inOut) {
   auto ker = program.getKernel("mem_8");
 
+  // mem_8 takes offsets, so views need not be aligned
+  CL_ASSERT(inOut.isContiguous());
+  auto& mem = inOut.getDeviceMem();
+
   return ker.callTask(queue,
-                      inOut, // dummy
+                      baseMem(mem), // dummy
                       (unsigned int) 0,
                       v,
                       kHostScalarOp,
-                      inOut, // dst
-                      (unsigned int) 0,
+                      baseMem(mem), // dst
+                      (unsigned int) mem.getOffset(),
                       1,
                       (unsigned int) inOut.numElements(),
                       0,
@@ -41,13 +124,16 @@ runMemcpy(Context& context,
           CLTensor<FloatType<kWidth>::T>& dst) {
   auto ker = program.getKernel("mem_8");
 
+  CL_ASSERT(src.isContiguous());
+  CL_ASSERT(dst.isContiguous());
+
   return ker.callTask(queue,
-                      src,
-                      (unsigned int) 0,
+                      baseMem(src.getDeviceMem()),
+                      (unsigned int) src.getDeviceMem().getOffset(),
                       (FloatType<kWidth>::T) 0,
                       kVectorOp,
-                      dst, // dst
-                      (unsigned int) 0,
+                      baseMem(dst.getDeviceMem()), // dst
+                      (unsigned int) dst.getDeviceMem().getOffset(),
                       numBatches,
                       batchSize,
                       srcBatchStride,
@@ -68,13 +154,18 @@ runBroadcast(Context& context,
              unsigned int numBatches) {
   auto ker = program.getKernel("mem_8");
 
+  CL_ASSERT(src.isContiguous());
+  CL_ASSERT(dst.isContiguous());
+
   return ker.callTask(queue,
-                      src, // dummy
-                      srcOffset,
+                      baseMem(src.getDeviceMem()),
+                      (unsigned int) (src.getDeviceMem().getOffset() +
+                                      srcOffset),
                       (FloatType<kWidth>::T) 0,
                       kDeviceScalarOp,
-                      dst, // dst
-                      dstOffset,
+                      baseMem(dst.getDeviceMem()), // dst
+                      (unsigned int) (dst.getDeviceMem().getOffset() +
+                                      dstOffset),
                       numBatches,
                       numBroadcast,
                       srcBatchStride,
@@ -174,26 +265,146 @@ runTranspose(Context& context,
              CLTensor<FloatType<kWidth>::T>& out) {
   auto kerTr = program.getKernel("transpose2d_8");
 
-  CL_ASSERT(in.dims() == 2);
-  CL_ASSERT(out.dims() == 2);
-  CL_ASSERT(in.getSize(0) == out.getSize(1));
-  CL_ASSERT(in.getSize(1) == out.getSize(0));
-  CL_ASSERT(in.isContiguous());
-  CL_ASSERT(out.isContiguous());
+  CL_ASSERT(in.dims() == 2 || in.dims() == 3);
+  CL_ASSERT(out.dims() == in.dims());
+
+  // A 3-d tensor is a batch of matrices, each transposed
+  size_t batch = in.dims() == 3 ? in.getSize(0) : 1;
+  size_t m = in.getSize(in.dims() - 2);
+  size_t n = in.getSize(in.dims() - 1);
+
+  if (in.dims() == 3) {
+    CL_ASSERT(out.getSize(0) == batch);
+  }
+
+  CL_ASSERT(out.getSize(out.dims() - 2) == n);
+  CL_ASSERT(out.getSize(out.dims() - 1) == m);
   CL_ASSERT(!in.isSameInstance(out));
 
-  // FIXME: for transpose, we must be innermost contiguous, but we can be outer
-  // non-contiguous
+  if (!in.isContiguous() || !out.isContiguous()) {
+    return runCopy(context, program, queue,
+                   in.transpose(in.dims() - 2, in.dims() - 1), out);
+  }
+
   constexpr size_t kTileSize = 32;
-  auto gy = roundUp(in.getSize(0), kTileSize);
-  auto gx = roundUp(in.getSize(1), kTileSize);
+  auto gy = roundUp(m, kTileSize);
+  auto gx = roundUp(n, kTileSize);
 
   return kerTr.call(queue,
-                    Array3(gx, gy),
+                    Array3(gx, gy, batch),
                     Array3(kTileSize, kTileSize),
                     in, out,
-                    (unsigned int) in.getSize(0),
-                    (unsigned int) in.getSize(1), 0);
+                    (unsigned int) m,
+                    (unsigned int) n, 0);
+}
+
+Event
+runCopy(Context& context,
+        Program& program,
+        Queue& queue,
+        const CLTensor<FloatType<kWidth>::T>& in,
+        CLTensor<FloatType<kWidth>::T>& out) {
+  CL_ASSERT(in.isSameSize(out));
+  CL_ASSERT(!in.isSameInstance(out));
+
+  if (in.isContiguous() && out.isContiguous()) {
+    return out.copyFrom(queue, in);
+  }
+
+  auto shape = collapseCopyShape(in, out);
+  CL_ASSERT_MSG(shape.sizes.size() <= kMaxCopyDims,
+                "copy has too many non-mergeable dimensions");
+
+  // After collapsing, the innermost output dimension is last; find the
+  // innermost input dimension
+  int outInner = (int) shape.sizes.size() - 1;
+  int inInner = (int) (std::min_element(shape.inStrides.begin(),
+                                        shape.inStrides.end()) -
+                       shape.inStrides.begin());
+
+  // The kernels do their own addressing, so are passed the base buffer and
+  // offset of each tensor; views need not be aligned
+  if (inInner == outInner || shape.inStrides[inInner] == 0) {
+    cl_uint4 size;
+    cl_uint4 inStride;
+    cl_uint4 outStride;
+    toDeviceCopyShape(shape, size, inStride, outStride);
+
+    auto ker = program.getKernel("copyStrided_8");
+
+    return ker.call(queue,
+                    Array3(roundUp(in.numElements(), kCopyGroupSize)),
+                    Array3(kCopyGroupSize),
+                    baseMem(in.getDeviceMem()),
+                    (unsigned int) in.getDeviceMem().getOffset(),
+                    baseMem(out.getDeviceMem()),
+                    (unsigned int) out.getDeviceMem().getOffset(),
+                    size,
+                    inStride,
+                    outStride,
+                    (unsigned int) in.numElements());
+  }
+
+  // Tile the innermost dimensions of the input and output against each other
+  CopyShape tiled;
+  for (int i = 0; i < (int) shape.sizes.size(); ++i) {
+    if (i != inInner && i != outInner) {
+      tiled.sizes.push_back(shape.sizes[i]);
+      tiled.inStrides.push_back(shape.inStrides[i]);
+      tiled.outStrides.push_back(shape.outStrides[i]);
+    }
+  }
+
+  for (auto i : {inInner, outInner}) {
+    tiled.sizes.push_back(shape.sizes[i]);
+    tiled.inStrides.push_back(shape.inStrides[i]);
+    tiled.outStrides.push_back(shape.outStrides[i]);
+  }
+
+  cl_uint4 size;
+  cl_uint4 inStride;
+  cl_uint4 outStride;
+  toDeviceCopyShape(tiled, size, inStride, outStride);
+
+  auto ker = program.getKernel("copyStridedTiled_8");
+
+  return ker.call(queue,
+                  Array3(roundUp((size_t) size.s[2], kCopyTileSize),
+                         roundUp((size_t) size.s[3], kCopyTileSize),
+                         (size_t) size.s[0] * size.s[1]),
+                  Array3(kCopyTileSize, kCopyTileSize),
+                  baseMem(in.getDeviceMem()),
+                  (unsigned int) in.getDeviceMem().getOffset(),
+                  baseMem(out.getDeviceMem()),
+                  (unsigned int) out.getDeviceMem().getOffset(),
+                  size,
+                  inStride,
+                  outStride);
+}
+
+Event
+runPermute(Context& context,
+           Program& program,
+           Queue& queue,
+           const CLTensor<FloatType<kWidth>::T>& in,
+           const std::vector<int>& dims,
+           CLTensor<FloatType<kWidth>::T>& out) {
+  return runCopy(context, program, queue, in.permute(dims), out);
+}
+
+CLTensor<FloatType<kWidth>::T>
+toContiguous(Context& context,
+             Program& program,
+             Queue& queue,
+             const CLTensor<FloatType<kWidth>::T>& t) {
+  if (t.isContiguous() && t.getDeviceMem().isAligned()) {
+    return t;
+  }
+
+  CLTensor<FloatType<kWidth>::T> out(context, t.sizes());
+  runCopy(context, program, queue, t, out);
+
+  return out;
 }
 
 } } // namespace
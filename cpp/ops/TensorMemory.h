@@ -5,6 +5,7 @@
 // LICENSE file in the root directory of this source tree.
 #pragma once
 
+#include <vector>
 #include "FloatDefs.h"
 #include "utils/Event.h"
 #include "utils/Tensor.h"
@@ -73,7 +74,8 @@ runScatter(Context& context,
            FloatType<kWidth>::T invalid,
            CLTensor<FloatType<kWidth>::T>& dst);
 
-// out = in^t
+// out = in^t, or for 3-d tensors, out[b] = in[b]^t for each b.
+// Either may be non-contiguous.
 Event
 runTranspose(Context& context,
              Program& program,
@@ -81,16 +83,35 @@ runTranspose(Context& context,
              const CLTensor<FloatType<kWidth>::T>& in,
              CLTensor<FloatType<kWidth>::T>& out);
 
-// Input is [channel][height][width]
+// out = in, for tensors of the same size with arbitrary strides (`out` must
+// not overlap itself or `in`). Dimensions nested alike in both are merged,
+// and at most 4 may remain. The copy is a single pass; if the innermost
+// dimensions differ it is tiled through local memory, so that both the reads
+// and the writes are contiguous.
 Event
-runIm2Col(Context& context,
-          Program& program,
-          Queue& queue,
-          const CLTensor<FloatType<kWidth>::T>& in,
-          unsigned int kH, unsigned int kW,
-          unsigned int padT, unsigned int padB,
-          unsigned int padL, unsigned int padR,
-          unsigned int strideH, unsigned int strideW,
-          CLTensor<FloatType<kWidth>::T>& out);
+runCopy(Context& context,
+        Program& program,
+        Queue& queue,
+        const CLTensor<FloatType<kWidth>::T>& in,
+        CLTensor<FloatType<kWidth>::T>& out);
+
+// out = in.permute(dims), e.g., dims (0, 2, 3, 1) for NCHW -> NHWC
+Event
+runPermute(Context& context,
+           Program& program,
+           Queue& queue,
+           const CLTensor<FloatType<kWidth>::T>& in,
+           const std::vector<int>& dims,
+           CLTensor<FloatType<kWidth>::T>& out);
+
+// Returns `t` if it is contiguous, otherwise a contiguous copy of it, for ops
+// that require contiguous inputs. Views whose offset does not meet the device
+// alignment for a sub-buffer are also copied, so that the result can be
+// passed to any kernel.
+CLTensor<FloatType<kWidth>::T>
+toContiguous(Context& context,
+             Program& program,
+             Queue& queue,
+             const CLTensor<FloatType<kWidth>::T>& t);
 
 } }
@@ -590,6 +590,17 @@ struct PassArg<CLDimTensor<T, Dim, InnerContig>> {
   }
 };
 
+template <typename T, int Dim, bool InnerContig>
+struct KernelArgInfo<CLDimTensor<T, Dim, InnerContig>> {
+  static size_t bytes(const CLDimTensor<T, Dim, InnerContig>& arg) {
+    return arg.numElements() * sizeof(T);
+  }
+
+  static size_t memBytes(const CLDimTensor<T, Dim, InnerContig>& arg) {
+    return bytes(arg);
+  }
+};
+
 } } // namespace
 
 #include "utils/CLDimTensor-inl.h"
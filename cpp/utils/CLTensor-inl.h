@@ -254,7 +254,10 @@ template <typename IndexT>
 T
 CLTensor<T>::get(facebook::cl::Queue& queue,
                  std::initializer_list<IndexT> at) {
-  return getDeviceMem().copyD2HScalar(queue, offset(at));
+  T v;
+  getDeviceMem().copyD2H(queue, &v, 1, offset(at));
+
+  return v;
 }
 
 template <typename T>
@@ -263,7 +266,7 @@ void
 CLTensor<T>::set(T v,
                  facebook::cl::Queue& queue,
                  std::initializer_list<IndexT> at) {
-  getDeviceMem().copyH2DScalar(queue, v, offset(at));
+  getDeviceMem().copyH2D(queue, &v, 1, offset(at));
 }
 
 template <typename T>
@@ -410,6 +413,7 @@ CLTensor<T>::offset(std::initializer_list<IndexT> at) const {
 
   int i = 0;
   for (auto s : at) {
+    CL_ASSERT((size_t) s < size_[i]);
     offset += (size_t) s * stride_[i++];
   }
 
@@ -494,6 +498,27 @@ CLTensor<T>::transpose(int dim1, int dim2) const {
   return CLTensor<T>(data_, newSize, newStride);
 }
 
+template <typename T>
+CLTensor<T>
+CLTensor<T>::permute(const std::vector<int>& dims) const {
+  CL_ASSERT(dims.size() == dim_);
+
+  std::vector<bool> seen(dim_, false);
+  std::vector<size_t> newSize(dim_);
+  std::vector<size_t> newStride(dim_);
+
+  for (int i = 0; i < dim_; ++i) {
+    CL_ASSERT(dims[i] >= 0 && dims[i] < dim_);
+    CL_ASSERT(!seen[dims[i]]);
+    seen[dims[i]] = true;
+
+    newSize[i] = size_[dims[i]];
+    newStride[i] = stride_[dims[i]];
+  }
+
+  return CLTensor<T>(data_, newSize, newStride);
+}
+
 template <typename T>
 CLTensor<T>
 CLTensor<T>::upcastOuter(int newDim) const {
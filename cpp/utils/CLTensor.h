@@ -81,7 +81,8 @@ class CLTensor {
   template <int Dim, bool InnerContig = true>
   HostTensor<T, Dim, InnerContig> toHost(facebook::cl::Queue& queue) const;
 
-  /// Read a value from the device
+  /// Read a value from the device. This is a blocking transfer; see
+  /// ScalarBatch for batches of element accesses
   template <typename IndexT>
   T get(facebook::cl::Queue& queue,
         std::initializer_list<IndexT> at);
@@ -210,6 +211,11 @@ class CLTensor {
   /// If the dimensions are not valid, asserts.
   CLTensor<T> transpose(int dim1, int dim2) const;
 
+  /// Returns a tensor whose dimension i is our dimension `dims[i]`. As
+  /// with `transpose`, only the size/stride arrays are permuted.
+  /// `dims` must be a permutation of [0, dims()).
+  CLTensor<T> permute(const std::vector<int>& dims) const;
+
   /// Upcast a tensor of dimension `D` to some tensor of dimension
   /// D' > D by padding the leading dimensions by 1
   /// e.g., upcasting a 2-d tensor `[2][3]` to a 4-d tensor `[1][1][2][3]`
@@ -276,6 +282,17 @@ struct PassArg<CLTensor<T>> {
   }
 };
 
+template <typename T>
+struct KernelArgInfo<CLTensor<T>> {
+  static size_t bytes(const CLTensor<T>& arg) {
+    return arg.getSizeInBytes();
+  }
+
+  static size_t memBytes(const CLTensor<T>& arg) {
+    return bytes(arg);
+  }
+};
+
 } } // namespace
 
 #include "utils/CLTensor-inl.h"
@@ -42,7 +42,8 @@ Context::Context(cl_device_id device,
                                               CL_DEVICE_SVM_CAPABILITIES);
   svm_ = (svmCaps & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER) != 0;
 
-  align_ = getDeviceInfo<cl_uint>(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN);
+  // Reported in bits
+  align_ = getDeviceInfo<cl_uint>(device, CL_DEVICE_MEM_BASE_ADDR_ALIGN) / 8;
 
   defaultQueue_ = makeQueue();
 }
@@ -50,7 +51,8 @@ Context::Context(cl_device_id device,
 Context::Context(Context&& e) :
     device_(0),
     context_(0),
-    svm_(false) {
+    svm_(false),
+    align_(0) {
   operator=(std::move(e));
 }
 
@@ -64,15 +66,33 @@ Context::operator=(Context&& e) {
   device_ = std::move(e.device_);
   context_ = std::move(e.context_);
   svm_ = std::move(e.svm_);
+  align_ = std::move(e.align_);
   defaultQueue_ = std::move(e.defaultQueue_);
 
   e.device_ = 0;
   e.context_ = 0;
   e.svm_ = false;
+  e.align_ = 0;
 
   return *this;
 }
 
+std::string
+Context::getDeviceName() const {
+  size_t size = 0;
+  CHECK_CL(clGetDeviceInfo(device_, CL_DEVICE_NAME, 0, nullptr, &size));
+
+  std::string name(size, 0);
+  CHECK_CL(clGetDeviceInfo(device_, CL_DEVICE_NAME, size, &name[0], nullptr));
+
+  // Drop the terminating null
+  while (!name.empty() && name.back() == 0) {
+    name.pop_back();
+  }
+
+  return name;
+}
+
 Program
 Context::makeBinaryProgram(const std::string& binaryFile) {
   auto fp = fopen(binaryFile.c_str(), "rb");
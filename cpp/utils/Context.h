@@ -52,7 +52,7 @@ class Context {
                                 &err);
     CHECK_CL(err);
 
-    return DeviceMem<T>(context_, mem, num);
+    return DeviceMem<T>(context_, mem, num, align_);
   }
 
   void release();
@@ -69,6 +69,9 @@ class Context {
     return align_;
   }
 
+  /// Returns the name reported by our device
+  std::string getDeviceName() const;
+
  protected:
   cl_device_id device_;
   cl_context context_;
@@ -78,7 +81,8 @@ class Context {
   /// Do we support CL 2.0 SVM?
   bool svm_;
 
-  /// Alignment size in bytes of an allocation
+  /// Alignment size in bytes of an allocation, and of the origin of any
+  /// sub-buffer
   cl_uint align_;
 };
 
@@ -9,6 +9,7 @@
 #include "CL/opencl.h"
 #include "utils/Event.h"
 #include "utils/OpenCLUtils.h"
+#include "utils/Profiler.h"
 #include "utils/Queue.h"
 
 namespace facebook { namespace cl { namespace utils {
@@ -27,6 +28,10 @@ Event copyH2D(facebook::cl::Queue& queue,
                                 src,
                                 0, nullptr, &evt));
 
+  if (Profiler::isEnabled()) {
+    Profiler::get().recordCopy(queue, "copyH2D", evt, num * sizeof(T));
+  }
+
   return Event(evt);
 }
 
@@ -44,6 +49,53 @@ Event copyD2H(facebook::cl::Queue& queue,
                                dst,
                                0, nullptr, &evt));
 
+  if (Profiler::isEnabled()) {
+    Profiler::get().recordCopy(queue, "copyD2H", evt, num * sizeof(T));
+  }
+
+  return Event(evt);
+}
+
+// non-blocking copy; `src` must remain valid until the returned event has
+// completed
+template <typename T>
+Event copyH2DAsync(facebook::cl::Queue& queue,
+                   cl_mem dst,
+                   const T* src,
+                   size_t num,
+                   size_t offsetDst) {
+  cl_event evt = 0;
+  CHECK_CL(clEnqueueWriteBuffer(queue, dst, CL_FALSE,
+                                offsetDst * sizeof(T),
+                                num * sizeof(T),
+                                src,
+                                0, nullptr, &evt));
+
+  if (Profiler::isEnabled()) {
+    Profiler::get().recordCopy(queue, "copyH2D", evt, num * sizeof(T));
+  }
+
+  return Event(evt);
+}
+
+// non-blocking copy; `dst` is valid once the returned event has completed
+template <typename T>
+Event copyD2HAsync(facebook::cl::Queue& queue,
+                   cl_mem src,
+                   T* dst,
+                   size_t num,
+                   size_t offsetSrc) {
+  cl_event evt = 0;
+  CHECK_CL(clEnqueueReadBuffer(queue, src, CL_FALSE,
+                               offsetSrc * sizeof(T),
+                               num * sizeof(T),
+                               dst,
+                               0, nullptr, &evt));
+
+  if (Profiler::isEnabled()) {
+    Profiler::get().recordCopy(queue, "copyD2H", evt, num * sizeof(T));
+  }
+
   return Event(evt);
 }
 
@@ -61,6 +113,10 @@ Event copyD2D(facebook::cl::Queue& queue,
                                size * sizeof(T),
                                0, nullptr, &evt));
 
+  if (Profiler::isEnabled()) {
+    Profiler::get().recordCopy(queue, "copyD2D", evt, size * sizeof(T));
+  }
+
   return Event(evt);
 }
 
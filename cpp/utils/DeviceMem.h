@@ -13,21 +13,32 @@
 
 namespace facebook { namespace cl {
 
+/// A region of a device buffer: `size` elements beginning `offset` elements
+/// into the buffer. Regions are views that share (and reference count) the
+/// buffer, so slicing with `at` is free. Kernels that take an explicit offset
+/// are passed `baseMem(mem)` and `getOffset()`; other kernels are passed the
+/// region itself (`get()`), which is only possible if the region start meets
+/// the device's base address alignment (CL_DEVICE_MEM_BASE_ADDR_ALIGN).
 template <typename T>
 class DeviceMem {
  public:
   DeviceMem()
       : context_(0),
         mem_(0),
-        size_(0) {
+        offset_(0),
+        size_(0),
+        align_(0),
+        subMem_(0) {
   }
 
+  /// Takes ownership of `mem`. `align` is the base address alignment in
+  /// bytes of sub-buffers, or 0 if unknown, in which case sub-buffer
+  /// creation is left to the runtime to validate.
   DeviceMem(cl_context context,
             cl_mem mem,
-            size_t size)
-      : context_(context),
-        mem_(mem),
-        size_(size) {
+            size_t size,
+            size_t align = 0)
+      : DeviceMem(context, mem, 0, size, align) {
   }
 
   DeviceMem(const DeviceMem& m) = delete;
@@ -36,32 +47,46 @@ class DeviceMem {
   DeviceMem(DeviceMem&& m)
       : context_(std::move(m.context_)),
         mem_(std::move(m.mem_)),
-        size_(std::move(m.size_)) {
+        offset_(std::move(m.offset_)),
+        size_(std::move(m.size_)),
+        align_(std::move(m.align_)),
+        subMem_(std::move(m.subMem_)) {
     m.context_ = 0;
     m.mem_ = 0;
+    m.offset_ = 0;
     m.size_ = 0;
+    m.align_ = 0;
+    m.subMem_ = 0;
   }
 
   DeviceMem& operator=(DeviceMem& m) = delete;
 
   DeviceMem& operator=(DeviceMem&& m) {
+    release();
+
     context_ = std::move(m.context_);
     m.context_ = 0;
 
     mem_ = std::move(m.mem_);
     m.mem_ = 0;
 
+    offset_ = std::move(m.offset_);
+    m.offset_ = 0;
+
     size_ = std::move(m.size_);
     m.size_ = 0;
 
+    align_ = std::move(m.align_);
+    m.align_ = 0;
+
+    subMem_ = std::move(m.subMem_);
+    m.subMem_ = 0;
+
     return *this;
   }
 
   ~DeviceMem() {
-    if (mem_) {
-      CHECK_CL(clReleaseMemObject(mem_));
-      mem_ = 0;
-    }
+    release();
   }
 
   DeviceMem<T> copy(facebook::cl::Queue& queue) {
@@ -72,9 +97,9 @@ class DeviceMem {
                                 nullptr,
                                 &status);
     CHECK_CL(status);
-    utils::copyD2D<T>(queue, mem_, mem, 0, 0, size_);
+    utils::copyD2D<T>(queue, mem_, mem, offset_, 0, size_);
 
-    return DeviceMem<T>(context_, mem, size_);
+    return DeviceMem<T>(context_, mem, size_, align_);
   }
 
  public:
@@ -82,7 +107,8 @@ class DeviceMem {
   bool isSame(const DeviceMem<U>& m) const {
     return (context_ == m.context_ &&
             mem_ == m.mem_ &&
-            size_ == m.size_);
+            offset_ * sizeof(T) == m.offset_ * sizeof(U) &&
+            size_ * sizeof(T) == m.size_ * sizeof(U));
   }
 
   template <typename U>
@@ -90,45 +116,86 @@ class DeviceMem {
     CL_ASSERT(sizeof(U) == sizeof(T) ||
               (sizeof(U) < sizeof(T) && (sizeof(T) % sizeof(U) == 0)) ||
               (sizeof(U) > sizeof(T) && (sizeof(U) % sizeof(T) == 0)));
+    CL_ASSERT((offset_ * sizeof(T)) % sizeof(U) == 0);
+
+    if (mem_) {
+      CHECK_CL(clRetainMemObject(mem_));
+    }
 
-    CHECK_CL(clRetainMemObject(mem_));
-    return DeviceMem<U>(context_, mem_, (size_ * sizeof(T)) / sizeof(U));
+    return DeviceMem<U>(context_, mem_,
+                        (offset_ * sizeof(T)) / sizeof(U),
+                        (size_ * sizeof(T)) / sizeof(U),
+                        align_);
   }
 
   cl_context getContext() {
     return context_;
   }
 
+  /// Returns a buffer beginning at our region. If we are offset, this is a
+  /// sub-buffer, created on first use and kept for our lifetime; the region
+  /// must then be aligned (see `isAligned`).
   cl_mem get() const {
+    if (offset_ == 0) {
+      return mem_;
+    }
+
+    if (!subMem_) {
+      CL_ASSERT_MSG(isAligned(),
+                    "region is not aligned for a sub-buffer; pass the "
+                    "base buffer and offset, or copy it");
+
+      cl_buffer_region region;
+      region.origin = offset_ * sizeof(T); // offset in bytes
+      region.size = size_ * sizeof(T); // size in bytes
+
+      cl_int err = 0;
+      subMem_ = clCreateSubBuffer(mem_,
+                                  CL_MEM_READ_WRITE,
+                                  CL_BUFFER_CREATE_TYPE_REGION,
+                                  &region,
+                                  &err);
+      CHECK_CL(err);
+    }
+
+    return subMem_;
+  }
+
+  /// The whole buffer that our region is within
+  cl_mem getBase() const {
     return mem_;
   }
 
+  /// Offset in elements of our region within `getBase()`
+  size_t getOffset() const {
+    return offset_;
+  }
+
   size_t size() const {
     return size_;
   }
 
-  /// Creates a sub-region of the buffer beginning at offset containing `size`
+  /// Whether `get()` can return a buffer for our region
+  bool isAligned() const {
+    return offset_ == 0 || align_ == 0 ||
+      (offset_ * sizeof(T)) % align_ == 0;
+  }
+
+  /// Returns a view of the region beginning at offset containing `size`
   /// elements. If `size` is not provided, the region will contain the remainder
-  /// of the allocation.
+  /// of the allocation. No OpenCL object is created.
   DeviceMem<T> at(size_t offset,
                   size_t size = std::numeric_limits<size_t>::max()) const {
-    // FIXME: assert region sizes
+    CL_ASSERT(offset <= size_);
     size = size == std::numeric_limits<size_t>::max() ?
       (size_ - offset) : size;
+    CL_ASSERT(size <= size_ - offset);
 
-    cl_buffer_region region;
-    region.origin = offset;
-    region.size = size * sizeof(T); // size in bytes
-
-    cl_int err = 0;
-    cl_mem newMem = clCreateSubBuffer(mem_,
-                                      CL_MEM_READ_WRITE,
-                                      CL_BUFFER_CREATE_TYPE_REGION,
-                                      &region,
-                                      &err);
-    CHECK_CL(err);
+    if (mem_) {
+      CHECK_CL(clRetainMemObject(mem_));
+    }
 
-    return DeviceMem<T>(context_, newMem, size);
+    return DeviceMem<T>(context_, mem_, offset_ + offset, size, align_);
   }
 
   Event copyD2H(facebook::cl::Queue& queue,
@@ -136,7 +203,7 @@ class DeviceMem {
                 size_t num = std::numeric_limits<size_t>::max(),
                 size_t offsetSrc = 0) {
     num = (num == std::numeric_limits<size_t>::max()) ? size_ : num;
-    return utils::copyD2H(queue, mem_, dst, num, offsetSrc);
+    return utils::copyD2H(queue, mem_, dst, num, offset_ + offsetSrc);
   }
 
   Event copyH2D(facebook::cl::Queue& queue,
@@ -144,7 +211,24 @@ class DeviceMem {
                 size_t num = std::numeric_limits<size_t>::max(),
                 size_t offsetDst = 0) {
     num = (num == std::numeric_limits<size_t>::max()) ? size_ : num;
-    return utils::copyH2D<T>(queue, mem_, src, num, offsetDst);
+    return utils::copyH2D<T>(queue, mem_, src, num, offset_ + offsetDst);
+  }
+
+  /// Non-blocking; `dst` is valid once the returned event has completed
+  Event copyD2HAsync(facebook::cl::Queue& queue,
+                     T* dst,
+                     size_t num,
+                     size_t offsetSrc) const {
+    return utils::copyD2HAsync(queue, mem_, dst, num, offset_ + offsetSrc);
+  }
+
+  /// Non-blocking; `src` must remain valid until the returned event has
+  /// completed
+  Event copyH2DAsync(facebook::cl::Queue& queue,
+                     const T* src,
+                     size_t num,
+                     size_t offsetDst) {
+    return utils::copyH2DAsync<T>(queue, mem_, src, num, offset_ + offsetDst);
   }
 
   Event copyD2DFrom(facebook::cl::Queue& queue,
@@ -152,7 +236,10 @@ class DeviceMem {
                     size_t offsetSrc,
                     size_t offsetDst,
                     size_t size) {
-    return utils::copyD2D<T>(queue, src.mem_, mem_, offsetSrc, offsetDst, size);
+    return utils::copyD2D<T>(queue, src.mem_, mem_,
+                             src.offset_ + offsetSrc,
+                             offset_ + offsetDst,
+                             size);
   }
 
   Event copyD2DTo(facebook::cl::Queue& queue,
@@ -160,18 +247,56 @@ class DeviceMem {
                   size_t offsetSrc,
                   size_t offsetDst,
                   size_t size) {
-    return utils::copyD2D<T>(queue, mem_, dst.mem_, offsetSrc, offsetDst, size);
+    return utils::copyD2D<T>(queue, mem_, dst.mem_,
+                             offset_ + offsetSrc,
+                             dst.offset_ + offsetDst,
+                             size);
   }
 
  protected:
+  template <typename U> friend class DeviceMem;
+
+  DeviceMem(cl_context context,
+            cl_mem mem,
+            size_t offset,
+            size_t size,
+            size_t align)
+      : context_(context),
+        mem_(mem),
+        offset_(offset),
+        size_(size),
+        align_(align),
+        subMem_(0) {
+  }
+
+  void release() {
+    if (subMem_) {
+      CHECK_CL(clReleaseMemObject(subMem_));
+      subMem_ = 0;
+    }
+
+    if (mem_) {
+      CHECK_CL(clReleaseMemObject(mem_));
+      mem_ = 0;
+    }
+  }
+
   // We don't own the context
   cl_context context_;
 
-  // We own the memory
+  // We own a reference to the buffer
   cl_mem mem_;
 
-  // The memory references a region of size_ * sizeof(T) bytes
+  // The memory references a region of size_ * sizeof(T) bytes, offset_ *
+  // sizeof(T) bytes into mem_
+  size_t offset_;
   size_t size_;
+
+  // Base address alignment in bytes for sub-buffers, or 0 if unknown
+  size_t align_;
+
+  // Sub-buffer for our region if offset, created on demand by get()
+  mutable cl_mem subMem_;
 };
 
 } } // namespace
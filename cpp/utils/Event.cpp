@@ -35,6 +35,38 @@ Event::empty(facebook::cl::Context& context) {
   return event;
 }
 
+Event
+Event::user(facebook::cl::Context& context) {
+  cl_int err = 0;
+  cl_event e = clCreateUserEvent(context, &err);
+  CHECK_CL(err);
+
+  return Event(e);
+}
+
+namespace {
+
+void CL_CALLBACK
+signalUserEvent(cl_event e, cl_int status, void* data) {
+  auto userEvent = (cl_event) data;
+
+  // A negative status means that `e` terminated abnormally; pass it on
+  clSetUserEventStatus(userEvent, status < 0 ? status : CL_COMPLETE);
+  clReleaseEvent(userEvent);
+}
+
+}
+
+void
+Event::signalOnCompletion(Event& userEvent) {
+  cl_event ue = userEvent;
+  CL_ASSERT(e_ && ue);
+
+  // The callback owns a reference to the user event
+  CHECK_CL(clRetainEvent(ue));
+  CHECK_CL(clSetEventCallback(e_, CL_COMPLETE, signalUserEvent, ue));
+}
+
 void
 Event::release() {
   if (e_) {
@@ -48,10 +80,38 @@ Event::wait() {
   CHECK_CL(clWaitForEvents(1, &e_));
 }
 
+bool
+Event::isComplete() {
+  CL_ASSERT(e_);
+
+  cl_int status = 0;
+  CHECK_CL(clGetEventInfo(e_, CL_EVENT_COMMAND_EXECUTION_STATUS,
+                          sizeof(status), &status, nullptr));
+  CL_ASSERT_MSG(status >= 0, "event terminated abnormally");
+
+  return status == CL_COMPLETE;
+}
+
+Event
+Event::share() {
+  if (e_) {
+    CHECK_CL(clRetainEvent(e_));
+  }
+
+  return Event(e_);
+}
+
 std::chrono::nanoseconds
 Event::getDuration() {
+  auto start = getStartTime();
+  auto end = getEndTime();
+
+  return std::chrono::nanoseconds(end - start);
+}
+
+cl_ulong
+Event::getStartTime() {
   cl_ulong start = 0;
-  cl_ulong end = 0;
 
   wait();
 
@@ -61,13 +121,22 @@ Event::getDuration() {
                                    &start,
                                    nullptr));
 
+  return start;
+}
+
+cl_ulong
+Event::getEndTime() {
+  cl_ulong end = 0;
+
+  wait();
+
   CHECK_CL(clGetEventProfilingInfo(e_,
                                    CL_PROFILING_COMMAND_END,
                                    sizeof(cl_ulong),
                                    &end,
                                    nullptr));
 
-  return std::chrono::nanoseconds(end - start);
+  return end;
 }
 
 float
@@ -31,6 +31,14 @@ class Event {
   /// Create an already completed event
   static Event empty(facebook::cl::Context& context);
 
+  /// Create a user event that has not yet completed; see signalOnCompletion
+  static Event user(facebook::cl::Context& context);
+
+  /// Completes the user event `userEvent`, which may belong to a different
+  /// context, once we have completed. This allows queues of different
+  /// contexts to wait on each other without blocking the host.
+  void signalOnCompletion(Event& userEvent);
+
   Event& operator=(Event&& e);
 
   inline operator cl_event() {
@@ -40,11 +48,22 @@ class Event {
   /// Wait on the host for the completion of this event
   void wait();
 
+  /// Whether this event has completed, without waiting
+  bool isComplete();
+
+  /// Returns another reference to the same event
+  Event share();
+
   /// Returns the duration of this event; will wait if the event is not yet
   /// complete
   std::chrono::nanoseconds getDuration();
   float getDurationInMs();
 
+  /// Returns the device timestamps in ns at which this event started and
+  /// ended execution; will wait if the event is not yet complete
+  cl_ulong getStartTime();
+  cl_ulong getEndTime();
+
   void release();
 
  protected:
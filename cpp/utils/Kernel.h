@@ -9,6 +9,7 @@
 #include "utils/Event.h"
 #include "CL/opencl.h"
 #include "utils/OpenCLUtils.h"
+#include "utils/Profiler.h"
 #include <iostream>
 #include <string>
 #include <vector>
@@ -41,6 +42,9 @@ struct Array3 {
   size_t z;
 };
 
+template <typename T>
+struct KernelArgInfo;
+
 class Kernel {
  public:
   explicit Kernel(cl_kernel kernel, const std::string& name);
@@ -81,12 +85,11 @@ class Kernel {
                                     0,
                                     nullptr,
                                     &cle));
-    auto evt = Event(cle);
-    // std::cout << "Ker " << getName() << " took "
-    //           << evt.getDurationInMs()
-    //           << " ms\n";
+    if (Profiler::isEnabled()) {
+      record(queue, cle, args...);
+    }
 
-    return evt;
+    return Event(cle);
   }
 
   /// Launch a task
@@ -102,19 +105,76 @@ class Kernel {
                            nullptr,
                            &cle));
 
-    auto evt = Event(cle);
-    // std::cout << "Ker " << getName() << " took "
-    //           << evt.getDurationInMs()
-    //           << " ms\n";
+    if (Profiler::isEnabled()) {
+      record(queue, cle, args...);
+    }
 
-    return evt;
+    return Event(cle);
   }
 
  protected:
+  template <typename... Args>
+  void record(facebook::cl::Queue& queue,
+              cl_event cle,
+              const Args&... args) {
+    Profiler::get().recordKernel(
+      queue, name_, cle,
+      std::vector<size_t>{KernelArgInfo<Args>::bytes(args)...},
+      std::vector<size_t>{KernelArgInfo<Args>::memBytes(args)...});
+  }
+
   cl_kernel kernel_;
   std::string name_;
 };
 
+/// Sizes of kernel arguments, for the profiler
+template <typename T>
+struct KernelArgInfo {
+  static size_t bytes(const T& arg) {
+    return sizeof(T);
+  }
+
+  static size_t memBytes(const T& arg) {
+    return 0;
+  }
+};
+
+template <typename T>
+struct KernelArgInfo<DeviceMem<T>> {
+  static size_t bytes(const DeviceMem<T>& arg) {
+    return arg.size() * sizeof(T);
+  }
+
+  static size_t memBytes(const DeviceMem<T>& arg) {
+    return bytes(arg);
+  }
+};
+
+/// For kernels that take the offset of a region as a separate argument:
+/// passes the whole buffer that the region is within, which (unlike the
+/// region itself) needs no alignment
+template <typename T>
+struct BaseMem {
+  const DeviceMem<T>& mem;
+};
+
+template <typename T>
+inline BaseMem<T>
+baseMem(const DeviceMem<T>& mem) {
+  return BaseMem<T>{mem};
+}
+
+template <typename T>
+struct KernelArgInfo<BaseMem<T>> {
+  static size_t bytes(const BaseMem<T>& arg) {
+    return arg.mem.size() * sizeof(T);
+  }
+
+  static size_t memBytes(const BaseMem<T>& arg) {
+    return bytes(arg);
+  }
+};
+
 template <typename T>
 struct PassArg {
   static void pass(facebook::cl::Kernel& kernel,
@@ -134,6 +194,16 @@ struct PassArg<DeviceMem<T>> {
   }
 };
 
+template <typename T>
+struct PassArg<BaseMem<T>> {
+  static void pass(facebook::cl::Kernel& kernel,
+                   unsigned int num,
+                   const BaseMem<T>& arg) {
+    cl_mem m = arg.mem.getBase();
+    CHECK_CL(clSetKernelArg(kernel, num, sizeof(cl_mem), &m));
+  }
+};
+
 template <typename T>
 void passKernelArgsImpl(facebook::cl::Kernel& kernel,
                         unsigned int& num,
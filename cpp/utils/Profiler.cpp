@@ -0,0 +1,277 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "utils/Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include "utils/OpenCLUtils.h"
+
+namespace facebook { namespace cl {
+
+namespace {
+
+cl_ulong
+getProfilingInfo(cl_event e, cl_profiling_info info) {
+  cl_ulong v = 0;
+  CHECK_CL(clGetEventProfilingInfo(e, info, sizeof(cl_ulong), &v, nullptr));
+
+  return v;
+}
+
+}
+
+std::string
+escapeJson(const std::string& s) {
+  std::stringstream ss;
+
+  for (auto c : s) {
+    switch (c) {
+      case '"': ss << "\\\""; break;
+      case '\\': ss << "\\\\"; break;
+      case '\n': ss << "\\n"; break;
+      case '\t': ss << "\\t"; break;
+      default:
+        if ((unsigned char) c < 0x20) {
+          ss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << (int) c << std::dec;
+        } else {
+          ss << c;
+        }
+    }
+  }
+
+  return ss.str();
+}
+
+bool Profiler::enabled_ = false;
+
+Profiler&
+Profiler::get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+Profiler::Profiler()
+    : collected_(0) {
+}
+
+Profiler::~Profiler() {
+  // Remaining events are released with the OpenCL runtime
+}
+
+void
+Profiler::enable(bool enable) {
+  enabled_ = enable;
+}
+
+void
+Profiler::record(ProfileRecord r, cl_command_queue queue, cl_event event) {
+  auto it = queues_.find(queue);
+  if (it == queues_.end()) {
+    it = queues_.emplace(queue, (int) queues_.size()).first;
+  }
+
+  CHECK_CL(clRetainEvent(event));
+
+  r.scope = scope_;
+  r.queue = it->second;
+  r.queued = 0;
+  r.submit = 0;
+  r.start = 0;
+  r.end = 0;
+  r.event = event;
+
+  records_.emplace_back(std::move(r));
+}
+
+void
+Profiler::recordKernel(cl_command_queue queue,
+                       const std::string& name,
+                       cl_event event,
+                       std::vector<size_t> argBytes,
+                       const std::vector<size_t>& memBytes) {
+  ProfileRecord r;
+  r.name = name;
+  r.isCopy = false;
+  r.argBytes = std::move(argBytes);
+
+  r.bytes = 0;
+  for (auto b : memBytes) {
+    r.bytes += b;
+  }
+
+  record(std::move(r), queue, event);
+}
+
+void
+Profiler::recordCopy(cl_command_queue queue,
+                     const char* name,
+                     cl_event event,
+                     size_t bytes) {
+  ProfileRecord r;
+  r.name = name;
+  r.isCopy = true;
+  r.bytes = bytes;
+
+  record(std::move(r), queue, event);
+}
+
+void
+Profiler::pushScope(const std::string& name) {
+  scopes_.push_back(name);
+
+  scope_.clear();
+  for (int i = 0; i < scopes_.size(); ++i) {
+    scope_ += (i > 0 ? " / " : "") + scopes_[i];
+  }
+}
+
+void
+Profiler::popScope() {
+  CL_ASSERT(!scopes_.empty());
+  scopes_.pop_back();
+
+  scope_.clear();
+  for (int i = 0; i < scopes_.size(); ++i) {
+    scope_ += (i > 0 ? " / " : "") + scopes_[i];
+  }
+}
+
+void
+Profiler::collect() {
+  for (; collected_ < records_.size(); ++collected_) {
+    auto& r = records_[collected_];
+
+    CHECK_CL(clWaitForEvents(1, &r.event));
+    r.queued = getProfilingInfo(r.event, CL_PROFILING_COMMAND_QUEUED);
+    r.submit = getProfilingInfo(r.event, CL_PROFILING_COMMAND_SUBMIT);
+    r.start = getProfilingInfo(r.event, CL_PROFILING_COMMAND_START);
+    r.end = getProfilingInfo(r.event, CL_PROFILING_COMMAND_END);
+
+    CHECK_CL(clReleaseEvent(r.event));
+    r.event = 0;
+  }
+}
+
+const std::vector<ProfileRecord>&
+Profiler::getRecords() {
+  collect();
+  return records_;
+}
+
+std::vector<ProfileLayerStats>
+Profiler::getLayerStats() {
+  collect();
+
+  std::vector<ProfileLayerStats> stats;
+  std::vector<std::pair<cl_ulong, cl_ulong>> spans;
+  std::unordered_map<std::string, int> index;
+
+  for (auto& r : records_) {
+    auto it = index.find(r.scope);
+    if (it == index.end()) {
+      it = index.emplace(r.scope, (int) stats.size()).first;
+
+      ProfileLayerStats s;
+      s.scope = r.scope;
+      s.launches = 0;
+      s.deviceTime = 0;
+      s.wallTime = 0;
+      s.bytes = 0;
+      stats.push_back(s);
+
+      spans.push_back(std::make_pair(std::numeric_limits<cl_ulong>::max(),
+                                     (cl_ulong) 0));
+    }
+
+    auto& s = stats[it->second];
+    auto& span = spans[it->second];
+
+    ++s.launches;
+    s.deviceTime += (double) (r.end - r.start);
+    s.bytes += r.bytes;
+
+    span.first = std::min(span.first, r.start);
+    span.second = std::max(span.second, r.end);
+  }
+
+  for (int i = 0; i < stats.size(); ++i) {
+    stats[i].wallTime = (double) (spans[i].second - spans[i].first);
+  }
+
+  return stats;
+}
+
+std::string
+Profiler::getChromeTrace() {
+  collect();
+
+  cl_ulong base = std::numeric_limits<cl_ulong>::max();
+  for (auto& r : records_) {
+    base = std::min(base, r.queued);
+  }
+
+  // Timestamps are in us
+  auto us = [base](cl_ulong t) {
+    return (double) (t - base) / 1e3;
+  };
+
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(3);
+  ss << "{\"traceEvents\":[";
+
+  for (int i = 0; i < records_.size(); ++i) {
+    auto& r = records_[i];
+
+    ss << (i > 0 ? ",\n" : "\n")
+       << "{\"name\":\"" << escapeJson(r.name) << "\""
+       << ",\"cat\":\"" << (r.isCopy ? "copy" : "kernel") << "\""
+       << ",\"ph\":\"X\""
+       << ",\"ts\":" << us(r.start)
+       << ",\"dur\":" << (double) (r.end - r.start) / 1e3
+       << ",\"pid\":0"
+       << ",\"tid\":" << r.queue
+       << ",\"args\":{"
+       << "\"scope\":\"" << escapeJson(r.scope) << "\""
+       << ",\"bytes\":" << r.bytes
+       << ",\"queued_us\":" << us(r.queued)
+       << ",\"submit_us\":" << us(r.submit)
+       << ",\"arg_bytes\":[";
+
+    for (int j = 0; j < r.argBytes.size(); ++j) {
+      ss << (j > 0 ? "," : "") << r.argBytes[j];
+    }
+
+    ss << "]}}";
+  }
+
+  ss << "\n],\"displayTimeUnit\":\"ns\"}\n";
+  return ss.str();
+}
+
+void
+Profiler::writeChromeTrace(const std::string& file) {
+  std::ofstream out(file);
+  CL_ASSERT_MSG(out.good(), "could not open trace file");
+
+  out << getChromeTrace();
+}
+
+void
+Profiler::clear(size_t first) {
+  collect();
+
+  if (first < records_.size()) {
+    records_.resize(first);
+  }
+
+  collected_ = records_.size();
+}
+
+} } // namespace
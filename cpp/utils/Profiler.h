@@ -0,0 +1,148 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CL/opencl.h"
+
+namespace facebook { namespace cl {
+
+// A kernel launch or buffer copy recorded by the Profiler
+struct ProfileRecord {
+  // Kernel name, or copyH2D / copyD2H / copyD2D
+  std::string name;
+
+  // Layer scope active at enqueue time (e.g., "ResNet / 12: Conv2d (...)"),
+  // or empty
+  std::string scope;
+
+  bool isCopy;
+
+  // Size in bytes of each kernel argument (buffers report their size)
+  std::vector<size_t> argBytes;
+
+  // Bytes of buffers passed to a kernel, or bytes copied
+  size_t bytes;
+
+  // Index of the queue in order of first use
+  int queue;
+
+  // Device timestamps (ns), valid after Profiler::collect()
+  cl_ulong queued;
+  cl_ulong submit;
+  cl_ulong start;
+  cl_ulong end;
+
+  // Retained until collected
+  cl_event event;
+};
+
+struct ProfileLayerStats {
+  std::string scope;
+  int launches;
+
+  // Sum of execution time of the launches, in ns
+  double deviceTime;
+
+  // From the start of the first launch to the end of the last, in ns
+  double wallTime;
+
+  size_t bytes;
+};
+
+// Opt-in, process-wide recorder of all kernel launches and copies. While
+// disabled, the only cost on the launch path is a test of a global flag.
+class Profiler {
+ public:
+  static Profiler& get();
+
+  static inline bool isEnabled() {
+    return enabled_;
+  }
+
+  void enable(bool enable);
+
+  // Called upon launch / copy; retains `event`
+  void recordKernel(cl_command_queue queue,
+                    const std::string& name,
+                    cl_event event,
+                    std::vector<size_t> argBytes,
+                    const std::vector<size_t>& memBytes);
+
+  void recordCopy(cl_command_queue queue,
+                  const char* name,
+                  cl_event event,
+                  size_t bytes);
+
+  void pushScope(const std::string& name);
+  void popScope();
+
+  // Waits for all outstanding records and fetches their timestamps
+  void collect();
+
+  // Returns all records, collected
+  const std::vector<ProfileRecord>& getRecords();
+
+  // Statistics per scope, in order of first appearance
+  std::vector<ProfileLayerStats> getLayerStats();
+
+  // Chrome trace_event JSON (chrome://tracing, Perfetto) of all records
+  std::string getChromeTrace();
+  void writeChromeTrace(const std::string& file);
+
+  // Drops all records from index `first` on
+  void clear(size_t first = 0);
+
+ private:
+  Profiler();
+  ~Profiler();
+
+  void record(ProfileRecord r, cl_command_queue queue, cl_event event);
+
+  static bool enabled_;
+
+  std::vector<ProfileRecord> records_;
+
+  // Records before this index have been collected
+  size_t collected_;
+
+  std::vector<std::string> scopes_;
+  std::string scope_;
+
+  std::unordered_map<cl_command_queue, int> queues_;
+};
+
+// Escapes `s` for use within a JSON string
+std::string escapeJson(const std::string& s);
+
+// Pushes a profiler scope for its lifetime if profiling is enabled.
+// `nameFn` returns the scope name, and is only called if enabled.
+class ProfileScope {
+ public:
+  template <typename F>
+  explicit ProfileScope(const F& nameFn)
+      : active_(Profiler::isEnabled()) {
+    if (active_) {
+      Profiler::get().pushScope(nameFn());
+    }
+  }
+
+  ~ProfileScope() {
+    if (active_) {
+      Profiler::get().popScope();
+    }
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  bool active_;
+};
+
+} } // namespace
@@ -9,8 +9,11 @@
 namespace facebook { namespace cl {
 
 Program::Program(Program&& e)
-    : program_(std::move(e.program_)) {
+    : program_(std::move(e.program_)),
+      cacheMutex_(new std::recursive_mutex),
+      cache_(std::move(e.cache_)) {
   e.program_ = 0;
+  e.cache_.clear();
 }
 
 Program&
@@ -18,12 +21,19 @@ Program::operator=(Program&& e) {
   release();
   program_ = std::move(e.program_);
   e.program_ = 0;
+  cache_ = std::move(e.cache_);
+  e.cache_.clear();
 
   return *this;
 }
 
 void
 Program::release() {
+  {
+    std::lock_guard<std::recursive_mutex> guard(*cacheMutex_);
+    cache_.clear();
+  }
+
   if (program_) {
     CHECK_CL(clReleaseProgram(program_));
     program_ = 0;
@@ -6,6 +6,10 @@
 #pragma once
 
 #include "CL/opencl.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include "utils/Kernel.h"
 
 namespace facebook { namespace cl {
@@ -13,11 +17,13 @@ namespace facebook { namespace cl {
 class Program {
  public:
   inline Program()
-      : program_(0) {
+      : program_(0),
+        cacheMutex_(new std::recursive_mutex) {
   }
 
   inline Program(cl_program e)
-      : program_(e) {
+      : program_(e),
+        cacheMutex_(new std::recursive_mutex) {
   }
 
   Program(Program&& e);
@@ -36,8 +42,28 @@ class Program {
   /// Returns a new kernel instance
   Kernel getKernel(const std::string& name);
 
+  /// Returns the object cached for this program under `key`, creating it
+  /// with `make()` (returning a T*) on first use. Entries are dropped when
+  /// the program is released. `make` may itself use the cache.
+  template <typename T, typename F>
+  T& getCached(const std::string& key, F make) {
+    std::lock_guard<std::recursive_mutex> guard(*cacheMutex_);
+
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+      std::shared_ptr<void> entry = std::shared_ptr<T>(make());
+      it = cache_.emplace(key, std::move(entry)).first;
+    }
+
+    return *static_cast<T*>(it->second.get());
+  }
+
  protected:
   cl_program program_;
+
+  // Host-side state derived from the program, by key; see getCached()
+  std::unique_ptr<std::recursive_mutex> cacheMutex_;
+  std::unordered_map<std::string, std::shared_ptr<void>> cache_;
 };
 
 } } // namespace
@@ -4,6 +4,7 @@
 // This source code is licensed under the license found in the
 // LICENSE file in the root directory of this source tree.
 #include "utils/Queue.h"
+#include "utils/Event.h"
 #include "utils/OpenCLUtils.h"
 
 namespace facebook { namespace cl {
@@ -37,4 +38,27 @@ Queue::blockingWait() {
   }
 }
 
+void
+Queue::flush() {
+  if (queue_) {
+    CHECK_CL(clFlush(queue_));
+  }
+}
+
+void
+Queue::waitFor(Event& e) {
+  cl_event evt = e;
+  CL_ASSERT(evt);
+
+  CHECK_CL(clEnqueueBarrierWithWaitList(queue_, 1, &evt, nullptr));
+}
+
+Event
+Queue::marker() {
+  cl_event evt = 0;
+  CHECK_CL(clEnqueueMarkerWithWaitList(queue_, 0, nullptr, &evt));
+
+  return Event(evt);
+}
+
 } } // namespace
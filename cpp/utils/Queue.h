@@ -9,6 +9,8 @@
 
 namespace facebook { namespace cl {
 
+class Event;
+
 class Queue {
  public:
   inline Queue()
@@ -31,6 +33,17 @@ class Queue {
 
   void blockingWait();
 
+  /// Submits all enqueued commands to the device without waiting
+  void flush();
+
+  /// Commands enqueued after this call will not begin until `e` (which may
+  /// belong to another queue of the same context) has completed
+  void waitFor(Event& e);
+
+  /// Returns an event that completes when all commands enqueued so far
+  /// have completed
+  Event marker();
+
   inline ~Queue() {
     release();
   }
@@ -0,0 +1,237 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+#include "utils/Tensor.h"
+#include "utils/Event.h"
+#include "utils/Queue.h"
+
+namespace facebook { namespace cl {
+
+template <typename T> class ScalarBatch;
+
+namespace detail {
+
+// Host staging of one ScalarBatch flush, shared with its futures
+template <typename T>
+struct ScalarTransfer {
+  // Element offset and values of each run of reads / writes
+  std::vector<std::pair<size_t, std::vector<T>>> reads;
+  std::vector<std::pair<size_t, std::vector<T>>> writes;
+
+  // (read run, index within it) of the value of each future, by id
+  std::vector<std::pair<size_t, size_t>> locations;
+
+  // Completes once every transfer of the flush has; unset until flushed
+  Event done;
+  bool complete = false;
+
+  bool isComplete() {
+    if (!complete && (cl_event) done) {
+      complete = done.isComplete();
+    }
+
+    return complete;
+  }
+
+  void wait() {
+    CL_ASSERT_MSG((cl_event) done, "ScalarBatch has not been flushed");
+
+    if (!complete) {
+      done.wait();
+      complete = true;
+    }
+  }
+};
+
+}
+
+/// A value read by ScalarBatch, available once its flush has completed
+template <typename T>
+class ScalarFuture {
+ public:
+  ScalarFuture()
+      : id_(0) {
+  }
+
+  /// Whether the value has arrived; does not block
+  bool isReady() const {
+    return transfer_ && transfer_->isComplete();
+  }
+
+  /// Returns the value, waiting on the host for its transfer if needed
+  T get() const {
+    CL_ASSERT(transfer_);
+    transfer_->wait();
+
+    auto& loc = transfer_->locations[id_];
+    return transfer_->reads[loc.first].second[loc.second];
+  }
+
+ private:
+  friend class ScalarBatch<T>;
+
+  ScalarFuture(std::shared_ptr<detail::ScalarTransfer<T>> transfer,
+               size_t id)
+      : transfer_(std::move(transfer)),
+        id_(id) {
+  }
+
+  std::shared_ptr<detail::ScalarTransfer<T>> transfer_;
+
+  // Index of our read within its flush
+  size_t id_;
+};
+
+/// Stages single element reads and writes of a tensor, so that many accesses
+/// cost a few transfers rather than a blocking transfer each. Nothing is
+/// transferred until flush(), which enqueues the writes and then the reads
+/// without blocking. Accesses are coalesced into runs of nearby elements,
+/// each a single transfer; reads see every write staged before the flush.
+/// The tensor must outlive the batch.
+template <typename T>
+class ScalarBatch {
+ public:
+  /// Reads of elements at most this far apart share a transfer
+  static constexpr size_t kMaxReadGap = 64;
+
+  explicit ScalarBatch(CLTensor<T>& t)
+      : tensor_(t) {
+  }
+
+  ScalarBatch(const ScalarBatch&) = delete;
+  ScalarBatch& operator=(const ScalarBatch&) = delete;
+
+  /// Waits for outstanding writes, whose host data we own
+  ~ScalarBatch() {
+    for (auto& t : inFlight_) {
+      t->wait();
+    }
+  }
+
+  template <typename IndexT>
+  ScalarFuture<T> get(std::initializer_list<IndexT> at) {
+    size_t offset = tensor_.offset(at);
+    auto it = reads_.find(offset);
+
+    if (it == reads_.end()) {
+      it = reads_.emplace(offset, std::vector<size_t>()).first;
+    }
+
+    size_t id = numReads_++;
+    it->second.push_back(id);
+
+    return ScalarFuture<T>(next(), id);
+  }
+
+  /// Of several writes to an element, the last is kept
+  template <typename IndexT>
+  void set(T v, std::initializer_list<IndexT> at) {
+    writes_[tensor_.offset(at)] = v;
+  }
+
+  /// Enqueues all staged accesses. Returns an event that completes once they
+  /// have, after which the futures are ready. The batch may then be reused.
+  Event flush(Queue& queue) {
+    auto transfer = next();
+
+    // Runs of consecutive writes
+    for (auto& w : writes_) {
+      auto& runs = transfer->writes;
+
+      if (runs.empty() ||
+          runs.back().first + runs.back().second.size() != w.first) {
+        runs.emplace_back(w.first, std::vector<T>());
+      }
+
+      runs.back().second.push_back(w.second);
+    }
+
+    for (auto& r : transfer->writes) {
+      tensor_.getDeviceMem().copyH2DAsync(queue,
+                                          r.second.data(),
+                                          r.second.size(),
+                                          r.first);
+    }
+
+    // Runs of nearby reads, including the elements between them
+    auto& locations = transfer->locations;
+    locations.resize(numReads_);
+
+    for (auto& r : reads_) {
+      auto& runs = transfer->reads;
+
+      if (runs.empty() ||
+          r.first - (runs.back().first + runs.back().second.size()) >=
+          kMaxReadGap) {
+        runs.emplace_back(r.first, std::vector<T>());
+      }
+
+      auto& run = runs.back();
+      run.second.resize(r.first - run.first + 1);
+
+      for (auto id : r.second) {
+        locations[id] = std::make_pair(runs.size() - 1, r.first - run.first);
+      }
+    }
+
+    for (auto& r : transfer->reads) {
+      tensor_.getDeviceMem().copyD2HAsync(queue,
+                                          r.second.data(),
+                                          r.second.size(),
+                                          r.first);
+    }
+
+    transfer->done = queue.marker();
+
+    // Keep the staging alive until the transfers complete
+    inFlight_.erase(std::remove_if(inFlight_.begin(), inFlight_.end(),
+                                   [](const std::shared_ptr<
+                                      detail::ScalarTransfer<T>>& t) {
+                                     return t->isComplete();
+                                   }),
+                    inFlight_.end());
+    inFlight_.push_back(transfer);
+
+    reads_.clear();
+    writes_.clear();
+    numReads_ = 0;
+    next_.reset();
+
+    return transfer->done.share();
+  }
+
+ private:
+  // The transfer that the next flush will perform
+  std::shared_ptr<detail::ScalarTransfer<T>>& next() {
+    if (!next_) {
+      next_ = std::make_shared<detail::ScalarTransfer<T>>();
+    }
+
+    return next_;
+  }
+
+  CLTensor<T>& tensor_;
+
+  // Staged reads by element offset, with the ids of the futures waiting on
+  // each
+  std::map<size_t, std::vector<size_t>> reads_;
+  size_t numReads_ = 0;
+
+  // Staged writes by element offset
+  std::map<size_t, T> writes_;
+
+  std::shared_ptr<detail::ScalarTransfer<T>> next_;
+
+  // Flushed transfers that may still be running
+  std::vector<std::shared_ptr<detail::ScalarTransfer<T>>> inFlight_;
+};
+
+} } // namespace
@@ -0,0 +1,382 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#include "verify/Verify.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "utils/CLTensor.h"
+#include "utils/HostTensor.h"
+#include "utils/OpenCLUtils.h"
+#include "utils/Queue.h"
+
+namespace facebook { namespace cl {
+
+namespace {
+
+constexpr size_t kNumValues = (size_t) 1 << kWidth;
+
+VerifyResult
+makeResult(const std::string& op, size_t tested) {
+  VerifyResult r;
+  r.op = op;
+  r.skipped = false;
+  r.tested = tested;
+  r.mismatches = 0;
+
+  return r;
+}
+
+VerifyResult
+makeSkipped(const std::string& op) {
+  auto r = makeResult(op, 0);
+  r.skipped = true;
+
+  return r;
+}
+
+void
+check(VerifyResult& r,
+      unsigned int a,
+      unsigned int b,
+      unsigned int expected,
+      unsigned int actual,
+      int maxReport) {
+  if (expected == actual) {
+    return;
+  }
+
+  if (r.first.size() < maxReport) {
+    VerifyMismatch m;
+    m.a = a;
+    m.b = b;
+    m.expected = expected;
+    m.actual = actual;
+
+    r.first.push_back(m);
+  }
+
+  ++r.mismatches;
+}
+
+// Every encoding, in order
+CLTensor<FloatType<kWidth>::T>
+allValues(Context& context, Queue& queue) {
+  HostTensor<FloatType<kWidth>::T, 1> a({kNumValues});
+  for (size_t i = 0; i < kNumValues; ++i) {
+    a[i] = (FloatType<kWidth>::T) i;
+  }
+
+  return CLTensor<FloatType<kWidth>::T>(context, queue, a);
+}
+
+const char*
+mathOpName(MathOp op) {
+  switch (op) {
+    case MathOp::Add: return "add";
+    case MathOp::Sub: return "sub";
+    case MathOp::Mul: return "mul";
+    case MathOp::Div: return "div";
+    case MathOp::Min: return "min";
+    case MathOp::Max: return "max";
+    default:
+      CL_ASSERT_MSG(false, "undefined operator");
+      return "";
+  }
+}
+
+const char*
+compareOpName(CompareOp op) {
+  switch (op) {
+    case CompareOp::EQ: return "comp_eq";
+    case CompareOp::NE: return "comp_ne";
+    case CompareOp::LT: return "comp_lt";
+    case CompareOp::LE: return "comp_le";
+    case CompareOp::GT: return "comp_gt";
+    case CompareOp::GE: return "comp_ge";
+    default:
+      CL_ASSERT_MSG(false, "undefined operator");
+      return "";
+  }
+}
+
+}
+
+bool
+readHexTable(const std::string& file,
+             size_t size,
+             std::vector<unsigned int>& out) {
+  std::ifstream in(file);
+  if (!in.good()) {
+    return false;
+  }
+
+  out.clear();
+  out.reserve(size);
+
+  std::string line;
+  while (out.size() < size && std::getline(in, line)) {
+    if (line.empty()) {
+      continue;
+    }
+
+    // Simulators write x or z for undriven bits
+    CL_ASSERT_MSG(line.find_first_of("xXzZ") == std::string::npos,
+                  "golden table has undefined values");
+
+    out.push_back((unsigned int) std::stoul(line, nullptr, 16));
+  }
+
+  CL_ASSERT_MSG(out.size() == size, "golden table is too short");
+  return true;
+}
+
+VerifyResult
+verifyBinaryOp(Context& context,
+               Program& program,
+               Queue& queue,
+               MathOp op,
+               const std::vector<unsigned int>& golden,
+               int maxReport) {
+  size_t num = kNumValues * kNumValues;
+  CL_ASSERT(golden.size() == num);
+
+  HostTensor<FloatType<kWidth>::T, 1> a({num});
+  HostTensor<FloatType<kWidth>::T, 1> b({num});
+
+  for (size_t i = 0; i < num; ++i) {
+    a[i] = (FloatType<kWidth>::T) (i >> kWidth);
+    b[i] = (FloatType<kWidth>::T) (i & (kNumValues - 1));
+  }
+
+  CLTensor<FloatType<kWidth>::T> aDev(context, queue, a);
+  CLTensor<FloatType<kWidth>::T> bDev(context, queue, b);
+  CLTensor<FloatType<kWidth>::T> outDev(context, {num});
+
+  runBinaryMath(context, program, queue,
+                aDev, bDev, op, RoundOp::R2NE, outDev);
+  auto out = outDev.toHost<1>(queue);
+
+  auto r = makeResult(mathOpName(op), num);
+  for (size_t i = 0; i < num; ++i) {
+    check(r, a[i], b[i], golden[i], out[i], maxReport);
+  }
+
+  return r;
+}
+
+VerifyResult
+verifyCompare(Context& context,
+              Program& program,
+              Queue& queue,
+              CompareOp op,
+              const std::vector<unsigned int>& golden,
+              int maxReport) {
+  CL_ASSERT(golden.size() == kNumValues * kNumValues);
+
+  auto aDev = allValues(context, queue);
+
+  // Selected where the comparison holds
+  HostTensor<FloatType<kWidth>::T, 1> ones({kNumValues});
+  for (size_t i = 0; i < kNumValues; ++i) {
+    ones[i] = FloatType<kWidth>::kOne;
+  }
+
+  CLTensor<FloatType<kWidth>::T> sel(context, queue, ones);
+
+  // One launch per b, as b is a host scalar
+  std::vector<CLTensor<FloatType<kWidth>::T>> outs;
+  for (size_t b = 0; b < kNumValues; ++b) {
+    outs.emplace_back(context, std::vector<size_t>{kNumValues});
+
+    runThresholdScalarHost(context, program, queue,
+                           aDev, (FloatType<kWidth>::T) b, sel, op,
+                           outs.back());
+  }
+
+  auto r = makeResult(compareOpName(op), kNumValues * kNumValues);
+  for (size_t b = 0; b < kNumValues; ++b) {
+    auto out = outs[b].toHost<1>(queue);
+
+    for (size_t a = 0; a < kNumValues; ++a) {
+      check(r, a, b, golden[(a << kWidth) | b],
+            out[a] != FloatType<kWidth>::kZero, maxReport);
+    }
+  }
+
+  return r;
+}
+
+VerifyResult
+verifyUnaryOp(Context& context,
+              Program& program,
+              Queue& queue,
+              const std::string& func,
+              const std::vector<unsigned int>& golden,
+              int maxReport) {
+  CL_ASSERT(golden.size() == kNumValues);
+
+  auto aDev = allValues(context, queue);
+  CLTensor<FloatType<kWidth>::T> outDev(context, {kNumValues});
+
+  if (func == "ln") {
+    runLn(context, program, queue, aDev, outDev);
+  } else if (func == "exp") {
+    runExp(context, program, queue, aDev, outDev);
+  } else if (func == "inv") {
+    runInv(context, program, queue, aDev, outDev);
+  } else if (func == "sqrt") {
+    runSqrt(context, program, queue, aDev, outDev);
+  } else if (func == "sigmoid") {
+    runSigmoid(context, program, queue, aDev, outDev);
+  } else {
+    CL_ASSERT_MSG(false, "unknown function");
+  }
+
+  auto out = outDev.toHost<1>(queue);
+
+  auto r = makeResult(func, kNumValues);
+  for (size_t a = 0; a < kNumValues; ++a) {
+    check(r, a, 0, golden[a], out[a], maxReport);
+  }
+
+  return r;
+}
+
+VerifyResult
+verifyToFloat(Context& context,
+              Program& program,
+              Queue& queue,
+              const std::vector<unsigned int>& golden,
+              int maxReport) {
+  CL_ASSERT(golden.size() == kNumValues);
+
+  auto aDev = allValues(context, queue);
+  CLTensor<float> outDev(context, {kNumValues});
+
+  runToFloat(context, program, queue, aDev, outDev);
+  auto out = outDev.toHost<1>(queue);
+
+  auto r = makeResult("to_float", kNumValues);
+  for (size_t a = 0; a < kNumValues; ++a) {
+    unsigned int bits = 0;
+    std::memcpy(&bits, out.data() + a, sizeof(bits));
+
+    check(r, a, 0, golden[a], bits, maxReport);
+  }
+
+  return r;
+}
+
+VerifyResult
+verifyRoundTrip(Context& context,
+                Program& program,
+                Queue& queue,
+                int maxReport) {
+  auto aDev = allValues(context, queue);
+  CLTensor<float> f(context, {kNumValues});
+  CLTensor<FloatType<kWidth>::T> outDev(context, {kNumValues});
+
+  runToFloat(context, program, queue, aDev, f);
+  runToPosit8(context, program, queue, f, outDev);
+  auto out = outDev.toHost<1>(queue);
+
+  auto r = makeResult("round_trip", kNumValues);
+  for (size_t a = 0; a < kNumValues; ++a) {
+    check(r, a, 0, a, out[a], maxReport);
+  }
+
+  return r;
+}
+
+std::vector<VerifyResult>
+verifyAll(Context& context,
+          Program& program,
+          Queue& queue,
+          const std::string& goldenDir,
+          const std::string& lutDir,
+          int maxReport) {
+  std::vector<VerifyResult> results;
+  std::vector<unsigned int> golden;
+
+  auto goldenFile = [&goldenDir](const std::string& name) {
+    return goldenDir + "/golden_" + name + ".hex";
+  };
+
+  for (auto op : {MathOp::Add, MathOp::Sub, MathOp::Mul,
+                  MathOp::Div, MathOp::Min, MathOp::Max}) {
+    if (readHexTable(goldenFile(mathOpName(op)),
+                     kNumValues * kNumValues, golden)) {
+      results.push_back(
+        verifyBinaryOp(context, program, queue, op, golden, maxReport));
+    } else {
+      results.push_back(makeSkipped(mathOpName(op)));
+    }
+  }
+
+  for (auto op : {CompareOp::EQ, CompareOp::NE, CompareOp::LT,
+                  CompareOp::LE, CompareOp::GT, CompareOp::GE}) {
+    if (readHexTable(goldenFile(compareOpName(op)),
+                     kNumValues * kNumValues, golden)) {
+      results.push_back(
+        verifyCompare(context, program, queue, op, golden, maxReport));
+    } else {
+      results.push_back(makeSkipped(compareOpName(op)));
+    }
+  }
+
+  for (auto func : {"ln", "exp", "inv", "sqrt", "sigmoid"}) {
+    auto file = lutDir + "/" + func + std::to_string(kWidth) + "_" +
+      std::to_string(kES) + ".hex";
+
+    if (readHexTable(file, kNumValues, golden)) {
+      results.push_back(
+        verifyUnaryOp(context, program, queue, func, golden, maxReport));
+    } else {
+      results.push_back(makeSkipped(func));
+    }
+  }
+
+  if (readHexTable(goldenFile("to_float"), kNumValues, golden)) {
+    results.push_back(
+      verifyToFloat(context, program, queue, golden, maxReport));
+  } else {
+    results.push_back(makeSkipped("to_float"));
+  }
+
+  results.push_back(verifyRoundTrip(context, program, queue, maxReport));
+
+  return results;
+}
+
+std::string
+verifyResultsToString(const std::vector<VerifyResult>& results) {
+  std::stringstream ss;
+
+  for (auto& r : results) {
+    ss << std::setw(12) << r.op << ": ";
+
+    if (r.skipped) {
+      ss << "skipped (no golden table)\n";
+      continue;
+    }
+
+    ss << (r.passed() ? "ok" : "FAILED") << " ("
+       << r.mismatches << " / " << r.tested << " mismatches)\n";
+
+    for (auto& m : r.first) {
+      ss << std::hex
+         << "    a " << m.a << " b " << m.b
+         << ": expected " << m.expected << " got " << m.actual
+         << std::dec << "\n";
+    }
+  }
+
+  return ss.str();
+}
+
+} }
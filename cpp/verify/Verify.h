@@ -0,0 +1,117 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FloatDefs.h"
+#include "ops/TensorMath.h"
+
+/// Exhaustive bit-exact verification of the pointwise operators. With at
+/// most 2^kWidth encodings, every input (pair) of an op can be run through
+/// the device kernels and compared against golden tables written by the RTL
+/// models (rtl/posit/tools/PositGoldenTableTool.sv,
+/// rtl/log/tools/LogGoldenTableTool.sv and the function LUTs of
+/// rtl/posit/lut_func/PositLUTGenerator.sv).
+
+namespace facebook { namespace cl {
+
+class Context;
+class Program;
+class Queue;
+
+struct VerifyMismatch {
+  // Inputs; b is unused for unary ops
+  unsigned int a;
+  unsigned int b;
+
+  unsigned int expected;
+  unsigned int actual;
+};
+
+struct VerifyResult {
+  std::string op;
+
+  // Set if the golden table was not found, in which case nothing was tested
+  bool skipped;
+
+  size_t tested;
+  size_t mismatches;
+
+  // The first mismatches found, in input order
+  std::vector<VerifyMismatch> first;
+
+  inline bool passed() const {
+    return !skipped && mismatches == 0;
+  }
+};
+
+// Reads a table of one hex value per line, as written by $fdisplay("%h").
+// Returns false if `file` cannot be opened; throws if it has fewer than
+// `size` values.
+bool readHexTable(const std::string& file,
+                  size_t size,
+                  std::vector<unsigned int>& out);
+
+// out = op(a, b) over every (a, b); the golden table is indexed by
+// (a << kWidth) | b
+VerifyResult
+verifyBinaryOp(Context& context,
+               Program& program,
+               Queue& queue,
+               MathOp op,
+               const std::vector<unsigned int>& golden,
+               int maxReport);
+
+// a op b over every (a, b); the golden table holds 0 or 1
+VerifyResult
+verifyCompare(Context& context,
+              Program& program,
+              Queue& queue,
+              CompareOp op,
+              const std::vector<unsigned int>& golden,
+              int maxReport);
+
+// One of ln, exp, inv, sqrt or sigmoid over every a
+VerifyResult
+verifyUnaryOp(Context& context,
+              Program& program,
+              Queue& queue,
+              const std::string& func,
+              const std::vector<unsigned int>& golden,
+              int maxReport);
+
+// runToFloat over every a; the golden table holds float bits
+VerifyResult
+verifyToFloat(Context& context,
+              Program& program,
+              Queue& queue,
+              const std::vector<unsigned int>& golden,
+              int maxReport);
+
+// runToPosit8(runToFloat(a)) == a over every a; needs no golden table
+VerifyResult
+verifyRoundTrip(Context& context,
+                Program& program,
+                Queue& queue,
+                int maxReport);
+
+// Runs every check for which a table is found. Tables from the golden table
+// tools are expected in `goldenDir` (golden_<op>.hex), function LUTs in
+// `lutDir` (<func>8_1.hex)
+std::vector<VerifyResult>
+verifyAll(Context& context,
+          Program& program,
+          Queue& queue,
+          const std::string& goldenDir,
+          const std::string& lutDir,
+          int maxReport = 10);
+
+// Human-readable summary, one line per op plus its first mismatches
+std::string
+verifyResultsToString(const std::vector<VerifyResult>& results);
+
+} } // namespace
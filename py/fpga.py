@@ -16,11 +16,14 @@ import math
 import torch
 from torch.utils.cpp_extension import CppExtension, BuildExtension
 
-def init_fpga(aocx_file, dir='../bitstream'):
+def load_ext():
     files = []
     files.extend(glob.glob('../cpp/utils/*.cpp'))
     files.extend(glob.glob('../cpp/ops/*.cpp'))
     files.extend(glob.glob('../cpp/layers/*.cpp'))
+    files.extend(glob.glob('../cpp/engine/*.cpp'))
+    files.extend(glob.glob('../cpp/bench/*.cpp'))
+    files.extend(glob.glob('../cpp/verify/*.cpp'))
     files.append('../cpp/PythonInterface.cpp')
 
     aocl_compile_conf = subprocess.check_output(
@@ -36,6 +39,50 @@ def init_fpga(aocx_file, dir='../bitstream'):
         extra_include_paths=['../cpp/'],
         verbose=False)
 
+    return ext
+
+def init_fpga(aocx_file, dir='../bitstream', select_convert_path=True):
+    ext = load_ext()
     dev = ext.fpga_init(dir, aocx_file)
 
+    # Picks the faster of device and host-table decoding for device -> host
+    # float conversions (ext.to_float)
+    if select_convert_path:
+        ext.select_convert_path(*dev, 1 << 16, 3)
+
     return ext, dev
+
+def init_fpga_pool(aocx_file, dir='../bitstream', max_devices=-1,
+                   platform='FPGA', cpu=False):
+    """Opens every device of `platform` (or up to `max_devices`); returns
+    the extension, the ext.DevicePool and a (context, program, queue) tuple
+    per device, on which a model replica is to be built"""
+    ext = load_ext()
+    lib = '{}/build_{}/{}.aocx'.format(dir, aocx_file, aocx_file)
+    pool = ext.DevicePool(platform, lib, max_devices, cpu)
+
+    devs = [(pool.getContext(i), pool.getProgram(i), pool.getQueue(i))
+            for i in range(pool.numDevices())]
+
+    return ext, pool, devs
+
+def print_profile(ext, trace_file=None):
+    """Prints per-layer device time of everything run since profiling was
+    enabled (ext.profiler_enable(True)); optionally writes a Chrome trace
+    that can be loaded in chrome://tracing"""
+    stats = ext.profiler_layer_stats()
+    total = sum(s.device_time for s in stats)
+
+    print('{:>10} {:>7} {:>9} {:>10}  {}'.format(
+        'ms', '%', 'launches', 'MB', 'layer'))
+    for s in sorted(stats, key=lambda s: -s.device_time):
+        print('{:10.3f} {:7.2f} {:9d} {:10.2f}  {}'.format(
+            s.device_time / 1e6,
+            100.0 * s.device_time / max(total, 1),
+            s.launches,
+            s.bytes / 1e6,
+            s.scope))
+
+    if trace_file:
+        ext.profiler_write_trace(trace_file)
+        print('Wrote trace to {}'.format(trace_file))
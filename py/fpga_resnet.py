@@ -8,227 +8,158 @@ import torch
 import math
 from torch.utils.cpp_extension import CppExtension, BuildExtension
 
-def inspect(name, ext, context, program, queue, x):
-    return
-#    f = ext.to_float(context, program, queue, x).abs_()
-#    print('{}: mean {} max {}'.format(name, f.mean(), f.max()))
+class Block():
+    """Handles to the layers of one residual block of the native ResNet"""
 
-class Sequential():
-    def __init__(self, *args):
-        self.modules = [*args]
+    def __init__(self, model, stage, block, bottleneck):
+        self.conv1 = model.getBlockConv(stage, block, 1)
+        self.relu1 = model.getBlockReLU(stage, block, 1)
+        self.conv2 = model.getBlockConv(stage, block, 2)
+        self.relu2 = model.getBlockReLU(stage, block, 2)
 
-    def __len__(self):
-        return len(self.modules)
+        if bottleneck:
+            self.conv3 = model.getBlockConv(stage, block, 3)
+            self.relu3 = model.getBlockReLU(stage, block, 3)
 
-    def __getitem__(self, idx):
-        return self.modules[idx]
+        self.downsample = None
+        if model.hasBlockDownsample(stage, block):
+            self.downsample = model.getBlockDownsample(stage, block)
 
-    def add(self, *args):
-        for a in arg:
-            self.modules.append(a)
-
-    def forward(self, context, program, queue, x):
-        for m in self.modules:
-            x = m.forward(context, program, queue, x)
-        return x
-
-class BasicBlock():
-    expansion = 1
-
-    def __init__(self, ext, context, program, queue,
-                 inplanes, planes, stride=1, downsample=None):
-        self.ext = ext
-        self.conv1 = ext.Conv2d(context, program, queue,
-                                inplanes, planes,
-                                3, stride,
-                                1, 1,
-                                False, 0, 0)
-        self.relu1 = ext.ReLU(context, program, queue)
-        self.conv2 = ext.Conv2d(context, program, queue,
-                                planes, planes,
-                                3, 1,
-                                1, 1,
-                                False, 0, 0)
-        self.relu2 = ext.ReLU(context, program, queue)
-        self.downsample = downsample
-        self.stride = stride
-        self.add = ext.Add(context, program, queue, 0, 0, 0)
-
-    def forward(self, context, program, queue, x):
-        residual = x
-        ext = self.ext
-
-        out = self.conv1.forward(context, program, queue, x)
-        inspect("conv1", ext, context, program, queue, out)
-        out = self.relu1.forward(context, program, queue, out)
-        inspect("relu1", ext, context, program, queue, out)
-        out = self.conv2.forward(context, program, queue, out)
-        inspect("conv2", ext, context, program, queue, out)
-
-        if self.downsample is not None:
-            residual = self.downsample.forward(context, program, queue, x)
-            inspect("residual downsample", ext, context, program, queue, residual)
-
-        self.add.setAdd(residual)
-#        inspect("residual", ext, context, program, queue, residual)
-        out = self.add.forward(context, program, queue, out)
-#        inspect("add", ext, context, program, queue, out)
-        out = self.relu2.forward(context, program, queue, out)
-        inspect("relu2", ext, context, program, queue, out)
-
-        return out
+        self.add = model.getBlockAdd(stage, block)
 
+# Parts of the network that may be built separately (see `parts` below)
+num_parts = 6
 
-class Bottleneck():
-    expansion = 4
-
-    def __init__(self, ext, context, program, queue,
-                 inplanes, planes, stride=1, downsample=None):
-        self.ext = ext
-        self.conv1 = ext.Conv2d(context, program, queue,
-                                inplanes, planes,
-                                1, 1,
-                                0, 0,
-                                False, 0, 0)
-        self.relu1 = ext.ReLU(context, program, queue)
-        self.conv2 = ext.Conv2d(context, program, queue,
-                                planes, planes,
-                                3, stride,
-                                1, 1,
-                                False, 0, 0)
-        self.relu2 = ext.ReLU(context, program, queue)
-        self.conv3 = ext.Conv2d(context, program, queue,
-                                planes, planes * self.expansion,
-                                1, 1,
-                                0, 0,
-                                False, 0, 0)
-        self.relu3 = ext.ReLU(context, program, queue)
-        self.downsample = downsample
-        self.stride = stride
-        self.add = ext.Add(context, program, queue, 0, 0, 0)
-
-    def forward(self, context, program, queue, x):
-        residual = x
-        ext = self.ext
-
-        out = self.conv1.forward(context, program, queue, x)
-        inspect("bottleneck conv1", ext, context, program, queue, out)
-        out = self.relu1.forward(context, program, queue, out)
-        inspect("bottleneck relu1", ext, context, program, queue, out)
-
-        out = self.conv2.forward(context, program, queue, out)
-        inspect("bottleneck conv2", ext, context, program, queue, out)
-        out = self.relu2.forward(context, program, queue, out)
-        inspect("bottleneck relu2", ext, context, program, queue, out)
-
-        out = self.conv3.forward(context, program, queue, out)
-        inspect("bottleneck conv3", ext, context, program, queue, out)
-
-        if self.downsample is not None:
-            residual = self.downsample.forward(context, program, queue, x)
-            inspect("residual downsample", ext, context, program, queue, residual)
+class ResNet():
+    """The network and its residual edges live in C++ (ext.ResNet); this only
+    exposes the layers by their torchvision names so that parameters can be
+    loaded. forward() evaluates the whole batch with a single native call.
 
-        self.add.setAdd(residual)
-        out = self.add.forward(context, program, queue, out)
-        inspect("bottleneck add", ext, context, program, queue, out)
-        out = self.relu3.forward(context, program, queue, out)
-        inspect("bottleneck relu3", ext, context, program, queue, out)
+    `parts` = (first, last) builds only parts first..last of the network,
+    where 0 is conv1 / relu / maxpool, 1 - 4 are layer1 - layer4 and 5 is
+    avgpool / fc. Layers of parts not built are None (or empty).
 
-        return out
+    `layout` (an ext.Layout) selects the activation layout; with NHWC the
+    input is still NCHW, and all stages of a pipeline must agree."""
 
-class ResNet():
     def __init__(self, ext, context, program, queue,
-                 block, layers, num_classes=1000):
-        self.inplanes = 64
+                 block_type, layers, num_classes=1000,
+                 parts=(0, num_parts - 1), layout=None):
         self.ext = ext
-
-        self.conv1 = ext.Conv2d(context, program, queue,
-                                3, 64,
-                                7, 2,
-                                3, 3, False, 0, 0)
-        self.relu = ext.ReLU(context, program, queue)
-        self.maxpool = ext.Pool2d(context, program, queue,
-                                  3, 2, 1, 1, ext.PoolOp.Max, 0, 0)
-        self.layer1 = self._make_layer(ext, context, program, queue,
-                                       block, 64, layers[0])
-        self.layer2 = self._make_layer(ext, context, program, queue,
-                                       block, 128, layers[1], stride=2)
-        self.layer3 = self._make_layer(ext, context, program, queue,
-                                       block, 256, layers[2], stride=2)
-        self.layer4 = self._make_layer(ext, context, program, queue,
-                                       block, 512, layers[3], stride=2)
-        self.avgpool = ext.Pool2d(context, program, queue,
-                                  7, 1, 0, 0, ext.PoolOp.Avg, 0, 0)
-        self.view = ext.View(context, program, queue,
-                             [[0], [1, 2, 3]])
-        self.fc = ext.Linear(context, program, queue,
-                             512 * block.expansion, num_classes, True, 0, 0)
-
-    def _make_layer(self, ext, context, program, queue,
-                    block, planes, blocks, stride=1):
-        downsample = None
-        if stride != 1 or self.inplanes != planes * block.expansion:
-            downsample = ext.Conv2d(context, program, queue,
-                                    self.inplanes, planes * block.expansion,
-                                    1, stride, 0, 0,
-                                    False, 0, 0)
-
-        layers = []
-        layers.append(block(ext, context, program, queue,
-                            self.inplanes, planes, stride, downsample))
-        self.inplanes = planes * block.expansion
-        for i in range(1, blocks):
-            layers.append(block(ext, context, program, queue,
-                                self.inplanes, planes))
-
-        return Sequential(*layers)
+        self.model = ext.ResNet(context, program, queue,
+                                block_type, layers, num_classes,
+                                parts[0], parts[1])
+        if layout is not None:
+            self.model.setLayout(layout)
+
+        bottleneck = (block_type == ext.ResNetBlockType.Bottleneck)
+
+        self.conv1 = None
+        self.relu = None
+        self.maxpool = None
+        if self.model.hasPart(0):
+            self.conv1 = self.model.getConv1()
+            self.relu = self.model.getReLU()
+            self.maxpool = self.model.getMaxPool()
+
+        stages = []
+        for stage in range(self.model.numStages()):
+            stages.append([Block(self.model, stage, block, bottleneck)
+                           for block in range(self.model.numBlocks(stage))])
+        self.layer1, self.layer2, self.layer3, self.layer4 = stages
+
+        self.avgpool = None
+        self.view = None
+        self.fc = None
+        if self.model.hasPart(num_parts - 1):
+            self.avgpool = self.model.getAvgPool()
+            self.view = self.model.getView()
+            self.fc = self.model.getFc()
+
+    def setRoundMode(self, mode):
+        self.model.setRoundMode(mode)
 
     def forward(self, context, program, queue, x):
-        ext = self.ext
-        inspect("input", ext, context, program, queue, x)
-        x = self.conv1.forward(context, program, queue, x)
-        inspect("conv1", ext, context, program, queue, x)
-        x = self.relu.forward(context, program, queue, x)
-        inspect("relu1", ext, context, program, queue, x)
-        x = self.maxpool.forward(context, program, queue, x)
-        inspect("maxpool", ext, context, program, queue, x)
-
-        x = self.layer1.forward(context, program, queue, x)
-        inspect("layer1 out", ext, context, program, queue, x)
-        x = self.layer2.forward(context, program, queue, x)
-        inspect("layer2 out", ext, context, program, queue, x)
-        x = self.layer3.forward(context, program, queue, x)
-        inspect("layer3 out", ext, context, program, queue, x)
-        x = self.layer4.forward(context, program, queue, x)
-        inspect("layer4 out", ext, context, program, queue, x)
-
-        x = self.avgpool.forward(context, program, queue, x)
-        inspect("avgpool out", ext, context, program, queue, x)
-        x = self.view.forward(context, program, queue, x)
-        inspect("view out", ext, context, program, queue, x)
-        x = self.fc.forward(context, program, queue, x)
-        inspect("fc out", ext, context, program, queue, x)
-
-        return x
+        return self.model.forward(context, program, queue, x)
+
+    def optimize(self, ext, context, program, queue, verify_input=None):
+        """Fuses adjacent layers (conv/add + relu, pool + view, BN folding).
+        Must be called after the parameters have been set. If a device
+        `verify_input` is given, each pass is checked against the unfused
+        graph on it."""
+        results = ext.optimize_graph(context, program, queue,
+                                     self.model, verify_input)
+        for r in results:
+            print('{}: {} rewrites, {} / {} mismatches'.format(
+                r.pass_name, r.rewrites, r.mismatches, r.num_elements))
+        return results
+
+    def winograd_convs(self):
+        """(name, conv) for every convolution that may use Winograd"""
+        convs = []
+        if self.conv1 is not None:
+            convs.append(('conv1', self.conv1))
+
+        for i, stage in enumerate([self.layer1, self.layer2,
+                                   self.layer3, self.layer4]):
+            for j, block in enumerate(stage):
+                for name in ['conv1', 'conv2', 'conv3', 'downsample']:
+                    conv = getattr(block, name, None)
+                    if conv is not None:
+                        convs.append(('layer{}.{}.{}'.format(i + 1, j, name),
+                                      conv))
+
+        return [(n, c) for (n, c) in convs if c.canUseWinograd()]
+
+    def select_winograd(self, ext, context, program, queue, x):
+        """Switches each eligible convolution to Winograd in turn, keeping it
+        only if the top-1 predictions on the device input `x` are unchanged.
+        Must be called after the parameters have been set. Returns the names
+        of the convolutions kept."""
+        def top1():
+            out = self.forward(context, program, queue, x)
+            return ext.topk(context, program, queue, out, 1)[1]
+
+        ref = top1()
+        kept = []
+
+        for name, conv in self.winograd_convs():
+            conv.setWinograd(context, program, queue, True)
+            changed = int((top1() != ref).sum())
+
+            if changed == 0:
+                kept.append(name)
+            else:
+                conv.setWinograd(context, program, queue, False)
+
+            print('{}: Winograd {} ({} top-1 changed)'.format(
+                name, 'kept' if changed == 0 else 'dropped', changed))
+
+        return kept
 
 def resnet18(ext, context, program, queue, pretrained=False, **kwargs):
-    model = ResNet(ext, context, program, queue, BasicBlock, [2, 2, 2, 2], **kwargs)
+    model = ResNet(ext, context, program, queue,
+                   ext.ResNetBlockType.Basic, [2, 2, 2, 2], **kwargs)
     return model
 
 def resnet34(ext, context, program, queue, pretrained=False, **kwargs):
-    model = ResNet(ext, context, program, queue, BasicBlock, [3, 4, 6, 3], **kwargs)
+    model = ResNet(ext, context, program, queue,
+                   ext.ResNetBlockType.Basic, [3, 4, 6, 3], **kwargs)
     return model
 
 def resnet50(ext, context, program, queue, pretrained=False, **kwargs):
-    model = ResNet(ext, context, program, queue, Bottleneck, [3, 4, 6, 3], **kwargs)
+    model = ResNet(ext, context, program, queue,
+                   ext.ResNetBlockType.Bottleneck, [3, 4, 6, 3], **kwargs)
     return model
 
 def resnet101(ext, context, program, queue, pretrained=False, **kwargs):
-    model = ResNet(ext, context, program, queue, Bottleneck, [3, 4, 23, 3], **kwargs)
+    model = ResNet(ext, context, program, queue,
+                   ext.ResNetBlockType.Bottleneck, [3, 4, 23, 3], **kwargs)
     return model
 
 def resnet152(ext, context, program, queue, pretrained=False, **kwargs):
-    model = ResNet(ext, context, program, queue, Bottleneck, [3, 8, 36, 3], **kwargs)
+    model = ResNet(ext, context, program, queue,
+                   ext.ResNetBlockType.Bottleneck, [3, 8, 36, 3], **kwargs)
     return model
 
 def fuse_bn(conv, bn):
@@ -266,7 +197,9 @@ def fuse_apply_params(ext, dev, conv, bn, out_conv, w_scale=1.0, b_scale=1.0):
     apply_params(ext, dev, w, b, out_conv)
 
 def fuse_resnet_params(ext, dev, m_in, m_out, fc_mul=1.0):
-    fuse_apply_params(ext, dev, m_in.conv1, m_in.bn1, m_out.conv1)
+    """Loads the parameters of the parts that `m_out` has built"""
+    if m_out.conv1:
+        fuse_apply_params(ext, dev, m_in.conv1, m_in.bn1, m_out.conv1)
 
     for seq_in, seq_out in zip([m_in.layer1, m_in.layer2, m_in.layer3, m_in.layer4],
                                [m_out.layer1, m_out.layer2, m_out.layer3, m_out.layer4]):
@@ -281,9 +214,10 @@ def fuse_resnet_params(ext, dev, m_in, m_out, fc_mul=1.0):
                                   bb_in.downsample[1],
                                   bb_out.downsample)
 
-    apply_params(ext, dev,
-                 m_in.fc.weight.mul(fc_mul),
-                 m_in.fc.bias.mul(fc_mul), m_out.fc)
+    if m_out.fc:
+        apply_params(ext, dev,
+                     m_in.fc.weight.mul(fc_mul),
+                     m_in.fc.bias.mul(fc_mul), m_out.fc)
 
 def gather_act(ext, dev, model):
     def append_act(ext, dev, acts, m):
@@ -0,0 +1,75 @@
+# Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+# All rights reserved.
+#
+# This source code is licensed under the license found in the
+# LICENSE file in the root directory of this source tree.
+
+# Roofline-style benchmark of the matrix multiply, convolution, pooling and
+# pointwise kernels at ResNet-50 shapes, written as JSON for regression
+# tracking. The same shapes are also run in float32 via torch on the host CPU
+# as a baseline.
+
+import json
+import sys
+import time
+import fpga
+import torch
+import torch.nn.functional as F
+
+aocx_file = 'loglib'
+batch = 1
+iters = 10
+
+# Run the bitstream's kernels through a CPU OpenCL device (e.g., the
+# emulator) rather than the FPGA
+use_cpu_device = False
+
+# Tag stored with the results (e.g., a commit)
+tag = sys.argv[1] if len(sys.argv) > 1 else ''
+json_file = 'bench_{}_{}.json'.format(aocx_file,
+                                      'cpu' if use_cpu_device else 'fpga')
+
+if use_cpu_device:
+    ext, pool, devs = fpga.init_fpga_pool(aocx_file, max_devices=1,
+                                          platform='', cpu=True)
+    ctx, prog, q = devs[0]
+else:
+    ext, dev = fpga.init_fpga(aocx_file)
+    ctx, prog, q = dev
+
+def time_cpu(fn):
+    fn()
+    start = time.perf_counter()
+    for _ in range(iters):
+        fn()
+    return (time.perf_counter() - start) * 1e3 / iters
+
+def cpu_baseline(r):
+    """float32 torch time in ms of the op of result r, or None"""
+    if r.op == 'conv2d':
+        # e.g., '64x56x56 -> 256 k1 s1 p0'
+        inp, rest = r.shape.split(' -> ')
+        c, hw, _ = [int(v) for v in inp.split('x')]
+        cout, k, s, p = [int(v.lstrip('ksp')) for v in rest.split(' ')]
+        x = torch.randn(batch, c, hw, hw)
+        w = torch.randn(cout, c, k, k)
+        return time_cpu(lambda: F.conv2d(x, w, stride=s, padding=p))
+    return None
+
+results = ext.bench_all(ctx, prog, q, batch, iters)
+
+# For conversions, GOPS is G elements/s
+print('{:>20} {:>32} {:>10} {:>10} {:>10} {:>8} {:>10}'.format(
+    'op', 'shape', 'ms', 'GOPS', 'GB/s', 'ops/B', 'cpu GOPS'))
+for r in results:
+    cpu_ms = cpu_baseline(r)
+    cpu_gops = r.ops / (cpu_ms * 1e6) if cpu_ms else float('nan')
+
+    print('{:>20} {:>32} {:10.3f} {:10.2f} {:10.2f} {:8.2f} {:10.2f}'.format(
+        r.op, r.shape, r.ms(), r.gops(), r.bytes_per_sec() / 1e9,
+        r.intensity(), cpu_gops))
+
+doc = json.loads(ext.bench_results_to_json(ctx, results, tag))
+with open(json_file, 'w') as f:
+    json.dump(doc, f, indent=1)
+print('Wrote {}'.format(json_file))
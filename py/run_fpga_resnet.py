@@ -45,6 +45,31 @@ class FpgaNN():
     def forward_f(self):
         return ext.to_float(*dev, self.output_p).mul_(self.mul_factor)
 
+    def forward_topk(self, input, k=5):
+        """Returns the (values, indices) of the k largest outputs per image;
+        only these are downloaded"""
+        input_p = ext.to_posit(*dev, input)
+        self.output_p = self.model.forward(*dev, input_p)
+        values, indices = ext.topk(*dev, self.output_p, k)
+        return values.mul_(self.mul_factor), indices
+
+class FpgaPipelinedNN():
+    """Keeps up to `depth` batches in flight via ext.InferenceEngine; see
+    validate.validate(pipelined=True)"""
+    def __init__(self, model, mul_factor=1.0, depth=2):
+        self.engine = ext.InferenceEngine(*dev, model, depth)
+        self.depth = depth
+        self.mul_factor = mul_factor
+
+    def submit(self, input):
+        return self.engine.submit(input.contiguous())
+
+    def retrieve(self):
+        return self.engine.retrieve().mul_(self.mul_factor)
+
+    def in_flight(self):
+        return self.engine.numInFlight()
+
 def get_fpga_mods(model):
     def append_mod(mods, m, name):
         mods.append([name, m])
@@ -84,19 +109,41 @@ cpu_model.eval()
 
 fc_n_scale = -4
 
-fpga_model = fpga_resnet.resnet50(ext, *dev)
+# Channels-last keeps all channels of a pixel contiguous, making 1x1
+# convolutions plain matrix multiplies
+layout = ext.Layout.NCHW
+fpga_model = fpga_resnet.resnet50(ext, *dev, layout=layout)
 fpga_model.fc.setOutputScale(fc_n_scale)
 
 fpga_resnet.fuse_resnet_params(ext, dev, cpu_model, fpga_model, fc_mul=1.0)
 
+verify_input = ext.to_posit(*dev, torch.randn(2, 3, 224, 224))
+fpga_model.optimize(ext, *dev, verify_input=verify_input)
+
 loader = validate.make_loader(batch_size=16, random=False)
 
+# Profiles a single batch, printing where the time goes per layer
+profile = False
+if profile:
+    input, _ = validate.sample_loader(loader)
+    ext.profiler_enable(True)
+    FpgaNN(fpga_model).forward(input)
+    ext.profiler_enable(False)
+    fpga.print_profile(ext, 'resnet50_trace.json')
+    ext.profiler_clear()
+
 scale = 2.0 ** fc_n_scale
-mod = FpgaNN(fpga_model, 1.0 / scale)
+pipelined = True
+if pipelined:
+    mod = FpgaPipelinedNN(fpga_model.model, 1.0 / scale, depth=3)
+else:
+    mod = FpgaNN(fpga_model, 1.0 / scale)
 
 print('ResNet-50 {}:'.format(aocx_file))
 validate.validate(loader,
                   limit=None,
                   fpga_h=mod,
+                  pipelined=pipelined,
+                  topk_only=False,
 #                  reference_model=cpu_model)
                   reference_model=None)
@@ -0,0 +1,67 @@
+# Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+# All rights reserved.
+#
+# This source code is licensed under the license found in the
+# LICENSE file in the root directory of this source tree.
+
+# ResNet-50 validation with the network split into pipeline stages, one per
+# device, each holding only the weights of its own stage
+
+import fpga
+import fpga_resnet
+import torch
+import torchvision.models as models
+import validate
+
+aocx_file = 'loglib'
+
+ext, pool, devs = fpga.init_fpga_pool(aocx_file)
+
+cpu_model = models.resnet50(True)
+cpu_model.eval()
+
+fc_n_scale = -4
+micro_batches = 4
+
+# Contiguous ranges of network parts (see fpga_resnet.ResNet), one per
+# device; the later stages carry most of the weights
+part_ranges = {
+    1: [(0, 5)],
+    2: [(0, 3), (4, 5)],
+    3: [(0, 2), (3, 3), (4, 5)],
+    4: [(0, 2), (3, 3), (4, 4), (5, 5)],
+}[min(len(devs), 4)]
+
+pipeline = ext.PipelineEngine()
+stages = []
+for dev, parts in zip(devs, part_ranges):
+    m = fpga_resnet.resnet50(ext, *dev, parts=parts)
+    if m.fc:
+        m.fc.setOutputScale(fc_n_scale)
+    fpga_resnet.fuse_resnet_params(ext, dev, cpu_model, m, fc_mul=1.0)
+    m.optimize(ext, *dev)
+
+    pipeline.addStage(*dev, m.model)
+    stages.append(m)
+
+class FpgaPipelineNN():
+    def __init__(self, pipeline, micro_batches, mul_factor=1.0):
+        self.pipeline = pipeline
+        self.micro_batches = micro_batches
+        self.mul_factor = mul_factor
+
+    def forward(self, input):
+        out = self.pipeline.forward(input.contiguous(),
+                                    min(self.micro_batches, input.size(0)))
+        return out.mul_(self.mul_factor)
+
+loader = validate.make_loader(batch_size=16, random=False)
+
+scale = 2.0 ** fc_n_scale
+mod = FpgaPipelineNN(pipeline, micro_batches, 1.0 / scale)
+
+print('ResNet-50 {} in {} stages:'.format(aocx_file, pipeline.numStages()))
+validate.validate(loader,
+                  limit=None,
+                  fpga_h=mod,
+                  reference_model=None)
@@ -0,0 +1,65 @@
+# Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+# All rights reserved.
+#
+# This source code is licensed under the license found in the
+# LICENSE file in the root directory of this source tree.
+
+# ResNet-50 validation with the batch sharded across all devices found
+
+import fpga
+import fpga_resnet
+import torch
+import torchvision.models as models
+import validate
+
+aocx_file = 'loglib'
+
+ext, pool, devs = fpga.init_fpga_pool(aocx_file)
+print('Using {} devices'.format(pool.numDevices()))
+
+cpu_model = models.resnet50(True)
+cpu_model.eval()
+
+fc_n_scale = -4
+depth = 2
+
+# One replica of the model per device
+replicas = []
+for i, dev in enumerate(devs):
+    m = fpga_resnet.resnet50(ext, *dev)
+    m.fc.setOutputScale(fc_n_scale)
+    fpga_resnet.fuse_resnet_params(ext, dev, cpu_model, m, fc_mul=1.0)
+    m.optimize(ext, *dev)
+
+    pool.setModel(i, m.model, depth)
+    replicas.append(m)
+
+class FpgaPoolNN():
+    """validate.validate(pipelined=True) handle over the device pool"""
+    def __init__(self, pool, mul_factor=1.0):
+        self.pool = pool
+        self.depth = pool.getDepth()
+        self.mul_factor = mul_factor
+
+    def submit(self, input):
+        self.pool.submit(input.contiguous())
+
+    def retrieve(self):
+        return self.pool.retrieve().mul_(self.mul_factor)
+
+    def in_flight(self):
+        return self.pool.numInFlight()
+
+loader = validate.make_loader(batch_size=16 * pool.numDevices(), random=False)
+
+scale = 2.0 ** fc_n_scale
+mod = FpgaPoolNN(pool, 1.0 / scale)
+
+print('ResNet-50 {} x {}:'.format(aocx_file, pool.numDevices()))
+validate.validate(loader,
+                  limit=None,
+                  fpga_h=mod,
+                  pipelined=True,
+                  reference_model=None)
+
+print('Device throughput (images / s): {}'.format(pool.getThroughputs()))
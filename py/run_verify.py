@@ -0,0 +1,41 @@
+# Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+# All rights reserved.
+#
+# This source code is licensed under the license found in the
+# LICENSE file in the root directory of this source tree.
+
+# Exhaustive bit-exact check of the bitstream's pointwise operators against
+# golden tables from the RTL models. Generate the tables by simulating
+# rtl/posit/tools/PositGoldenTableTool.sv (or
+# rtl/log/tools/LogGoldenTableTool.sv for loglib) with the bitstream's
+# instance parameters, and the function LUTs with
+# rtl/posit/lut_func/PositLUTGenerator.sv.
+
+import sys
+import fpga
+
+aocx_file = 'positlib'
+golden_dir = sys.argv[1] if len(sys.argv) > 1 else '.'
+lut_dir = sys.argv[2] if len(sys.argv) > 2 else golden_dir
+
+# Run the kernels on a CPU OpenCL device (e.g., the emulator) rather than the
+# FPGA
+use_cpu_device = False
+
+if use_cpu_device:
+    ext, pool, devs = fpga.init_fpga_pool(aocx_file, max_devices=1,
+                                          platform='', cpu=True)
+    ctx, prog, q = devs[0]
+else:
+    ext, dev = fpga.init_fpga(aocx_file, select_convert_path=False)
+    ctx, prog, q = dev
+
+results = ext.verify_all(ctx, prog, q, golden_dir, lut_dir, 10)
+print(ext.verify_results_to_string(results))
+
+failed = [r.op for r in results if not r.skipped and not r.passed()]
+skipped = [r.op for r in results if r.skipped]
+print('{} passed, {} failed, {} skipped'.format(
+    len(results) - len(failed) - len(skipped), len(failed), len(skipped)))
+
+sys.exit(1 if failed else 0)
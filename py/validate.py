@@ -53,7 +53,29 @@ def accuracy(output, target, topk=(1,)):
         res.append(correct_k.mul_(100.0 / batch_size))
     return res
 
-def validate(val_loader, limit, fpga_h=None, reference_model=None):
+def accuracy_from_indices(pred, target, topk=(1,)):
+    """Computes the precision@k for the specified values of k, given the
+    indices of the top max(topk) outputs of each sample, best first"""
+    maxk = max(topk)
+    batch_size = target.size(0)
+
+    pred = pred[:, :maxk].t()
+    correct = pred.eq(target.view(1, -1).expand_as(pred))
+
+    res = []
+    for k in topk:
+        correct_k = correct[:k].view(-1).float().sum(0, keepdim=True)
+        res.append(correct_k.mul_(100.0 / batch_size))
+    return res
+
+def validate(val_loader, limit, fpga_h=None, reference_model=None,
+             pipelined=False, topk_only=False):
+    """If `pipelined` is set, `fpga_h` must provide submit(input) /
+    retrieve() / depth / in_flight(); up to `depth` batches are kept in
+    flight on the device, and results are scored as they complete.
+    If `topk_only` is set (not pipelined), `fpga_h` must provide
+    forward_topk(input, k); only the top 5 outputs of each image are
+    downloaded, and the loss is not computed"""
     batch_time = AverageMeter()
     losses = AverageMeter()
     top1 = AverageMeter()
@@ -70,13 +92,53 @@ def validate(val_loader, limit, fpga_h=None, reference_model=None):
 
     criterion = nn.CrossEntropyLoss()
 
+    def fpga_record(i, prec1, prec5, n, with_loss):
+        top1.update(prec1[0], n)
+        top5.update(prec5[0], n)
+
+        # measure elapsed time
+        batch_time.update(time.time() - end)
+
+        loss_str = ''
+        if (with_loss):
+            loss_str = 'Loss {loss.val:.4f} ({loss.avg:.4f})\t'.format(
+                loss=losses)
+
+        print('FPGA: [{0}/{1}]\t'
+              'Time {batch_time.val:.3f} ({batch_time.avg:.3f})\t'
+              '{loss_str}'
+              'Prec@1 {top1.val:.3f} ({top1.avg:.3f})\t'
+              'Prec@5 {top5.val:.3f} ({top5.avg:.3f})'.format(
+                  (i + 1) * val_loader.batch_size,
+                  len(val_loader) * val_loader.batch_size,
+                  batch_time=batch_time, loss_str=loss_str,
+                  top1=top1, top5=top5))
+        sys.stdout.flush()
+
+    def fpga_score(i, output, target):
+        target_var = torch.autograd.Variable(target)
+        loss = criterion(output, target_var)
+        losses.update(loss.item(), target.size(0))
+
+        prec1, prec5 = accuracy(output, target, topk=(1, 5))
+        fpga_record(i, prec1, prec5, target.size(0), True)
+
+    # Only the top-k indices were downloaded, so there is no loss
+    def fpga_score_topk(i, indices, target):
+        prec1, prec5 = accuracy_from_indices(indices, target, topk=(1, 5))
+        fpga_record(i, prec1, prec5, target.size(0), False)
+
+    # (batch index, target) of batches submitted in pipelined mode
+    pending = []
+
     count = 0
     for i, (input, target) in enumerate(val_loader):
         count = count + 1
         if (count > limit and not (limit == -1)):
             break
 
-        if (fpga_h):
+        # In pipelined mode, time is measured between batch completions
+        if (fpga_h and not pipelined):
             end = time.time()
 #            fpga_h.forward_p(input)
 
@@ -106,32 +168,26 @@ def validate(val_loader, limit, fpga_h=None, reference_model=None):
                       top1=ref_top1, top5=ref_top5))
             sys.stdout.flush()
 
-        if (fpga_h):
-
+        if (fpga_h and pipelined):
+            if (fpga_h.in_flight() == fpga_h.depth):
+                pi, ptarget = pending.pop(0)
+                fpga_score(pi, fpga_h.retrieve(), ptarget)
+                end = time.time()
+
+            fpga_h.submit(input)
+            pending.append((i, target))
+        elif (fpga_h and topk_only):
+            _, indices = fpga_h.forward_topk(input, 5)
+            fpga_score_topk(i, indices, target)
+        elif (fpga_h):
 #            output = fpga_h.forward_f()
             output = fpga_h.forward(input)
-#            target_var = torch.autograd.Variable(target, volatile=True)
-            target_var = torch.autograd.Variable(target)
-            loss = criterion(output, target_var)
-
-            prec1, prec5 = accuracy(output, target, topk=(1, 5))
-            losses.update(loss.item(), input.size(0))
-            top1.update(prec1[0], input.size(0))
-            top5.update(prec5[0], input.size(0))
-
-            # measure elapsed time
-            batch_time.update(time.time() - end)
+            fpga_score(i, output, target)
 
-            print('FPGA: [{0}/{1}]\t'
-                  'Time {batch_time.val:.3f} ({batch_time.avg:.3f})\t'
-                  'Loss {loss.val:.4f} ({loss.avg:.4f})\t'
-                  'Prec@1 {top1.val:.3f} ({top1.avg:.3f})\t'
-                  'Prec@5 {top5.val:.3f} ({top5.avg:.3f})'.format(
-                      (i + 1) * val_loader.batch_size,
-                      len(val_loader) * val_loader.batch_size,
-                      batch_time=batch_time, loss=losses,
-                      top1=top1, top5=top5))
-            sys.stdout.flush()
+    while pending:
+        pi, ptarget = pending.pop(0)
+        fpga_score(pi, fpga_h.retrieve(), ptarget)
+        end = time.time()
 
 #    return top1.avg.item(), top5.avg.item()
 
@@ -0,0 +1,150 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Writes golden tables of every input to the operators in the loglib
+// bitstream, for the exhaustive verification in cpp/verify/Verify.h. The
+// operator instances are those of the bitstream (configured by
+// LogInstanceParams.sv). The table layout is that of PositGoldenTableTool.
+//
+// Log -> linear conversion only exists within the matrix multiply, so it is
+// checked here instead: every value is converted to the linear accumulator
+// and back, which must be exact.
+module LogGoldenTableTool();
+  localparam WIDTH = CONFIG_LOG_WIDTH;
+  localparam WRAP = CONFIG_LOG_WRAP_BITS;
+  localparam ACC_WRAP = CONFIG_LOG_ACC_WRAP_BITS;
+
+  localparam MAX_LATENCY = 64;
+
+  // Mismatches to display
+  localparam MAX_REPORT = 10;
+
+  logic clock;
+  logic resetn;
+
+  logic [WRAP-1:0] a;
+  logic [WRAP-1:0] b;
+
+  logic [WRAP-1:0] addOut;
+  logic [WRAP-1:0] subOut;
+  logic [WRAP-1:0] mulOut;
+  logic [7:0] compOut[0:5];
+  logic [31:0] floatOut;
+  logic [ACC_WRAP-1:0] linearOut;
+  logic [WRAP-1:0] logOut;
+
+  LogAdd_Instance add(.a, .b, .logOut(addOut), .subtract(8'd0),
+                      .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                      .ovalid(), .oready());
+
+  LogAdd_Instance sub(.a, .b, .logOut(subOut), .subtract(8'd1),
+                      .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                      .ovalid(), .oready());
+
+  LogMul_Instance mul(.a, .b, .logOut(mulOut),
+                      .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                      .ovalid(), .oready());
+
+  // In order of Comparison::Type
+  genvar c;
+  generate
+    for (c = 0; c < 6; ++c) begin : genComp
+      LogComp_Instance comp(.a, .b, .comp(8'(c)), .boolOut(compOut[c]),
+                            .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                            .ovalid(), .oready());
+    end
+  endgenerate
+
+  LogToFloat_Instance l2f(.vIn(a), .floatOut,
+                          .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                          .ovalid(), .oready());
+
+  LogToLinear_Instance l2lin(.logIn(a), .accOut(linearOut),
+                             .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                             .ovalid(), .oready());
+
+  LinearToLog_Instance lin2l(.accIn(linearOut), .adjustExp(8'sd0),
+                             .logOut,
+                             .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                             .ovalid(), .oready());
+
+  string names[0:8] = '{"add", "sub", "mul",
+                        "comp_eq", "comp_ne", "comp_lt",
+                        "comp_le", "comp_gt", "comp_ge"};
+  integer files[0:8];
+  integer floatFile;
+  integer linearFile;
+  integer mismatches;
+  integer i;
+  integer j;
+
+  always begin
+    #1 clock = ~clock;
+  end
+
+  initial begin
+    clock = 1'b0;
+    resetn = 1'b0;
+    a = WRAP'(1'b0);
+    b = WRAP'(1'b0);
+    mismatches = 0;
+
+    repeat (2) @(posedge clock);
+    resetn = 1'b1;
+
+    for (i = 0; i < 9; ++i) begin
+      files[i] = $fopen({"golden_", names[i], ".hex"}, "w");
+    end
+
+    floatFile = $fopen("golden_to_float.hex", "w");
+    linearFile = $fopen("golden_log_to_linear.hex", "w");
+
+    $display("*** Generating (%0d, %0d) golden tables",
+             CONFIG_LOG_WIDTH, CONFIG_LOG_LS);
+
+    for (i = 0; i < 2 ** WIDTH; ++i) begin
+      for (j = 0; j < 2 ** WIDTH; ++j) begin
+        a = WRAP'(i);
+        b = WRAP'(j);
+
+        // The linear -> log unit is chained after log -> linear
+        repeat (2 * MAX_LATENCY) @(posedge clock);
+
+        $fdisplay(files[0], "%h", addOut);
+        $fdisplay(files[1], "%h", subOut);
+        $fdisplay(files[2], "%h", mulOut);
+
+        for (int k = 0; k < 6; ++k) begin
+          $fdisplay(files[3 + k], "%h", compOut[k][0]);
+        end
+
+        if (j == 0) begin
+          $fdisplay(floatFile, "%h", floatOut);
+          $fdisplay(linearFile, "%h", linearOut);
+
+          if (logOut != a) begin
+            if (mismatches < MAX_REPORT) begin
+              $display("*** log -> linear -> log: %h -> %h -> %h",
+                       a, linearOut, logOut);
+            end
+
+            ++mismatches;
+          end
+        end
+      end
+    end
+
+    $display("*** log -> linear -> log: %0d mismatches", mismatches);
+
+    for (i = 0; i < 9; ++i) begin
+      $fclose(files[i]);
+    end
+
+    $fclose(floatFile);
+    $fclose(linearFile);
+    $finish;
+  end
+endmodule
@@ -0,0 +1,142 @@
+// Copyright (c) Facebook, Inc. and its affiliates. All Rights Reserved.
+// All rights reserved.
+//
+// This source code is licensed under the license found in the
+// LICENSE file in the root directory of this source tree.
+
+// Writes golden tables of every input to the operators in the positlib
+// bitstream, for the exhaustive verification in cpp/verify/Verify.h. The
+// operator instances are those of the bitstream (configured by
+// PositInstanceParams.sv), driven with round to nearest even.
+//
+// Binary tables have one line per (a, b) pair at index (a << WIDTH) | b;
+// unary tables one line per a. Values are written with %h, as with the
+// function LUTs from PositLUTGenerator, which serve as the golden tables for
+// ln, exp, inv, sqrt and sigmoid.
+module PositGoldenTableTool();
+  localparam WIDTH = CONFIG_POSIT_WIDTH;
+  localparam WRAP = CONFIG_POSIT_WRAP_BITS;
+
+  // Cycles to wait for the output of every operator, including divide
+  localparam MAX_LATENCY = 64;
+
+  logic clock;
+  logic resetn;
+
+  logic [WRAP-1:0] a;
+  logic [WRAP-1:0] b;
+
+  logic [WRAP-1:0] addOut;
+  logic [WRAP-1:0] subOut;
+  logic [WRAP-1:0] mulOut;
+  logic [WRAP-1:0] divOut;
+  logic [WRAP-1:0] minOut;
+  logic [WRAP-1:0] maxOut;
+  logic [7:0] compOut[0:5];
+  logic [31:0] floatOut;
+
+  PositAdd_Instance add(.positA(a), .positB(b), .positOut(addOut),
+                        .subtract(8'd0), .roundStochastic(8'd0),
+                        .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                        .ovalid(), .oready());
+
+  PositAdd_Instance sub(.positA(a), .positB(b), .positOut(subOut),
+                        .subtract(8'd1), .roundStochastic(8'd0),
+                        .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                        .ovalid(), .oready());
+
+  PositMul_Instance mul(.positA(a), .positB(b), .positOut(mulOut),
+                        .roundStochastic(8'd0),
+                        .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                        .ovalid(), .oready());
+
+  PositDiv_Instance div(.positA(a), .positB(b), .positOut(divOut),
+                        .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                        .ovalid(), .oready());
+
+  PositMin_Instance min(.positA(a), .positB(b), .positOut(minOut),
+                        .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                        .ovalid(), .oready());
+
+  PositMax_Instance max(.positA(a), .positB(b), .positOut(maxOut),
+                        .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                        .ovalid(), .oready());
+
+  // In order of Comparison::Type
+  genvar c;
+  generate
+    for (c = 0; c < 6; ++c) begin : genComp
+      PositComp_Instance comp(.positA(a), .positB(b), .comp(8'(c)),
+                              .boolOut(compOut[c]),
+                              .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                              .ovalid(), .oready());
+    end
+  endgenerate
+
+  PositToFloat_Instance p2f(.positIn(a), .expAdjust(8'sd0),
+                            .floatOut,
+                            .clock, .resetn, .ivalid(1'b1), .iready(1'b1),
+                            .ovalid(), .oready());
+
+  string names[0:11] = '{"add", "sub", "mul", "div", "min", "max",
+                         "comp_eq", "comp_ne", "comp_lt",
+                         "comp_le", "comp_gt", "comp_ge"};
+  integer files[0:11];
+  integer floatFile;
+  integer i;
+  integer j;
+
+  always begin
+    #1 clock = ~clock;
+  end
+
+  initial begin
+    clock = 1'b0;
+    resetn = 1'b0;
+    a = WRAP'(1'b0);
+    b = WRAP'(1'b0);
+
+    repeat (2) @(posedge clock);
+    resetn = 1'b1;
+
+    for (i = 0; i < 12; ++i) begin
+      files[i] = $fopen({"golden_", names[i], ".hex"}, "w");
+    end
+
+    floatFile = $fopen("golden_to_float.hex", "w");
+
+    $display("*** Generating (%0d, %0d) golden tables",
+             CONFIG_POSIT_WIDTH, CONFIG_POSIT_ES);
+
+    for (i = 0; i < 2 ** WIDTH; ++i) begin
+      for (j = 0; j < 2 ** WIDTH; ++j) begin
+        a = WRAP'(i);
+        b = WRAP'(j);
+
+        repeat (MAX_LATENCY) @(posedge clock);
+
+        $fdisplay(files[0], "%h", addOut);
+        $fdisplay(files[1], "%h", subOut);
+        $fdisplay(files[2], "%h", mulOut);
+        $fdisplay(files[3], "%h", divOut);
+        $fdisplay(files[4], "%h", minOut);
+        $fdisplay(files[5], "%h", maxOut);
+
+        for (int k = 0; k < 6; ++k) begin
+          $fdisplay(files[6 + k], "%h", compOut[k][0]);
+        end
+
+        if (j == 0) begin
+          $fdisplay(floatFile, "%h", floatOut);
+        end
+      end
+    end
+
+    for (i = 0; i < 12; ++i) begin
+      $fclose(files[i]);
+    end
+
+    $fclose(floatFile);
+    $finish;
+  end
+endmodule